@@ -0,0 +1,273 @@
+#include "ApiJson.h"
+#include "Channels.h"
+#include "Scheduler.h"
+#include "Vibration.h"
+#include "SupplyMonitor.h"
+#include "ConfigStore.h"
+
+String ApiJson::rpm(uint8_t channel) {
+  const RPMCounter& counter = Channels::get(channel).rpm;
+  const SpeedEstimator& estimator = counter.getEstimator();
+  String json = "{";
+  json += "\"channel\":" + String(channel) + ",";
+  json += "\"rpm\":" + formatCentiRpm(counter.getCurrentCentiRpm()) + ",";
+  json += "\"smoothedRpm\":" + formatCentiRpm(estimator.getCentiRpm(Hal::micros())) + ",";
+  json += "\"accelerationRpmPerS\":" + String((long)(estimator.getCentiRpmPerSecond() / 100)) + ",";
+  json += "\"torqueMicroNm\":" + String((long)estimator.getTorqueMicroNm()) + ",";
+  json += "\"peakTorqueMicroNm\":" + String((long)estimator.getPeakTorqueMicroNm()) + ",";
+  json += "\"signalCount\":" + String(counter.getSignalCount()) + ",";
+  json += "\"lastSignalTime\":" + String(counter.getLastSignalTime()) + ",";
+  json += "\"timeBetweenSignalsMicros\":" + String(counter.getTimeBetweenSignals()) + ",";
+  json += "\"timeBetweenSignalsMs\":" + formatMicrosAsMillis(counter.getTimeBetweenSignals()) + ",";
+  json += "\"timestamp\":" + String(Hal::millis());
+  json += "}";
+  return json;
+}
+
+String ApiJson::motor(uint8_t channel) {
+  const MotorController& motor = Channels::get(channel).motor;
+  String json = "{";
+  json += "\"channel\":" + String(channel) + ",";
+  json += "\"speed\":" + String(motor.getCurrentSpeed()) + ",";
+  json += "\"running\":" + String(motor.isRunning() ? "true" : "false") + ",";
+  json += "\"testRunning\":" + String(motor.isAccelerationTestRunning() ? "true" : "false") + ",";
+  json += "\"targetTimesMs\":[";
+  for (int i = 0; i < 4; i++) {
+    if (i > 0) json += ",";
+    json += String(motor.getTargetTime(i));
+  }
+  json += "],";
+  json += "\"spinUp\":[";
+  for (int i = 0; i < 4; i++) {
+    if (i > 0) json += ",";
+    json += spinUpModel(motor.getSpinUpModel(i));
+  }
+  json += "],";
+  json += "\"supply\":[";
+  for (int i = 0; i < 4; i++) {
+    const SupplyStats& supply = motor.getTestSupply(i);
+    if (i > 0) json += ",";
+    json += "{\"meanMv\":" + String(supply.meanMv) + ",";
+    json += "\"minMv\":" + String(supply.minMv) + ",";
+    json += "\"maxMv\":" + String(supply.maxMv) + ",";
+    json += "\"samples\":" + String(supply.samples) + "}";
+  }
+  json += "],";
+  json += "\"normalizedTargetTimesMs\":[";
+  for (int i = 0; i < 4; i++) {
+    if (i > 0) json += ",";
+    json += String(motor.getNormalizedTargetTime(i));
+  }
+  json += "],";
+  json += "\"lastUpdate\":" + String(motor.getLastUpdateTime()) + ",";
+  json += "\"timestamp\":" + String(Hal::millis());
+  json += "}";
+  return json;
+}
+
+String ApiJson::prediction(uint8_t channel, int test, uint32_t rpm) {
+  const SpinUpModel& model = Channels::get(channel).motor.getSpinUpModel(test);
+  unsigned long timeMs = SpinUpFit::timeToRpm(model, rpm);
+  String json = "{";
+  json += "\"channel\":" + String(channel) + ",";
+  json += "\"test\":" + String(test) + ",";
+  json += "\"rpm\":" + String(rpm) + ",";
+  json += "\"reachable\":" + String(timeMs > 0 ? "true" : "false") + ",";
+  json += "\"timeMs\":" + String(timeMs) + ",";
+  json += "\"model\":" + spinUpModel(model) + ",";
+  json += "\"timestamp\":" + String(Hal::millis());
+  json += "}";
+  return json;
+}
+
+String ApiJson::spinUpModel(const SpinUpModel& model) {
+  String json = "{";
+  json += "\"finalRpm\":" + formatCentiRpm(model.finalCentiRpm) + ",";
+  json += "\"tauMs\":" + String(model.tauMs) + ",";
+  json += "\"offsetMs\":" + String((long)model.offsetMs) + ",";
+  json += "\"samples\":" + String(model.samples) + ",";
+  json += "\"earlyAbort\":" + String(model.earlyAbort ? "true" : "false");
+  json += "}";
+  return json;
+}
+
+String ApiJson::supply() {
+  String json = "{";
+  json += "\"enabled\":" + String(SupplyMonitor::isEnabled() ? "true" : "false") + ",";
+  json += "\"millivolts\":" + String(SupplyMonitor::getLatestMv()) + ",";
+  json += "\"nominalMv\":" + String(ConfigStore::get().nominalSupplyMv) + ",";
+  json += "\"sampleCount\":" + String(SupplyMonitor::getSampleCount()) + ",";
+
+  // Recent history as [micros, millivolts] pairs, oldest first
+  SupplySample samples[SupplyMonitor::HISTORY];
+  unsigned long total = SupplyMonitor::getSampleCount();
+  unsigned long cursor = total > SupplyMonitor::HISTORY ? total - SupplyMonitor::HISTORY : 0;
+  unsigned long lost = 0;
+  uint8_t count = SupplyMonitor::readSamples(cursor, samples, SupplyMonitor::HISTORY, lost);
+  json += "\"samples\":[";
+  for (uint8_t i = 0; i < count; i++) {
+    if (i > 0) json += ",";
+    json += "[" + String(samples[i].timeUs) + "," + String(samples[i].millivolts) + "]";
+  }
+  json += "],";
+  json += "\"timestamp\":" + String(Hal::millis());
+  json += "}";
+  return json;
+}
+
+// Non-empty bins only, as [from us, count] pairs - a clean sensor fills two
+// or three of the 48
+static void appendHistogram(String& json, const SensorDiagnostics& diagnostics, bool intervals) {
+  json += "[";
+  bool first = true;
+  for (uint8_t bin = 0; bin < SensorDiagnostics::BINS; bin++) {
+    uint32_t count = intervals ? diagnostics.getIntervalCount(bin) : diagnostics.getWidthCount(bin);
+    if (count == 0) continue;
+    if (!first) json += ",";
+    first = false;
+    json += "[" + String(SensorDiagnostics::getBinStartUs(bin)) + "," + String(count) + "]";
+  }
+  json += "]";
+}
+
+String ApiJson::sensorDiagnostics(uint8_t channel) {
+  const RPMCounter& counter = Channels::get(channel).rpm;
+  const SensorDiagnostics& diagnostics = counter.getDiagnostics();
+  const TesterConfig& config = ConfigStore::get();
+  String json = "{";
+  json += "\"channel\":" + String(channel) + ",";
+  json += "\"clean\":" + String(diagnostics.isClean() ? "true" : "false") + ",";
+  json += "\"accepted\":" + String(diagnostics.getAcceptedCount()) + ",";
+  json += "\"rejected\":{";
+  for (uint8_t i = 0; i < SensorDiagnostics::REASON_COUNT; i++) {
+    SensorDiagnostics::Reason reason = (SensorDiagnostics::Reason)i;
+    if (i > 0) json += ",";
+    json += "\"" + String(SensorDiagnostics::getReasonName(reason)) + "\":" + String(diagnostics.getRejectedCount(reason));
+  }
+  json += "},";
+  json += "\"minSignalLengthUs\":" + String(config.minSignalLengthUs) + ",";
+  json += "\"maxSignalLengthUs\":" + String(config.maxSignalLengthUs) + ",";
+  json += "\"widthUs\":";
+  appendHistogram(json, diagnostics, false);
+  json += ",\"intervalUs\":";
+  appendHistogram(json, diagnostics, true);
+  json += ",\"timestamp\":" + String(Hal::millis());
+  json += "}";
+  return json;
+}
+
+String ApiJson::channels() {
+  String json = "{\"channels\":" + channelList() + ",";
+  json += "\"timestamp\":" + String(Hal::millis());
+  json += "}";
+  return json;
+}
+
+String ApiJson::channelList() {
+  String json = "[";
+  for (uint8_t i = 0; i < Channels::getCount(); i++) {
+    const Channel& channel = Channels::get(i);
+    const MotorPins& pins = channel.motor.getPins();
+    if (i > 0) json += ",";
+    json += "{";
+    json += "\"channel\":" + String(i) + ",";
+    json += "\"sensorPin\":" + String(channel.rpm.getPin()) + ",";
+    json += "\"capture\":\"" + String(Channels::getCapture().getName()) + "\",";
+    json += "\"motorPins\":[" + String(pins.in1) + "," + String(pins.in2) + "," + String(pins.enable) + "],";
+    json += "\"rpm\":" + formatCentiRpm(channel.rpm.getCurrentCentiRpm()) + ",";
+    json += "\"signalCount\":" + String(channel.rpm.getSignalCount()) + ",";
+    json += "\"speed\":" + String(channel.motor.getCurrentSpeed()) + ",";
+    json += "\"running\":" + String(channel.motor.isRunning() ? "true" : "false") + ",";
+    json += "\"testRunning\":" + String(channel.motor.isAccelerationTestRunning() ? "true" : "false");
+    json += "}";
+  }
+  json += "]";
+  return json;
+}
+
+String ApiJson::scheduler() {
+  String json = "{\"tasks\":[";
+  for (uint8_t i = 0; i < Scheduler::getTaskCount(); i++) {
+    const SchedulerTask& task = Scheduler::getTask(i);
+    if (i > 0) json += ",";
+    json += "{";
+    json += "\"name\":\"" + String(task.name) + "\",";
+    json += "\"priority\":" + String(task.priority) + ",";
+    json += "\"periodMicros\":" + String(task.periodMicros) + ",";
+    json += "\"budgetMicros\":" + String(task.budgetMicros) + ",";
+    json += "\"runCount\":" + String(task.runCount) + ",";
+    json += "\"lastRunMicros\":" + String(task.lastRunMicros) + ",";
+    json += "\"maxRunMicros\":" + String(task.maxRunMicros) + ",";
+    json += "\"meanRunMicros\":" + String(task.runCount > 0 ? task.totalRunMicros / task.runCount : 0) + ",";
+    json += "\"missedDeadlines\":" + String(task.missedDeadlines) + ",";
+    json += "\"overBudget\":" + String(task.overBudget) + ",";
+    json += "\"deferred\":" + String(task.deferred);
+    json += "}";
+  }
+  json += "],";
+  json += "\"idleMicros\":" + String(Scheduler::getIdleMicros()) + ",";
+  json += "\"timestamp\":" + String(Hal::millis());
+  json += "}";
+  return json;
+}
+
+String ApiJson::vibration(uint8_t channel) {
+  const VibrationResult& result = Vibration::getResult(channel);
+  String json = "{";
+  json += "\"channel\":" + String(channel) + ",";
+  json += "\"window\":" + String(Vibration::WINDOW) + ",";
+  json += "\"windows\":" + String(Vibration::getWindowCount(channel)) + ",";
+  json += "\"unsteadyWindows\":" + String(Vibration::getUnsteadyCount(channel)) + ",";
+  json += "\"lostPulses\":" + String(Vibration::getLostPulses(channel)) + ",";
+  if (result.time == 0) {
+    json += "\"result\":null,";
+  } else {
+    json += "\"result\":{";
+    json += "\"time\":" + String(result.time) + ",";
+    json += "\"rpm\":" + formatCentiRpm(result.centiRpm) + ",";
+    json += "\"meanIntervalUs\":" + String(result.meanIntervalUs) + ",";
+    json += "\"jitterRmsNs\":" + String(result.jitterRmsNs) + ",";
+    json += "\"cycleJitterRmsNs\":" + String(result.cycleJitterRmsNs) + ",";
+    json += "\"cycleJitterMaxNs\":" + String(result.cycleJitterMaxNs) + ",";
+    json += "\"peaks\":[";
+    bool first = true;
+    for (const VibrationResult::Peak& peak : result.peaks) {
+      if (peak.amplitudeNs == 0) continue;
+      if (!first) json += ",";
+      first = false;
+      // Order in cycles per revolution, frequency from the window's mean speed
+      json += "{\"bin\":" + String(peak.bin);
+      json += ",\"orderMilli\":" + String((unsigned long)peak.bin * 1000 / Vibration::WINDOW);
+      json += ",\"frequencyMilliHz\":" + String((unsigned long)((uint64_t)peak.bin * result.centiRpm / (6 * Vibration::WINDOW)));
+      json += ",\"amplitudeNs\":" + String(peak.amplitudeNs) + "}";
+    }
+    json += "],";
+    json += "\"spectrumNs\":[";
+    for (uint16_t i = 0; i < VibrationResult::BINS; i++) {
+      if (i > 0) json += ",";
+      json += String(result.amplitudeNs[i]);
+    }
+    json += "]},";
+  }
+  json += "\"timestamp\":" + String(Hal::millis());
+  json += "}";
+  return json;
+}
+
+String ApiJson::formatCentiRpm(uint32_t centiRpm) {
+  uint32_t tenths = (centiRpm + 5) / 10; // Round to one decimal
+  String text = String((unsigned long)(tenths / 10));
+  text += '.';
+  text += (char)('0' + tenths % 10);
+  return text;
+}
+
+String ApiJson::formatMicrosAsMillis(unsigned long micros) {
+  unsigned long fraction = micros % 1000;
+  String text = String(micros / 1000);
+  text += '.';
+  text += (char)('0' + fraction / 100);
+  text += (char)('0' + fraction / 10 % 10);
+  text += (char)('0' + fraction % 10);
+  return text;
+}
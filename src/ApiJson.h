@@ -0,0 +1,28 @@
+#ifndef MOTOR_TESTER_API_JSON_H
+#define MOTOR_TESTER_API_JSON_H
+
+#include "Hal.h"
+#include "SpinUpFit.h"
+
+// Response bodies of the most frequently polled endpoints. Kept out of the
+// WebServer lambdas so they build on the host too, where the benchmarks
+// measure what each response costs to serialize.
+class ApiJson {
+  public:
+    static String rpm(uint8_t channel);    // GET /api/ch/{n}/rpm
+    static String motor(uint8_t channel);  // GET /api/ch/{n}/motor
+    static String channels();              // GET /api/channels
+    static String channelList();           // Just the array, also part of /api/status
+    static String scheduler();             // GET /api/scheduler
+    static String vibration(uint8_t channel); // GET /api/ch/{n}/vibration
+    static String prediction(uint8_t channel, int test, uint32_t rpm); // GET /api/ch/{n}/motor/predict
+    static String spinUpModel(const SpinUpModel& model);
+    static String supply();                // GET /api/supply
+    static String sensorDiagnostics(uint8_t channel); // GET /api/ch/{n}/sensor/diagnostics
+
+    // Integer-only number formatting (no soft-float on the device)
+    static String formatCentiRpm(uint32_t centiRpm);   // 1 decimal, e.g. "12000.0"
+    static String formatMicrosAsMillis(unsigned long micros); // 3 decimals, e.g. "5.000"
+};
+
+#endif
@@ -0,0 +1,276 @@
+#include "Benchmark.h"
+#include "Channels.h"
+#include "ApiJson.h"
+#include "Vibration.h"
+#include "Logger.h"
+
+// Static member definitions
+BenchmarkResult Benchmark::results[Benchmark::MAX_RESULTS];
+uint8_t Benchmark::resultCount = 0;
+uint32_t Benchmark::overheadCycles = 0;
+Benchmark::State Benchmark::state = Benchmark::STATE_IDLE;
+uint16_t Benchmark::requestedIterations = 0;
+
+namespace {
+  // Volatile sinks and sources so the compiler can't fold the work away
+  volatile unsigned long sourceInterval = 5000;
+  volatile float sinkFloat = 0;
+  volatile unsigned long sinkInteger = 0;
+
+  unsigned long edgeBase = 0;
+
+  // Synthetic edges go through a counter of their own - never attached to
+  // a pin, so it only sees what the benchmarks feed it
+  RPMCounter benchmarkCounter;
+
+  RPMCounter& counter() {
+    return benchmarkCounter;
+  }
+
+  // 12000 RPM with 1 ms pulses - every edge passes the ISR filters
+  unsigned long edgeTime(uint32_t iteration) {
+    return edgeBase + iteration * 5000UL;
+  }
+
+  void noop(uint32_t) {}
+
+  void risingEdge(uint32_t iteration) {
+    counter().processEdge(edgeTime(iteration), HIGH);
+  }
+
+  void fallingEdge(uint32_t iteration) {
+    counter().processEdge(edgeTime(iteration) + 1000, LOW);
+  }
+
+  void fullPulse(uint32_t iteration) {
+    risingEdge(iteration);
+    fallingEdge(iteration);
+  }
+
+  void rpmUpdate(uint32_t) {
+    counter().update();
+  }
+
+  // The divide RPMCounter::update() used before the centi-RPM change: the
+  // literal made it a double (software) divide on the ESP8266. Kept as the
+  // reference for the cycles the integer path saves per pulse.
+  void divideDouble(uint32_t) {
+    sinkFloat = 60000000.0 / sourceInterval;
+  }
+
+  void divideFloat(uint32_t) {
+    sinkFloat = 60000000.0f / sourceInterval;
+  }
+
+  void divideInteger(uint32_t) {
+    sinkInteger = 60000000UL / sourceInterval;
+  }
+
+  void centiRpm(uint32_t) {
+    sinkInteger = RPMCounter::intervalToCentiRpm(sourceInterval);
+  }
+
+  void formatFloat(uint32_t) {
+    sinkInteger = String(sinkFloat, 1).length();
+  }
+
+  void formatCenti(uint32_t) {
+    sinkInteger = ApiJson::formatCentiRpm(1200000).length();
+  }
+
+  void jsonRpm(uint32_t) {
+    sinkInteger = ApiJson::rpm(0).length();
+  }
+
+  void jsonMotor(uint32_t) {
+    sinkInteger = ApiJson::motor(0).length();
+  }
+
+  void jsonScheduler(uint32_t) {
+    sinkInteger = ApiJson::scheduler().length();
+  }
+
+  // Steady 12000 RPM with a little jitter, past the estimator's start-up
+  SpeedEstimator estimator;
+
+  void estimatorPulse(uint32_t iteration) {
+    estimator.addPulse(edgeTime(iteration) + (iteration & 3) * 5);
+  }
+
+  // 12000 RPM with a 10 us variation every 4 revolutions
+  uint32_t vibrationIntervals[Vibration::WINDOW];
+  VibrationResult vibrationResult;
+
+  void vibrationWindow(uint32_t) {
+    sinkInteger = Vibration::analyse(vibrationIntervals, vibrationResult);
+  }
+}
+
+void Benchmark::runAll(uint16_t iterations) {
+  if (iterations == 0) iterations = 1;
+  resultCount = 0;
+
+  calibrate(iterations);
+
+  counter().reset();
+  edgeBase = Hal::micros();
+  measure("isr_rising_edge", "edge", noop, risingEdge, iterations);
+  measure("isr_falling_edge", "edge", risingEdge, fallingEdge, iterations);
+  measure("rpm_update", "update", fullPulse, rpmUpdate, iterations);
+  counter().reset();
+  estimator.reset();
+  for (uint32_t i = 0; i <= SpeedEstimator::STARTUP_STEPS; i++) estimatorPulse(i);
+  edgeBase += (SpeedEstimator::STARTUP_STEPS + 1) * 5000UL;
+  measure("estimator_pulse", "pulse", noop, estimatorPulse, iterations);
+
+  measure("divide_double", "divide", noop, divideDouble, iterations);
+  measure("divide_float", "divide", noop, divideFloat, iterations);
+  measure("divide_integer", "divide", noop, divideInteger, iterations);
+  measure("rpm_centi", "divide", noop, centiRpm, iterations);
+
+  measure("format_rpm_float", "response", noop, formatFloat, iterations);
+  measure("format_rpm_centi", "response", noop, formatCenti, iterations);
+
+  measure("json_rpm", "response", noop, jsonRpm, iterations);
+  measure("json_motor", "response", noop, jsonMotor, iterations);
+  measure("json_scheduler", "response", noop, jsonScheduler, iterations);
+
+  // A whole window per iteration - keep the run short
+  static const int32_t PATTERN[4] = {0, 10, 0, -10};
+  for (uint16_t n = 0; n < Vibration::WINDOW; n++) vibrationIntervals[n] = 5000 + PATTERN[n % 4];
+  measure("vibration_window", "window", noop, vibrationWindow, iterations >= 10 ? iterations / 10 : 1);
+}
+
+void Benchmark::calibrate(uint16_t iterations) {
+  // Cost of reading the counter twice and an indirect call, subtracted from
+  // every sample
+  Step body = noop;
+  overheadCycles = UINT32_MAX;
+  for (uint16_t i = 0; i < iterations; i++) {
+    uint32_t start = Hal::cycleCount();
+    body(i);
+    uint32_t cycles = Hal::cycleCount() - start;
+    if (cycles < overheadCycles) overheadCycles = cycles;
+  }
+}
+
+void Benchmark::measure(const char* name, const char* per, Step setup, Step body, uint16_t iterations) {
+  if (resultCount >= MAX_RESULTS) return;
+
+  BenchmarkResult* result;
+  {
+    Hal::MeasurementLock lock;
+    result = &results[resultCount++];
+    result->name = name;
+    result->per = per;
+    result->iterations = 0;
+    result->minCycles = UINT32_MAX;
+    result->maxCycles = 0;
+    result->totalCycles = 0;
+  }
+
+  uint16_t i = 0;
+  while (i < iterations) {
+    // At most SLICE_MICROS at a time under the lock, then a yield: keeps the
+    // ESP8266's software watchdog fed and lets web requests in (ESP32). The
+    // task itself runs outside the scheduler's lock.
+    Hal::yield();
+    Hal::MeasurementLock lock;
+    if (Channels::isAnyBusy()) return; // Started mid-run, update() cancels
+
+    unsigned long sliceStart = Hal::micros();
+    do {
+      setup(i);
+      uint32_t start = Hal::cycleCount();
+      body(i);
+      uint32_t cycles = Hal::cycleCount() - start;
+      cycles = cycles > overheadCycles ? cycles - overheadCycles : 0;
+
+      if (cycles < result->minCycles) result->minCycles = cycles;
+      if (cycles > result->maxCycles) result->maxCycles = cycles;
+      result->totalCycles += cycles;
+      result->iterations = ++i;
+    } while (i < iterations && Hal::micros() - sliceStart < SLICE_MICROS);
+  }
+}
+
+bool Benchmark::request(uint16_t iterations) {
+  if (state == STATE_PENDING) return false;
+  requestedIterations = iterations;
+  state = STATE_PENDING;
+  return true;
+}
+
+void Benchmark::update() {
+  {
+    Hal::MeasurementLock lock;
+    if (state != STATE_PENDING) return;
+
+    // A motor started since the request: its timing matters more
+    if (Channels::isAnyBusy()) {
+      state = STATE_CANCELLED;
+      LOG_WARN("Benchmark cancelled - a motor is running");
+      return;
+    }
+  }
+
+  runAll(requestedIterations);
+  Hal::MeasurementLock lock;
+  if (Channels::isAnyBusy()) {
+    state = STATE_CANCELLED;
+    LOG_WARN("Benchmark cancelled - a motor is running");
+    return;
+  }
+  state = STATE_DONE;
+  LOG_INFO("Benchmark finished, %lu iterations", requestedIterations);
+}
+
+const char* Benchmark::getStateName() {
+  switch (state) {
+    case STATE_PENDING: return "pending";
+    case STATE_DONE: return "done";
+    case STATE_CANCELLED: return "cancelled";
+    default: return "idle";
+  }
+}
+
+uint8_t Benchmark::getCount() {
+  return resultCount;
+}
+
+const BenchmarkResult& Benchmark::getResult(uint8_t index) {
+  return results[index];
+}
+
+uint32_t Benchmark::getMeanCycles(const BenchmarkResult& result) {
+  return result.iterations > 0 ? (uint32_t)(result.totalCycles / result.iterations) : 0;
+}
+
+String Benchmark::toJson() {
+  // One benchmark per line so result files diff cleanly
+#if defined(ESP32)
+  const char* platform = "esp32";
+#elif defined(ARDUINO)
+  const char* platform = "esp8266";
+#else
+  const char* platform = "native";
+#endif
+  String json = "{\"platform\":\"" + String(platform) + "\",";
+  json += "\"state\":\"" + String(getStateName()) + "\",";
+  json += "\"cpuMHz\":" + String((unsigned long)Hal::cpuFreqMHz()) + ",";
+  json += "\"overheadCycles\":" + String((unsigned long)overheadCycles) + ",";
+  json += "\"benchmarks\":[\n";
+  for (uint8_t i = 0; i < resultCount; i++) {
+    const BenchmarkResult& result = results[i];
+    json += "{\"name\":\"" + String(result.name) + "\",";
+    json += "\"per\":\"" + String(result.per) + "\",";
+    json += "\"iterations\":" + String((unsigned long)result.iterations) + ",";
+    json += "\"minCycles\":" + String((unsigned long)result.minCycles) + ",";
+    json += "\"meanCycles\":" + String((unsigned long)getMeanCycles(result)) + ",";
+    json += "\"maxCycles\":" + String((unsigned long)result.maxCycles) + ",";
+    json += "\"minNs\":" + String((unsigned long)((uint64_t)result.minCycles * 1000 / Hal::cpuFreqMHz())) + "}";
+    json += i + 1 < resultCount ? ",\n" : "\n";
+  }
+  json += "]}\n";
+  return json;
+}
@@ -0,0 +1,60 @@
+#ifndef MOTOR_TESTER_BENCHMARK_H
+#define MOTOR_TESTER_BENCHMARK_H
+
+#include "Hal.h"
+
+// Micro-benchmarks of the hot paths: the ISR filter (per edge), the RPM
+// update and its divide (per update) and JSON serialization (per response).
+// The same suite runs on the device (GET /api/benchmark, cycle counts) and
+// on the host (native `bench` command, where one "cycle" is 1 ns), so a
+// regression shows up before anything is flashed.
+//
+// The ISR benchmarks drive a private RPMCounter, so no channel's counts or
+// pulse cursors move. A run blocks the loop for up to several seconds, so on
+// the device it is only requested from the web server (request()) and runs
+// later from the `benchmark` scheduler task, and only with every motor
+// stopped.
+struct BenchmarkResult {
+  const char* name;
+  const char* per;        // What one iteration is: edge, update, divide, response, window
+  uint32_t iterations;
+  uint32_t minCycles;     // Measurement overhead already subtracted
+  uint32_t maxCycles;
+  uint64_t totalCycles;
+};
+
+class Benchmark {
+  public:
+    static const uint8_t MAX_RESULTS = 16;
+    static const uint16_t DEFAULT_ITERATIONS = 1000;
+    static const uint32_t SLICE_MICROS = 5000; // Longest stretch under the lock between yields
+
+    enum State : uint8_t { STATE_IDLE, STATE_PENDING, STATE_DONE, STATE_CANCELLED };
+
+    static void runAll(uint16_t iterations = DEFAULT_ITERATIONS);
+
+    // Device side: queue a run for update(); false if one is already queued
+    static bool request(uint16_t iterations);
+    static void update(); // Scheduler task
+    static State getState() { return state; }
+    static const char* getStateName();
+
+    static uint8_t getCount();
+    static const BenchmarkResult& getResult(uint8_t index);
+    static uint32_t getMeanCycles(const BenchmarkResult& result);
+    static String toJson();
+
+  private:
+    typedef void (*Step)(uint32_t iteration);
+
+    static BenchmarkResult results[MAX_RESULTS];
+    static uint8_t resultCount;
+    static uint32_t overheadCycles;
+    static State state;
+    static uint16_t requestedIterations;
+
+    static void calibrate(uint16_t iterations);
+    static void measure(const char* name, const char* per, Step setup, Step body, uint16_t iterations);
+};
+
+#endif
@@ -0,0 +1,76 @@
+#include "Channels.h"
+#include "Logger.h"
+
+// Static member definitions
+Channel Channels::channels[Channels::MAX_CHANNELS];
+uint8_t Channels::channelCount = 0;
+EdgeCapture* Channels::capture = nullptr;
+
+static_assert(GpioEdgeCapture::MAX_INPUTS >= Channels::MAX_CHANNELS,
+              "GpioEdgeCapture needs a trampoline per channel");
+
+void Channels::begin(const ChannelPins* pins, uint8_t count, EdgeCapture& edgeCapture) {
+  if (count > MAX_CHANNELS) count = MAX_CHANNELS;
+  
+  // Switching backends (the host scenarios do): release the old one's pins
+  if (capture && capture != &edgeCapture) {
+    for (uint8_t i = 0; i < channelCount; i++) {
+      capture->detach(i, channels[i].rpm.getPin());
+    }
+  }
+  capture = &edgeCapture;
+  channelCount = count;
+  
+  for (uint8_t i = 0; i < count; i++) {
+    channels[i].rpm.begin(i, pins[i].sensor, edgeCapture);
+    channels[i].motor.begin(i, pins[i].motor, &channels[i].rpm);
+  }
+  
+  LOG_INFO("%ld test channel(s) active", count);
+}
+
+bool Channels::isAnyBusy() {
+  for (uint8_t i = 0; i < channelCount; i++) {
+    if (channels[i].motor.isRunning() || channels[i].motor.isAccelerationTestRunning()) return true;
+  }
+  return false;
+}
+
+bool Channels::isAnyTestRunning() {
+  for (uint8_t i = 0; i < channelCount; i++) {
+    if (channels[i].motor.isAccelerationTestRunning()) return true;
+  }
+  return false;
+}
+
+const char* Channels::getStateName() {
+  if (isAnyTestRunning()) return "testing";
+  if (isAnyBusy()) return "running";
+  return "idle";
+}
+
+unsigned long Channels::getLastResultId() {
+  unsigned long total = 0;
+  for (uint8_t i = 0; i < channelCount; i++) {
+    total += channels[i].motor.getCompletedSequences();
+  }
+  return total;
+}
+
+void Channels::stopAll() {
+  for (uint8_t i = 0; i < channelCount; i++) {
+    channels[i].motor.abortAccelerationTest();
+  }
+}
+
+void Channels::updateRpm() {
+  for (uint8_t i = 0; i < channelCount; i++) {
+    channels[i].rpm.update();
+  }
+}
+
+void Channels::updateMotors() {
+  for (uint8_t i = 0; i < channelCount; i++) {
+    channels[i].motor.updateAccelerationTest();
+  }
+}
@@ -0,0 +1,65 @@
+#ifndef MOTOR_TESTER_CHANNELS_H
+#define MOTOR_TESTER_CHANNELS_H
+
+#include "Hal.h"
+#include "RPMCounter.h"
+#include "MotorController.h"
+
+// Number of motors tested in parallel, each with its own sensor and L298N
+// bridge. The pins of every channel are listed in main.cpp.
+#ifndef TESTER_CHANNELS
+#define TESTER_CHANNELS 1
+#endif
+
+struct ChannelPins {
+  uint8_t sensor;
+  MotorPins motor;
+};
+
+// Everything one tested motor needs, kept together
+struct Channel {
+  RPMCounter rpm;
+  MotorController motor;
+};
+
+// The channel table. Channels live in one static array (no heap, per-channel
+// state contiguous); one EdgeCapture backend feeds every channel's sensor.
+class Channels {
+  public:
+    static const uint8_t MAX_CHANNELS = 3;
+
+    // Sensor edges come from `capture` (see EdgeCapture)
+    static void begin(const ChannelPins* pins, uint8_t count,
+                      EdgeCapture& capture = EdgeCapture::platformDefault());
+    static const EdgeCapture& getCapture() { return *capture; }
+    static uint8_t getCount() { return channelCount; }
+    static Channel& get(uint8_t index) { return channels[index]; }
+
+    // A motor running or an acceleration test active on any channel
+    static bool isAnyBusy();
+    static bool isAnyTestRunning();
+    // "testing" (acceleration test on any channel), "running" (a motor
+    // spinning) or "idle"
+    static const char* getStateName();
+    
+    // Test sequences finished on any channel since boot, which is also the
+    // id of the newest result (0 = none yet)
+    static unsigned long getLastResultId();
+
+    // Abort every test sequence and stop every motor
+    static void stopAll();
+
+    // Scheduler tasks covering every channel
+    static void updateRpm();
+    static void updateMotors();
+
+  private:
+    static Channel channels[MAX_CHANNELS];
+    static uint8_t channelCount;
+    static EdgeCapture* capture;
+};
+
+static_assert(TESTER_CHANNELS >= 1 && TESTER_CHANNELS <= Channels::MAX_CHANNELS,
+              "TESTER_CHANNELS must be between 1 and Channels::MAX_CHANNELS");
+
+#endif
@@ -0,0 +1,197 @@
+#include "ConfigStore.h"
+#include "Logger.h"
+#include "SpeedEstimator.h"
+
+#ifdef ARDUINO
+#include <EEPROM.h>
+#else
+// Native build: an in-memory stand-in with the subset of the EEPROM API used here
+static struct {
+  uint8_t data[256];
+  void begin(size_t) {}
+  uint8_t* getDataPtr() { return data; }
+  template <typename T> void get(int address, T& value) { memcpy(&value, data + address, sizeof(T)); }
+  template <typename T> void put(int address, const T& value) { memcpy(data + address, &value, sizeof(T)); }
+  bool commit() { return true; }
+} EEPROM;
+#endif
+
+TesterConfig ConfigStore::current = ConfigStore::defaults();
+bool ConfigStore::loadedFromStorage = false;
+
+TesterConfig ConfigStore::defaults() {
+  TesterConfig config;
+  memset(&config, 0, sizeof(config));
+
+  // Optical disc: 2mm aperture on 30mm diameter disc = 2.1% duty cycle
+  // Tightened signal length range based on actual measurements to filter multiple apertures
+  config.debounceUs = 10;
+  config.minSignalLengthUs = 600;
+  config.maxSignalLengthUs = 1400;
+  config.minReasonableRpm = 10;
+  config.maxReasonableRpm = 25000;
+
+  config.rpmTargets[0] = 15000;
+  config.rpmTargets[1] = 16000;
+  config.rpmTargets[2] = 17000;
+  config.rpmTargets[3] = 18000;
+  config.pauseMs = 2000;
+  config.timeoutMs = 10000;
+
+  config.minPwm = 50;
+  config.maxPwm = 255;
+  config.pwmFrequencyHz = 1000;
+
+  // About 5us of edge jitter at 15000 RPM; a small motor's spin-up changes
+  // its acceleration by up to ~20000 RPM/s per second, so allow for more
+  config.estimatorNoiseRpm = 20;
+  config.estimatorJerkRpmPerS2 = 50000;
+  config.rotorInertiaGcm2 = 0;
+
+  config.earlyAbortMarginPercent = 5;
+
+  // No divider fitted by default - A0 would just read noise. A 2S pack at
+  // its nominal 7.4 V is the reference supply.
+  config.supplyFullScaleMv = 0;
+  config.nominalSupplyMv = 7400;
+  config.stallSupplyMv = 2300;
+
+  return config;
+}
+
+void ConfigStore::begin() {
+  EEPROM.begin(EEPROM_SIZE);
+
+  TesterConfig config = defaults();
+  const char* error = nullptr;
+  if (load(config) && validate(config, &error)) {
+    current = config;
+    loadedFromStorage = true;
+    LOG_INFO("Configuration v%ld loaded from EEPROM", VERSION);
+  } else {
+    current = defaults();
+    loadedFromStorage = false;
+    LOG_WARN("No valid stored configuration - using defaults");
+  }
+  SpeedEstimator::buildGains(current.estimatorNoiseRpm, current.estimatorJerkRpmPerS2);
+}
+
+bool ConfigStore::load(TesterConfig& config) {
+  Header header;
+  EEPROM.get(0, header);
+
+  if (header.magic != MAGIC || header.version == 0 || header.version > VERSION) {
+    return false;
+  }
+  if (header.size == 0 || header.size > sizeof(TesterConfig) ||
+      sizeof(Header) + header.size > EEPROM_SIZE) {
+    return false;
+  }
+
+  const uint8_t* data = EEPROM.getDataPtr() + sizeof(Header);
+  if (crc32(data, header.size) != header.crc) {
+    return false;
+  }
+
+  // Older versions are a prefix of the current layout; fields they
+  // don't know about keep their defaults
+  memcpy(&config, data, header.size);
+  return true;
+}
+
+bool ConfigStore::save(const TesterConfig& config) {
+  Header header;
+  header.magic = MAGIC;
+  header.version = VERSION;
+  header.size = sizeof(TesterConfig);
+  header.crc = crc32((const uint8_t*)&config, sizeof(TesterConfig));
+
+  EEPROM.put(0, header);
+  EEPROM.put(sizeof(Header), config);
+  return EEPROM.commit();
+}
+
+bool ConfigStore::validate(const TesterConfig& config, const char** error) {
+  const char* message = nullptr;
+
+  if (config.debounceUs > 1000) {
+    message = "debounceUs must be <= 1000";
+  } else if (config.minSignalLengthUs <= config.debounceUs) {
+    message = "minSignalLengthUs must be greater than debounceUs";
+  } else if (config.maxSignalLengthUs <= config.minSignalLengthUs || config.maxSignalLengthUs > 100000) {
+    message = "maxSignalLengthUs must be greater than minSignalLengthUs and <= 100000";
+  } else if (config.minReasonableRpm < 1 || config.maxReasonableRpm <= config.minReasonableRpm ||
+             config.maxReasonableRpm > 100000) {
+    message = "RPM bounds must satisfy 1 <= minReasonableRpm < maxReasonableRpm <= 100000";
+  } else if (config.pauseMs > 60000) {
+    message = "pauseMs must be <= 60000";
+  } else if (config.timeoutMs < 1000 || config.timeoutMs > 120000) {
+    message = "timeoutMs must be between 1000 and 120000";
+  } else if (config.maxPwm > 255 || config.minPwm >= config.maxPwm) {
+    message = "PWM range must satisfy minPwm < maxPwm <= 255";
+  } else if (config.pwmFrequencyHz < 100 || config.pwmFrequencyHz > 40000) {
+    message = "pwmFrequencyHz must be between 100 and 40000";
+  } else if (config.estimatorNoiseRpm < 1 || config.estimatorNoiseRpm > 10000) {
+    message = "estimatorNoiseRpm must be between 1 and 10000";
+  } else if (config.estimatorJerkRpmPerS2 < 1 || config.estimatorJerkRpmPerS2 > 10000000) {
+    message = "estimatorJerkRpmPerS2 must be between 1 and 10000000";
+  } else if (config.rotorInertiaGcm2 > 1000000) {
+    message = "rotorInertiaGcm2 must be <= 1000000";
+  } else if (config.earlyAbortMarginPercent > 50) {
+    message = "earlyAbortMarginPercent must be <= 50";
+  } else if (config.supplyFullScaleMv > 60000) {
+    message = "supplyFullScaleMv must be <= 60000";
+  } else if (config.nominalSupplyMv < 1000 || config.nominalSupplyMv > 60000) {
+    message = "nominalSupplyMv must be between 1000 and 60000";
+  } else if (config.stallSupplyMv >= config.nominalSupplyMv) {
+    message = "stallSupplyMv must be less than nominalSupplyMv";
+  } else {
+    for (int i = 0; i < 4; i++) {
+      if (config.rpmTargets[i] <= config.minReasonableRpm || config.rpmTargets[i] > config.maxReasonableRpm) {
+        message = "rpmTargets must lie within the reasonable RPM bounds";
+        break;
+      }
+    }
+  }
+
+  if (error) *error = message;
+  return message == nullptr;
+}
+
+bool ConfigStore::apply(const TesterConfig& config, const char** error) {
+  if (!validate(config, error)) {
+    return false;
+  }
+
+  // The ISR reads the signal filter fields - swap atomically
+  Hal::disableInterrupts();
+  current = config;
+  Hal::enableInterrupts();
+  // Callers hold Hal::MeasurementLock, so no pulse sees half a table
+  SpeedEstimator::buildGains(current.estimatorNoiseRpm, current.estimatorJerkRpmPerS2);
+
+  if (!save(config)) {
+    if (error) *error = "Configuration applied but could not be written to EEPROM";
+    return false;
+  }
+
+  loadedFromStorage = true;
+  LOG_INFO("Configuration updated and saved");
+  return true;
+}
+
+bool ConfigStore::isLoadedFromStorage() {
+  return loadedFromStorage;
+}
+
+uint32_t ConfigStore::crc32(const uint8_t* data, size_t length) {
+  // Bitwise CRC-32 (IEEE 802.3) - the config is tiny, no table needed
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
@@ -0,0 +1,79 @@
+#ifndef MOTOR_TESTER_CONFIG_STORE_H
+#define MOTOR_TESTER_CONFIG_STORE_H
+
+#include "Hal.h"
+
+// Runtime tuning parameters. This struct is stored byte-for-byte in EEPROM,
+// so it must stay free of padding. Only ever append fields (and bump
+// ConfigStore::VERSION) - older stored versions are migrated by keeping
+// their prefix and defaulting the new fields.
+struct TesterConfig {
+  // RPMCounter signal filtering
+  uint32_t debounceUs;
+  uint32_t minSignalLengthUs;
+  uint32_t maxSignalLengthUs;
+  uint32_t minReasonableRpm;
+  uint32_t maxReasonableRpm;
+
+  // MotorController acceleration test
+  uint32_t rpmTargets[4];
+  uint32_t pauseMs;           // Pause with motor stopped before each target
+  uint32_t timeoutMs;         // Give up on a target after this long
+
+  // MotorController PWM
+  uint16_t minPwm;            // PWM for 1% (overcomes the L298N voltage drop)
+  uint16_t maxPwm;            // PWM for 100%
+  uint32_t pwmFrequencyHz;
+
+  // SpeedEstimator (version 2)
+  uint32_t estimatorNoiseRpm;     // Std deviation of a single interval's RPM
+  uint32_t estimatorJerkRpmPerS2; // Std deviation of the rate of change of acceleration
+  uint32_t rotorInertiaGcm2;      // Rotor + disc, for the torque estimate; 0 = unknown
+
+  // MotorController early abort (version 3)
+  uint32_t earlyAbortMarginPercent; // Give up once the fitted final speed is this far below target; 0 = never
+
+  // SupplyMonitor (version 4)
+  uint32_t supplyFullScaleMv;     // Supply voltage at ADC reading 1023 (divider included); 0 = no sensor on A0
+  uint32_t nominalSupplyMv;       // Test times are also reported normalized to this supply
+  uint32_t stallSupplyMv;         // Supply at which the motor just doesn't turn: L298N drop plus friction
+};
+
+static_assert(sizeof(TesterConfig) == 80, "TesterConfig must not contain padding");
+
+class ConfigStore {
+  public:
+    static const uint16_t VERSION = 4;
+
+    static void begin(); // Load from EEPROM, falling back to defaults
+
+    // Hot-path accessor (used by the ISR): a plain load from static RAM
+    static inline const TesterConfig& get() { return current; }
+
+    static TesterConfig defaults();
+    static bool validate(const TesterConfig& config, const char** error);
+    // Validates, swaps in and persists a new configuration. Call it under
+    // Hal::MeasurementLock: it also rebuilds the estimator gains.
+    static bool apply(const TesterConfig& config, const char** error);
+    static bool isLoadedFromStorage();
+
+  private:
+    struct __attribute__((packed)) Header {
+      uint32_t magic;
+      uint16_t version;
+      uint16_t size;          // sizeof(TesterConfig) when written
+      uint32_t crc;           // CRC-32 over the config bytes
+    };
+
+    static const uint32_t MAGIC = 0x4D544346; // "MTCF"
+    static const size_t EEPROM_SIZE = 256;
+
+    static TesterConfig current;
+    static bool loadedFromStorage;
+
+    static bool load(TesterConfig& config);
+    static bool save(const TesterConfig& config);
+    static uint32_t crc32(const uint8_t* data, size_t length);
+};
+
+#endif
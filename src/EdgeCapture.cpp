@@ -0,0 +1,44 @@
+#include "EdgeCapture.h"
+#include "RPMCounter.h"
+
+#ifdef ESP32
+#include "esp32/McpwmEdgeCapture.h"
+#endif
+
+RPMCounter* GpioEdgeCapture::counters[GpioEdgeCapture::MAX_INPUTS] = {nullptr};
+
+template <uint8_t N>
+void IRAM_ATTR GpioEdgeCapture::isr() {
+  counters[N]->handleSignalChange();
+}
+
+void (*const GpioEdgeCapture::ISRS[GpioEdgeCapture::MAX_INPUTS])() = {
+  isr<0>,
+  isr<1>,
+  isr<2>,
+};
+
+bool GpioEdgeCapture::attach(uint8_t channel, uint8_t pin, RPMCounter* counter) {
+  if (channel >= MAX_INPUTS) return false;
+  counters[channel] = counter;
+
+  // Configure pin as input with pull-up resistor
+  Hal::pinMode(pin, INPUT_PULLUP);
+
+  // Attach single interrupt to handle both edges
+  Hal::attachInterrupt(pin, ISRS[channel], CHANGE);
+  return true;
+}
+
+void GpioEdgeCapture::detach(uint8_t, uint8_t pin) {
+  Hal::detachInterrupt(pin);
+}
+
+EdgeCapture& EdgeCapture::platformDefault() {
+#ifdef ESP32
+  static McpwmEdgeCapture capture;
+#else
+  static GpioEdgeCapture capture;
+#endif
+  return capture;
+}
@@ -0,0 +1,53 @@
+#ifndef MOTOR_TESTER_EDGE_CAPTURE_H
+#define MOTOR_TESTER_EDGE_CAPTURE_H
+
+#include "Hal.h"
+
+class RPMCounter;
+
+// Where a channel's sensor edges come from. A backend timestamps every edge
+// of the sensor pin in Hal::micros() and hands it to the channel's
+// RPMCounter, from interrupt context:
+//  - GpioEdgeCapture: a pin-change interrupt that reads micros() and the
+//    pin itself (RPMCounter::handleSignalChange()). The time is when the
+//    ISR got to run, so interrupt latency shows up as edge jitter.
+//  - McpwmEdgeCapture (ESP32, src/esp32/): the MCPWM capture unit latches
+//    the timer on the edge in hardware; the ISR only converts and forwards
+//    it (RPMCounter::handleCapturedEdge()).
+//  - SimEdgeCapture (native, src/native/): the simulation's model of a
+//    capture unit, so the host scenarios run both kinds of backend.
+class EdgeCapture {
+  public:
+    virtual ~EdgeCapture() {}
+
+    // Start delivering `pin`'s edges to `counter`; false if the backend
+    // can't take this channel or pin
+    virtual bool attach(uint8_t channel, uint8_t pin, RPMCounter* counter) = 0;
+    virtual void detach(uint8_t channel, uint8_t pin) = 0;
+    virtual const char* getName() const = 0; // For /api/channels and the log
+
+    // The backend Channels::begin() uses unless told otherwise: MCPWM capture
+    // on the ESP32, GPIO interrupts everywhere else
+    static EdgeCapture& platformDefault();
+};
+
+// Pin-change interrupt per channel. attachInterrupt() only takes a plain
+// function, so each channel gets its own trampoline, instantiated from a
+// template, that forwards to its RPMCounter.
+class GpioEdgeCapture : public EdgeCapture {
+  public:
+    static const uint8_t MAX_INPUTS = 3;
+
+    bool attach(uint8_t channel, uint8_t pin, RPMCounter* counter) override;
+    void detach(uint8_t channel, uint8_t pin) override;
+    const char* getName() const override { return "gpio"; }
+
+  private:
+    static RPMCounter* counters[MAX_INPUTS];
+
+    template <uint8_t N>
+    static void IRAM_ATTR isr();
+    static void (*const ISRS[MAX_INPUTS])();
+};
+
+#endif
@@ -0,0 +1,130 @@
+#include "EdgeTrace.h"
+
+// Static member definitions
+TraceEvent EdgeTrace::events[EdgeTrace::CAPACITY];
+volatile uint16_t EdgeTrace::count = 0;
+volatile unsigned long EdgeTrace::dropped = 0;
+volatile bool EdgeTrace::recording = false;
+uint32_t EdgeTrace::startMicros = 0;
+uint8_t EdgeTrace::tracedChannel = 0;
+uint32_t EdgeTrace::generation = 0;
+TesterConfig EdgeTrace::config;
+
+void EdgeTrace::start(uint8_t channel, int currentPwm) {
+  Hal::disableInterrupts();
+  recording = false;
+  tracedChannel = channel;
+  count = 0;
+  dropped = 0;
+  startMicros = Hal::micros();
+  config = ConfigStore::get();
+  generation++;
+  Hal::enableInterrupts();
+
+  // The replay needs to know what the motor was doing when capture began
+  append(startMicros, EVENT_PWM, (uint16_t)currentPwm);
+  recording = true;
+}
+
+void EdgeTrace::stop() {
+  recording = false;
+}
+
+void EdgeTrace::recordPwm(uint8_t channel, int pwm) {
+  if (!recording || channel != tracedChannel) return;
+
+  // The ISR appends too
+  Hal::disableInterrupts();
+  append(Hal::micros(), EVENT_PWM, (uint16_t)pwm);
+  Hal::enableInterrupts();
+}
+
+void EdgeTrace::recordTestStart(uint8_t channel) {
+  if (!recording || channel != tracedChannel) return;
+
+  Hal::disableInterrupts();
+  append(Hal::micros(), EVENT_TEST_START, 0);
+  Hal::enableInterrupts();
+}
+
+void IRAM_ATTR EdgeTrace::append(uint32_t timeUs, uint8_t type, uint16_t value) {
+  if (count >= CAPACITY) {
+    dropped++;
+    return;
+  }
+  TraceEvent& event = events[count];
+  event.timeUs = timeUs;
+  event.value = value;
+  event.type = type;
+  event.reserved = 0;
+  count++;
+}
+
+uint16_t EdgeTrace::getLineCount() {
+  return HEADER_LINES + count;
+}
+
+size_t EdgeTrace::formatLine(uint16_t line, char* buffer, size_t size) {
+  int length = 0;
+  switch (line) {
+    case 0:
+      length = snprintf(buffer, size, "# esp-motor-tester edge trace");
+      break;
+    case 1:
+      length = snprintf(buffer, size, "version %u", (unsigned)FORMAT_VERSION);
+      break;
+    case 2:
+      length = snprintf(buffer, size, "channel %u", (unsigned)tracedChannel);
+      break;
+    case 3:
+      length = snprintf(buffer, size,
+                        "config debounceUs=%lu minSignalLengthUs=%lu maxSignalLengthUs=%lu minReasonableRpm=%lu maxReasonableRpm=%lu",
+                        (unsigned long)config.debounceUs, (unsigned long)config.minSignalLengthUs,
+                        (unsigned long)config.maxSignalLengthUs, (unsigned long)config.minReasonableRpm,
+                        (unsigned long)config.maxReasonableRpm);
+      break;
+    case 4:
+      length = snprintf(buffer, size,
+                        "config rpmTarget0=%lu rpmTarget1=%lu rpmTarget2=%lu rpmTarget3=%lu pauseMs=%lu timeoutMs=%lu",
+                        (unsigned long)config.rpmTargets[0], (unsigned long)config.rpmTargets[1],
+                        (unsigned long)config.rpmTargets[2], (unsigned long)config.rpmTargets[3],
+                        (unsigned long)config.pauseMs, (unsigned long)config.timeoutMs);
+      break;
+    case 5:
+      length = snprintf(buffer, size, "config minPwm=%u maxPwm=%u pwmFrequencyHz=%lu",
+                        (unsigned)config.minPwm, (unsigned)config.maxPwm, (unsigned long)config.pwmFrequencyHz);
+      break;
+    case 6:
+      length = snprintf(buffer, size, "config estimatorNoiseRpm=%lu estimatorJerkRpmPerS2=%lu rotorInertiaGcm2=%lu",
+                        (unsigned long)config.estimatorNoiseRpm, (unsigned long)config.estimatorJerkRpmPerS2,
+                        (unsigned long)config.rotorInertiaGcm2);
+      break;
+    case 7:
+      length = snprintf(buffer, size, "config earlyAbortMarginPercent=%lu",
+                        (unsigned long)config.earlyAbortMarginPercent);
+      break;
+    case 8:
+      length = snprintf(buffer, size, "config supplyFullScaleMv=%lu nominalSupplyMv=%lu stallSupplyMv=%lu",
+                        (unsigned long)config.supplyFullScaleMv, (unsigned long)config.nominalSupplyMv,
+                        (unsigned long)config.stallSupplyMv);
+      break;
+    case 9:
+      length = snprintf(buffer, size, "events %u dropped %lu", (unsigned)count, (unsigned long)dropped);
+      break;
+    default: {
+      uint16_t index = line - HEADER_LINES;
+      if (index >= count) return 0;
+      const TraceEvent& event = events[index];
+      unsigned long time = event.timeUs - startMicros; // Wraps correctly
+      if (event.type == EVENT_TEST_START) {
+        length = snprintf(buffer, size, "%c %lu", event.type, time);
+      } else {
+        length = snprintf(buffer, size, "%c %lu %u", event.type, time, (unsigned)event.value);
+      }
+      break;
+    }
+  }
+
+  if (length < 0) return 0;
+  return (size_t)length < size ? (size_t)length : size - 1;
+}
@@ -0,0 +1,90 @@
+#ifndef MOTOR_TESTER_EDGE_TRACE_H
+#define MOTOR_TESTER_EDGE_TRACE_H
+
+#include "Hal.h"
+#include "ConfigStore.h"
+
+// RAM capture of every sensor interrupt (before any filtering), every PWM
+// change and every acceleration test start of one channel, so a run that gave a strange
+// result can be downloaded from /api/trace and replayed on the host through
+// the same RPMCounter / MotorController code (native `replay` command).
+//
+// Capture stops when the buffer is full; later events are only counted.
+// 8 bytes per event - raise EDGE_TRACE_CAPACITY if there is heap to spare.
+#ifndef EDGE_TRACE_CAPACITY
+#define EDGE_TRACE_CAPACITY 1024
+#endif
+
+struct TraceEvent {
+  uint32_t timeUs;  // micros() on the device
+  uint16_t value;   // Pin level (edge) or PWM value
+  uint8_t type;     // EdgeTrace::EventType
+  uint8_t reserved;
+};
+
+// Trace file (text, one record per line, '#' starts a comment):
+//
+//   version 3
+//   channel <n>                     tester channel the capture came from
+//   config <name>=<value> ...       same names as /api/config, every field
+//   events <count> dropped <count>
+//   E <us> <level>                  sensor interrupt, pin level read by the ISR
+//   P <us> <pwm>                    PWM written to the L298N enable pin
+//   T <us>                          acceleration test started
+//
+// Times are microseconds since the capture started. A new TesterConfig field
+// goes into a config line here and into the replay's field table, with a new
+// version: replay rejects config names it doesn't know.
+class EdgeTrace {
+  public:
+    static const uint16_t FORMAT_VERSION = 3;
+    static const uint16_t CAPACITY = EDGE_TRACE_CAPACITY;
+    static const uint8_t LINE_LENGTH = 120;
+
+    enum EventType : uint8_t {
+      EVENT_EDGE = 'E',
+      EVENT_PWM = 'P',
+      EVENT_TEST_START = 'T'
+    };
+
+    // Clear the buffer and start capturing `channel`, whose enable pin is
+    // currently driven with `currentPwm`
+    static void start(uint8_t channel, int currentPwm);
+    static void stop();
+    static bool isRecording() { return recording; }
+    static uint8_t getChannel() { return tracedChannel; }
+    // Bumped by every start(), so a download can tell its trace was replaced
+    static uint32_t getGeneration() { return generation; }
+
+    // Called from the sensor ISR
+    static inline void recordEdge(uint8_t channel, uint32_t timeUs, int level) {
+      if (recording && channel == tracedChannel) append(timeUs, EVENT_EDGE, level ? 1 : 0);
+    }
+    static void recordPwm(uint8_t channel, int pwm);
+    static void recordTestStart(uint8_t channel);
+
+    static uint16_t getCount() { return count; }
+    static unsigned long getDroppedCount() { return dropped; }
+    static const TraceEvent& getEvent(uint16_t index) { return events[index]; }
+
+    // The trace file, one line at a time (without the newline), so it can
+    // be streamed without building it in RAM
+    static uint16_t getLineCount();
+    static size_t formatLine(uint16_t line, char* buffer, size_t size);
+
+  private:
+    static TraceEvent events[CAPACITY];
+    static volatile uint16_t count;
+    static volatile unsigned long dropped;
+    static volatile bool recording;
+    static uint32_t startMicros;
+    static uint8_t tracedChannel;
+    static uint32_t generation;
+    static TesterConfig config; // Snapshot taken when the capture started
+
+    static const uint16_t HEADER_LINES = 10;
+
+    static void IRAM_ATTR append(uint32_t timeUs, uint8_t type, uint16_t value);
+};
+
+#endif
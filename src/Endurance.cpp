@@ -0,0 +1,380 @@
+#include "Endurance.h"
+#include "Logger.h"
+#include "ConfigStore.h"
+
+#include <stdio.h>
+
+// Saved file: header, then every archive's buckets in one block
+struct EnduranceFileHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t bucketSize;
+  uint16_t capacity[Endurance::LEVELS];
+  uint16_t reserved;
+};
+
+static const uint32_t ENDURANCE_MAGIC = 0x4D54454E; // "MTEN"
+static const uint16_t ENDURANCE_FILE_VERSION = 1;
+
+#ifdef ARDUINO
+#include <LittleFS.h>
+
+namespace {
+  const char* FILE_PATH = "/endurance.bin";
+  const char* TEMP_PATH = "/endurance.tmp";
+  bool mounted = false;
+
+  bool mount() {
+    // Formats the partition on first use (the ESP32 core only does when asked)
+#ifdef ESP32
+    if (!mounted) mounted = LittleFS.begin(true);
+#else
+    if (!mounted) mounted = LittleFS.begin();
+#endif
+    return mounted;
+  }
+
+  // Written to a temporary file and renamed, so a reset mid-save keeps the
+  // previous copy
+  bool writeBlocks(const void* const* blocks, const size_t* sizes, uint8_t count) {
+    if (!mount()) return false;
+    File file = LittleFS.open(TEMP_PATH, "w");
+    if (!file) return false;
+    bool ok = true;
+    for (uint8_t i = 0; i < count && ok; i++) {
+      ok = file.write((const uint8_t*)blocks[i], sizes[i]) == sizes[i];
+    }
+    file.close();
+    return ok && LittleFS.rename(TEMP_PATH, FILE_PATH);
+  }
+
+  bool readBlocks(void* const* blocks, const size_t* sizes, uint8_t count) {
+    if (!mount() || !LittleFS.exists(FILE_PATH)) return false;
+    File file = LittleFS.open(FILE_PATH, "r");
+    if (!file) return false;
+    bool ok = true;
+    for (uint8_t i = 0; i < count && ok; i++) {
+      ok = file.read((uint8_t*)blocks[i], sizes[i]) == sizes[i];
+    }
+    file.close();
+    return ok;
+  }
+}
+#else
+// Native build: a RAM stand-in for the file, so save/restore can be checked
+#include <vector>
+
+namespace {
+  std::vector<uint8_t> storedFile;
+
+  bool writeBlocks(const void* const* blocks, const size_t* sizes, uint8_t count) {
+    storedFile.clear();
+    for (uint8_t i = 0; i < count; i++) {
+      const uint8_t* data = (const uint8_t*)blocks[i];
+      storedFile.insert(storedFile.end(), data, data + sizes[i]);
+    }
+    return true;
+  }
+
+  bool readBlocks(void* const* blocks, const size_t* sizes, uint8_t count) {
+    size_t offset = 0;
+    for (uint8_t i = 0; i < count; i++) {
+      if (offset + sizes[i] > storedFile.size()) return false;
+      memcpy(blocks[i], storedFile.data() + offset, sizes[i]);
+      offset += sizes[i];
+    }
+    return true;
+  }
+}
+#endif
+
+// Static member definitions
+const uint32_t Endurance::BUCKET_SECONDS[Endurance::LEVELS] = {1, 60, ENDURANCE_COARSE_SECONDS};
+const uint16_t Endurance::CAPACITY[Endurance::LEVELS] = {
+  ENDURANCE_FINE_BUCKETS, ENDURANCE_MEDIUM_BUCKETS, ENDURANCE_COARSE_BUCKETS
+};
+const uint16_t Endurance::OFFSET[Endurance::LEVELS] = {
+  0, ENDURANCE_FINE_BUCKETS, ENDURANCE_FINE_BUCKETS + ENDURANCE_MEDIUM_BUCKETS
+};
+
+EnduranceBucket Endurance::buckets[Endurance::TOTAL_BUCKETS];
+Endurance::RunState Endurance::state = {0, 0, 0, 0, 0, {0, 0, 0}};
+Endurance::Accumulator Endurance::accumulators[Endurance::LEVELS];
+bool Endurance::active = false;
+bool Endurance::restored = false;
+uint32_t Endurance::runsStarted = 0;
+unsigned long Endurance::secondStartMs = 0;
+unsigned long Endurance::pulseCursor = 0;
+unsigned long Endurance::lostPulses = 0;
+unsigned long Endurance::lastRejectedCount = 0;
+uint32_t Endurance::previousPulseUs = 0;
+bool Endurance::havePrevious = false;
+unsigned long Endurance::saveCount = 0;
+unsigned long Endurance::saveErrors = 0;
+bool Endurance::savePending = false;
+
+void Endurance::begin() {
+  active = false;
+  restored = load();
+  if (restored) {
+    LOG_INFO("Endurance archives restored: ch%ld, %lu s of run time", state.channel, state.runSeconds);
+  }
+}
+
+bool Endurance::start(uint8_t channel, int speedPercent, uint32_t durationMinutes, const char** error) {
+  const char* message = nullptr;
+  if (active) {
+    message = "An endurance run is already active";
+  } else if (channel >= Channels::getCount()) {
+    message = "No such channel";
+  } else if (speedPercent < 1 || speedPercent > 100) {
+    message = "speed must be 1-100";
+  } else if (durationMinutes > MAX_DURATION_MINUTES) {
+    message = "durationMinutes must be <= 10080";
+  } else if (Channels::get(channel).motor.isAccelerationTestRunning()) {
+    message = "Acceleration test running on this channel";
+  }
+  if (message) {
+    if (error) *error = message;
+    return false;
+  }
+
+  memset(buckets, 0, sizeof(buckets));
+  state.channel = channel;
+  state.speedPercent = (uint8_t)speedPercent;
+  state.durationMinutes = durationMinutes;
+  state.runSeconds = 0;
+  for (uint8_t level = 0; level < LEVELS; level++) {
+    state.closed[level] = 0;
+    resetAccumulator(accumulators[level]);
+  }
+
+  const RPMCounter& rpm = Channels::get(channel).rpm;
+  pulseCursor = rpm.getSignalCount();
+  lastRejectedCount = rpm.getRejectedCount();
+  lostPulses = 0;
+  havePrevious = false;
+  secondStartMs = Hal::millis();
+  restored = false;
+  active = true;
+  runsStarted++;
+
+  Channels::get(channel).motor.setSpeed(speedPercent);
+  LOG_INFO("Endurance run started: ch%ld at %ld%% for %lu min (0 = until stopped)",
+           channel, speedPercent, durationMinutes);
+  return true;
+}
+
+void Endurance::stop() {
+  if (!active) return;
+  active = false;
+  Channels::get(state.channel).motor.stop();
+  LOG_INFO("Endurance run stopped after %lu s", state.runSeconds);
+  savePending = true;
+  saveWhenIdle();
+}
+
+void Endurance::update() {
+  if (!active) {
+    saveWhenIdle(); // Final save of a run stopped during a test
+    return;
+  }
+
+  readPulses();
+
+  // Close every whole second that has passed, so a late run of this task
+  // leaves empty buckets rather than shifting the time axis
+  while (Hal::millis() - secondStartMs >= 1000) {
+    secondStartMs += 1000;
+    closeSecond();
+    if (state.runSeconds % PERSIST_INTERVAL_S == 0) savePending = true;
+  }
+
+  if (state.durationMinutes > 0 && state.runSeconds >= state.durationMinutes * 60) {
+    stop(); // Saves
+  } else {
+    saveWhenIdle();
+  }
+}
+
+void Endurance::saveWhenIdle() {
+  // A save stalls the loop that times acceleration tests - hold it back
+  // until none is running
+  if (!savePending || Channels::isAnyTestRunning()) return;
+  savePending = false;
+  save();
+}
+
+void Endurance::readPulses() {
+  RPMCounter& rpm = Channels::get(state.channel).rpm;
+  const TesterConfig& config = ConfigStore::get();
+
+  // Rejections since the last call go to the buckets being filled
+  unsigned long rejectedCount = rpm.getRejectedCount();
+  uint32_t rejected = rejectedCount - lastRejectedCount;
+  lastRejectedCount = rejectedCount;
+
+  uint32_t times[RPMCounter::PULSE_HISTORY];
+  uint8_t count;
+  do {
+    unsigned long lost = 0;
+    count = rpm.readPulses(pulseCursor, times, RPMCounter::PULSE_HISTORY, lost);
+    if (lost > 0) {
+      // No interval across the gap
+      lostPulses += lost;
+      havePrevious = false;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+      if (havePrevious) {
+        uint32_t centiRpm = RPMCounter::intervalToCentiRpm(times[i] - previousPulseUs);
+        // Same plausibility bounds as RPMCounter::update()
+        if (centiRpm >= config.minReasonableRpm * 100UL && centiRpm <= config.maxReasonableRpm * 100UL) {
+          uint32_t wholeRpm = (centiRpm + 50) / 100;
+          addSample(wholeRpm > 0xFFFF ? 0xFFFF : (uint16_t)wholeRpm);
+        } else {
+          rejected++;
+        }
+      }
+      previousPulseUs = times[i];
+      havePrevious = true;
+    }
+  } while (count == RPMCounter::PULSE_HISTORY);
+
+  if (rejected > 0) {
+    for (uint8_t level = 0; level < LEVELS; level++) {
+      accumulators[level].rejected += rejected;
+    }
+  }
+}
+
+void Endurance::addSample(uint16_t rpm) {
+  for (uint8_t level = 0; level < LEVELS; level++) {
+    Accumulator& accumulator = accumulators[level];
+    accumulator.sum += rpm;
+    accumulator.count++;
+    if (rpm < accumulator.minRpm) accumulator.minRpm = rpm;
+    if (rpm > accumulator.maxRpm) accumulator.maxRpm = rpm;
+  }
+}
+
+void Endurance::closeSecond() {
+  state.runSeconds++;
+
+  for (uint8_t level = 0; level < LEVELS; level++) {
+    Accumulator& accumulator = accumulators[level];
+    if (++accumulator.seconds < BUCKET_SECONDS[level]) continue;
+
+    EnduranceBucket& bucket = buckets[OFFSET[level] + state.closed[level] % CAPACITY[level]];
+    if (accumulator.count > 0) {
+      bucket.minRpm = accumulator.minRpm;
+      bucket.meanRpm = (uint16_t)((accumulator.sum + accumulator.count / 2) / accumulator.count);
+      bucket.maxRpm = accumulator.maxRpm;
+    } else {
+      bucket.minRpm = bucket.meanRpm = bucket.maxRpm = 0;
+    }
+    bucket.rejected = accumulator.rejected > 0xFFFF ? 0xFFFF : (uint16_t)accumulator.rejected;
+    state.closed[level]++;
+    resetAccumulator(accumulator);
+  }
+}
+
+void Endurance::resetAccumulator(Accumulator& accumulator) {
+  accumulator.sum = 0;
+  accumulator.count = 0;
+  accumulator.rejected = 0;
+  accumulator.seconds = 0;
+  accumulator.minRpm = 0xFFFF;
+  accumulator.maxRpm = 0;
+}
+
+uint16_t Endurance::getFilled(uint8_t level) {
+  return state.closed[level] < CAPACITY[level] ? (uint16_t)state.closed[level] : CAPACITY[level];
+}
+
+bool Endurance::getBucket(uint8_t level, uint32_t sequence, EnduranceBucket& bucket) {
+  if (sequence >= state.closed[level] || state.closed[level] - sequence > CAPACITY[level]) return false;
+  bucket = buckets[OFFSET[level] + sequence % CAPACITY[level]];
+  return true;
+}
+
+Endurance::ArchiveView Endurance::view(uint8_t level, uint16_t maxBuckets) {
+  ArchiveView archive;
+  archive.level = level < LEVELS ? level : LEVELS - 1;
+  archive.count = getFilled(archive.level);
+  if (maxBuckets > 0 && maxBuckets < archive.count) archive.count = maxBuckets;
+  archive.first = state.closed[archive.level] - archive.count;
+  archive.run = runsStarted;
+  return archive;
+}
+
+size_t Endurance::formatLine(const ArchiveView& archive, uint32_t line, char* buffer, size_t size) {
+  int length;
+  if (line == 0) {
+    length = snprintf(buffer, size,
+                      "{\"level\":%u,\"bucketSeconds\":%lu,\"firstStartSeconds\":%lu,\"count\":%u,\"buckets\":[",
+                      (unsigned)archive.level, (unsigned long)BUCKET_SECONDS[archive.level],
+                      (unsigned long)(archive.first * BUCKET_SECONDS[archive.level]), (unsigned)archive.count);
+  } else if (line <= archive.count) {
+    const char* separator = line < archive.count ? "," : "";
+    EnduranceBucket bucket;
+    // The run may have moved on, or a new one started, while the response streams
+    if (archive.run != runsStarted || !getBucket(archive.level, archive.first + line - 1, bucket)) {
+      length = snprintf(buffer, size, "null%s", separator);
+    } else {
+      length = snprintf(buffer, size, "[%u,%u,%u,%u]%s", (unsigned)bucket.minRpm, (unsigned)bucket.meanRpm,
+                        (unsigned)bucket.maxRpm, (unsigned)bucket.rejected, separator);
+    }
+  } else {
+    length = snprintf(buffer, size, "]}");
+  }
+  if (length < 0) return 0;
+  return (size_t)length < size ? (size_t)length : size - 1;
+}
+
+bool Endurance::save() {
+  EnduranceFileHeader header;
+  header.magic = ENDURANCE_MAGIC;
+  header.version = ENDURANCE_FILE_VERSION;
+  header.bucketSize = sizeof(EnduranceBucket);
+  for (uint8_t level = 0; level < LEVELS; level++) header.capacity[level] = CAPACITY[level];
+  header.reserved = 0;
+
+  const void* blocks[] = {&header, &state, buckets};
+  const size_t sizes[] = {sizeof(header), sizeof(state), sizeof(buckets)};
+  unsigned long startMs = Hal::millis();
+  if (!writeBlocks(blocks, sizes, 3)) {
+    saveErrors++;
+    LOG_WARN("Endurance archives could not be saved");
+    return false;
+  }
+  saveCount++;
+  LOG_DEBUG("Endurance archives saved in %lu ms", Hal::millis() - startMs);
+  return true;
+}
+
+bool Endurance::load() {
+  EnduranceFileHeader header;
+  RunState savedState;
+  void* headerBlock[] = {&header};
+  const size_t headerSize[] = {sizeof(header)};
+  if (!readBlocks(headerBlock, headerSize, 1)) return false;
+
+  // A build with other archive sizes can't use the file
+  if (header.magic != ENDURANCE_MAGIC || header.version != ENDURANCE_FILE_VERSION ||
+      header.bucketSize != sizeof(EnduranceBucket)) {
+    return false;
+  }
+  for (uint8_t level = 0; level < LEVELS; level++) {
+    if (header.capacity[level] != CAPACITY[level]) return false;
+  }
+
+  void* blocks[] = {&header, &savedState, buckets};
+  const size_t sizes[] = {sizeof(header), sizeof(savedState), sizeof(buckets)};
+  if (!readBlocks(blocks, sizes, 3)) {
+    memset(buckets, 0, sizeof(buckets));
+    return false;
+  }
+  state = savedState;
+  return true;
+}
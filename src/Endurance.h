@@ -0,0 +1,158 @@
+#ifndef MOTOR_TESTER_ENDURANCE_H
+#define MOTOR_TESTER_ENDURANCE_H
+
+#include "Hal.h"
+#include "Channels.h"
+
+// Archive lengths in buckets, 8 bytes each. The defaults keep 10 min at 1 s,
+// 24 h at 1 min and 7 days at 10 min: 3048 buckets, about 24 KB of RAM.
+// That is more than the ESP8266 can spare next to WiFi, the async web server
+// and LittleFS, so it keeps 2 min at 1 s, 4 h at 1 min and 7 days at 30 min:
+// 696 buckets, about 5.5 KB.
+#ifdef ARDUINO_ARCH_ESP8266
+#ifndef ENDURANCE_FINE_BUCKETS
+#define ENDURANCE_FINE_BUCKETS 120
+#endif
+#ifndef ENDURANCE_MEDIUM_BUCKETS
+#define ENDURANCE_MEDIUM_BUCKETS 240
+#endif
+#ifndef ENDURANCE_COARSE_BUCKETS
+#define ENDURANCE_COARSE_BUCKETS 336
+#endif
+#ifndef ENDURANCE_COARSE_SECONDS
+#define ENDURANCE_COARSE_SECONDS 1800
+#endif
+#endif
+
+#ifndef ENDURANCE_FINE_BUCKETS
+#define ENDURANCE_FINE_BUCKETS 600
+#endif
+#ifndef ENDURANCE_MEDIUM_BUCKETS
+#define ENDURANCE_MEDIUM_BUCKETS 1440
+#endif
+#ifndef ENDURANCE_COARSE_BUCKETS
+#define ENDURANCE_COARSE_BUCKETS 1008
+#endif
+#ifndef ENDURANCE_COARSE_SECONDS
+#define ENDURANCE_COARSE_SECONDS 600 // Bucket length of the coarse archive
+#endif
+
+// One consolidated interval of an endurance run. A bucket with no pulses
+// (motor stalled) reads 0/0/0.
+struct EnduranceBucket {
+  uint16_t minRpm;
+  uint16_t meanRpm;
+  uint16_t maxRpm;
+  uint16_t rejected;  // Pulses rejected by the filters, saturating
+};
+
+// Burn-in mode: one channel runs at a fixed speed for hours or days and
+// every accepted pulse is consolidated into round-robin archives with
+// increasing bucket length (RRD style). Each pulse updates one accumulator
+// per archive, and a finished bucket overwrites the oldest slot, so a run
+// costs O(1) per pulse and constant memory however long it lasts. Any zoom
+// level can be served straight from RAM.
+//
+// The archives are saved to flash every PERSIST_INTERVAL_S and when the run
+// ends, and restored at boot. A save blocks the loop for a few hundred ms;
+// pulses are kept by the ISR meanwhile and only the 1 s bucket timing is
+// affected. An acceleration test on another channel times its targets in
+// that loop, so saves wait until no test is running.
+class Endurance {
+  public:
+    static const uint8_t LEVELS = 3;
+    static const uint32_t PERSIST_INTERVAL_S = 600;
+    static const uint32_t MAX_DURATION_MINUTES = 7UL * 24 * 60;
+
+    static void begin(); // At boot: restore the last saved run, if any
+    // durationMinutes 0 runs until stop(). Fails if a run or an acceleration
+    // test is active.
+    static bool start(uint8_t channel, int speedPercent, uint32_t durationMinutes, const char** error);
+    static void stop(); // Stops the motor and saves the archives (once no test is running)
+    static void update(); // Scheduler task, every 100 ms
+
+    static bool isActive() { return active; }
+    static bool isRestored() { return restored; } // Archives came from flash, not this boot
+    static uint8_t getChannel() { return state.channel; }
+    static int getSpeed() { return state.speedPercent; }
+    static uint32_t getDurationMinutes() { return state.durationMinutes; }
+    static uint32_t getRunSeconds() { return state.runSeconds; }
+    static unsigned long getLostPulses() { return lostPulses; }
+    static unsigned long getSaveCount() { return saveCount; }
+    static unsigned long getSaveErrors() { return saveErrors; }
+
+    static uint32_t getBucketSeconds(uint8_t level) { return BUCKET_SECONDS[level]; }
+    static uint16_t getCapacity(uint8_t level) { return CAPACITY[level]; }
+    static uint16_t getFilled(uint8_t level);
+    static uint32_t getClosedCount(uint8_t level) { return state.closed[level]; } // Buckets finished this run
+    // Bucket `sequence` (0 = first of the run) of an archive; false once overwritten
+    static bool getBucket(uint8_t level, uint32_t sequence, EnduranceBucket& bucket);
+
+    // The newest buckets of one archive as JSON, one line at a time so the
+    // graph endpoint can stream it:
+    //   {"level":L,"bucketSeconds":S,"firstStartSeconds":T,"count":N,"buckets":[
+    //   [min,mean,max,rejected],      (oldest first, null if overwritten meanwhile)
+    //   ]}
+    struct ArchiveView {
+      uint8_t level;
+      uint32_t first;   // Sequence number of the oldest bucket
+      uint16_t count;
+      uint32_t run;     // Runs started before the view, so a new run reads as null
+    };
+    static const uint8_t LINE_LENGTH = 120;
+    static ArchiveView view(uint8_t level, uint16_t maxBuckets);
+    static uint32_t getLineCount(const ArchiveView& view) { return view.count + 2; }
+    static size_t formatLine(const ArchiveView& view, uint32_t line, char* buffer, size_t size);
+
+  private:
+    // Saved with the archives
+    struct RunState {
+      uint8_t channel;
+      uint8_t speedPercent;
+      uint16_t reserved;
+      uint32_t durationMinutes;
+      uint32_t runSeconds;
+      uint32_t closed[LEVELS]; // Buckets finished per archive; slot = closed % capacity
+    };
+
+    // Bucket being filled, per archive
+    struct Accumulator {
+      uint64_t sum;
+      uint32_t count;
+      uint32_t rejected;
+      uint32_t seconds;
+      uint16_t minRpm;
+      uint16_t maxRpm;
+    };
+
+    static const uint32_t BUCKET_SECONDS[LEVELS];
+    static const uint16_t CAPACITY[LEVELS];
+    static const uint16_t OFFSET[LEVELS];
+    static const uint16_t TOTAL_BUCKETS = ENDURANCE_FINE_BUCKETS + ENDURANCE_MEDIUM_BUCKETS + ENDURANCE_COARSE_BUCKETS;
+
+    static EnduranceBucket buckets[TOTAL_BUCKETS];
+    static RunState state;
+    static Accumulator accumulators[LEVELS];
+    static bool active;
+    static bool restored;
+    static uint32_t runsStarted;
+    static unsigned long secondStartMs;
+    static unsigned long pulseCursor;
+    static unsigned long lostPulses;
+    static unsigned long lastRejectedCount;
+    static uint32_t previousPulseUs;
+    static bool havePrevious;
+    static unsigned long saveCount;
+    static unsigned long saveErrors;
+    static bool savePending;
+
+    static void readPulses();
+    static void addSample(uint16_t rpm);
+    static void closeSecond();
+    static void resetAccumulator(Accumulator& accumulator);
+    static void saveWhenIdle();
+    static bool save();
+    static bool load();
+};
+
+#endif
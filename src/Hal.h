@@ -0,0 +1,183 @@
+#ifndef MOTOR_TESTER_HAL_H
+#define MOTOR_TESTER_HAL_H
+
+// Thin hardware abstraction for the measurement and control code
+// (RPMCounter, MotorController, Scheduler, Logger, LatencyProbe, ConfigStore).
+// On the target every call is an inline forward to the Arduino core, so it
+// costs nothing. The ESP8266 and ESP32 cores differ in a few calls, handled
+// here. The native build (pio run -e native) implements it in
+// src/native/HalNative.cpp on top of a simulated clock, pins and interrupts.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+
+#ifdef ARDUINO
+
+#include <Arduino.h>
+#ifdef ESP32
+#include <esp_timer.h>
+#include <freertos/semphr.h>
+#endif
+
+namespace Hal {
+#ifdef ESP32
+  // The web server runs on the other core, so "interrupts off" must also
+  // keep out the edge capture ISR there: a spinlock it takes as well
+  extern portMUX_TYPE criticalSection;
+  extern SemaphoreHandle_t measurementMutex;
+#endif
+
+  // Clock
+  inline unsigned long micros() { return ::micros(); }
+  inline unsigned long millis() { return ::millis(); }
+#ifdef ESP32
+  inline uint64_t micros64() { return (uint64_t)esp_timer_get_time(); }
+#else
+  inline uint64_t micros64() { return ::micros64(); } // Doesn't wrap after 71 minutes
+#endif
+  inline uint32_t cycleCount() { return ESP.getCycleCount(); }
+  inline uint32_t cpuFreqMHz() { return ESP.getCpuFreqMHz(); }
+  inline void delay(unsigned long ms) { ::delay(ms); }
+  inline void delayMicroseconds(unsigned int us) { ::delayMicroseconds(us); }
+  inline void yield() { ::yield(); } // Feeds the ESP8266 software watchdog from loop()
+#ifdef ESP32
+  // The scheduler's wait between tasks. Blocks on a timer instead of
+  // spinning, so core 1's idle task (task watchdog, freed-task cleanup)
+  // gets the time; only the last few microseconds are a busy-wait.
+  void sleepMicros(unsigned long us);
+#else
+  // The scheduler's wait between tasks. delay() yields to the WiFi stack,
+  // so waits of 2 ms or more use it (rounded down to whole milliseconds).
+  inline void sleepMicros(unsigned long us) {
+    if (us >= 2000) ::delay(us / 1000);
+    else ::delayMicroseconds(us);
+  }
+#endif
+
+  // GPIO
+  inline void pinMode(uint8_t pin, uint8_t mode) { ::pinMode(pin, mode); }
+  inline int digitalRead(uint8_t pin) { return ::digitalRead(pin); }
+  inline void digitalWrite(uint8_t pin, uint8_t value) { ::digitalWrite(pin, value); }
+
+  // ADC (A0 only on the ESP8266, 0-1023; the ESP32's 12 bits are scaled down)
+#ifdef ESP32
+  inline int analogRead(uint8_t pin) { return ::analogRead(pin) >> 2; }
+#else
+  inline int analogRead(uint8_t pin) { return ::analogRead(pin); }
+#endif
+
+  // PWM, 0-255 on both (LEDC behind analogWrite on the ESP32)
+  inline void analogWrite(uint8_t pin, int value) { ::analogWrite(pin, value); }
+#ifdef ESP32
+  inline void analogWriteFreq(uint32_t frequency) { ::analogWriteFrequency(frequency); }
+#else
+  inline void analogWriteFreq(uint32_t frequency) { ::analogWriteFreq(frequency); }
+#endif
+
+  // Interrupts
+  inline void attachInterrupt(uint8_t pin, void (*handler)(void), int mode) {
+    ::attachInterrupt(digitalPinToInterrupt(pin), handler, mode);
+  }
+  inline void detachInterrupt(uint8_t pin) { ::detachInterrupt(digitalPinToInterrupt(pin)); }
+#ifdef ESP32
+  inline void disableInterrupts() { portENTER_CRITICAL(&criticalSection); }
+  inline void enableInterrupts() { portEXIT_CRITICAL(&criticalSection); }
+#else
+  inline void disableInterrupts() { noInterrupts(); }
+  inline void enableInterrupts() { interrupts(); }
+#endif
+
+  // Held while a measurement task runs and by web handlers that touch
+  // measurement or motor state. On the ESP8266 the web server only runs
+  // between loop() passes, so there is nothing to lock; on the ESP32 it
+  // runs on the other core. Web handlers pass a timeout and answer 503
+  // when isHeld() is false instead of stalling the async server.
+  class MeasurementLock {
+    public:
+#ifdef ESP32
+      MeasurementLock() : held(xSemaphoreTakeRecursive(measurementMutex, portMAX_DELAY) == pdTRUE) {}
+      explicit MeasurementLock(uint32_t timeoutMs)
+        : held(xSemaphoreTakeRecursive(measurementMutex, pdMS_TO_TICKS(timeoutMs)) == pdTRUE) {}
+      ~MeasurementLock() { if (held) xSemaphoreGiveRecursive(measurementMutex); }
+      bool isHeld() const { return held; }
+    private:
+      bool held;
+#else
+      MeasurementLock() {}
+      explicit MeasurementLock(uint32_t) {}
+      bool isHeld() const { return true; }
+#endif
+  };
+
+  // Console (non-blocking writes only)
+  inline int consoleAvailableForWrite() { return Serial.availableForWrite(); }
+  inline void consoleWrite(const uint8_t* data, size_t length) { Serial.write(data, length); }
+}
+
+#else // Native host build
+
+#define IRAM_ATTR
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0x00
+#define INPUT_PULLUP 0x02
+#define OUTPUT 0x01
+#define CHANGE 3
+
+// NodeMCU pin names mapped to their ESP8266 GPIO numbers
+#define D0 16
+#define D1 5
+#define D2 4
+#define D3 0
+#define D4 2
+#define D5 14
+#define D6 12
+#define D7 13
+#define D8 15
+#define A0 17
+
+#include "native/WString.h" // Arduino String for the shared JSON builders
+
+namespace Hal {
+  unsigned long micros();
+  unsigned long millis();
+  uint64_t micros64();
+  uint32_t cycleCount();
+  uint32_t cpuFreqMHz();
+  void delay(unsigned long ms);
+  void delayMicroseconds(unsigned int us);
+  void sleepMicros(unsigned long us); // Same rounding as the ESP8266
+  void yield();
+
+  void pinMode(uint8_t pin, uint8_t mode);
+  int digitalRead(uint8_t pin);
+  void digitalWrite(uint8_t pin, uint8_t value);
+
+  int analogRead(uint8_t pin);
+
+  void analogWrite(uint8_t pin, int value);
+  void analogWriteFreq(uint32_t frequency);
+
+  void attachInterrupt(uint8_t pin, void (*handler)(void), int mode);
+  void detachInterrupt(uint8_t pin);
+  void disableInterrupts();
+  void enableInterrupts();
+
+  // Single-threaded simulation, nothing to lock
+  class MeasurementLock {
+    public:
+      MeasurementLock() {}
+      explicit MeasurementLock(uint32_t) {}
+      bool isHeld() const { return true; }
+  };
+
+  int consoleAvailableForWrite();
+  void consoleWrite(const uint8_t* data, size_t length);
+}
+
+#endif
+
+#endif
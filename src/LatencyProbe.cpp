@@ -0,0 +1,81 @@
+#include "LatencyProbe.h"
+
+LatencyProbe::Stats LatencyProbe::stats[PROBE_COUNT];
+
+static const char* const PROBE_NAMES[PROBE_COUNT] = {
+  "isr",
+  "rpmUpdate",
+  "accelerationUpdate",
+  "loop",
+  "web:/",
+  "web:/api/rpm",
+  "web:/api/motor",
+  "web:/api/motor/speed",
+  "web:/api/status",
+  "web:/api/scheduler",
+  "web:/api/motor/acceleration-test",
+  "web:/api/latency"
+};
+
+// Limits for the measurement path. The ISR must finish well inside the
+// 600us minimum pulse length; update tasks must fit their scheduler budget.
+static const uint32_t PROBE_LIMITS_US[PROBE_COUNT] = {
+  50,   // isr
+  100,  // rpmUpdate
+  200,  // accelerationUpdate
+  0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+void IRAM_ATTR LatencyProbe::record(uint8_t id, uint32_t cycles) {
+  Stats& s = stats[id];
+
+  if (s.count == 0 || cycles < s.minCycles) s.minCycles = cycles;
+  if (cycles > s.maxCycles) s.maxCycles = cycles;
+  s.totalCycles += cycles;
+  s.count++;
+
+  // log2 bucket: index of the highest set bit, found with shifts and
+  // compares like SensorDiagnostics::binOf() - __builtin_clz is a libgcc
+  // call on the ESP8266 that may not be in IRAM
+  uint32_t value = cycles;
+  uint8_t bucket = 0;
+  if (value >= 1UL << 16) { value >>= 16; bucket += 16; }
+  if (value >= 1UL << 8) { value >>= 8; bucket += 8; }
+  if (value >= 1UL << 4) { value >>= 4; bucket += 4; }
+  if (value >= 1UL << 2) { value >>= 2; bucket += 2; }
+  if (value >= 1UL << 1) { bucket += 1; }
+  if (bucket >= HISTOGRAM_BUCKETS) bucket = HISTOGRAM_BUCKETS - 1;
+  s.histogram[bucket]++;
+}
+
+const char* LatencyProbe::getName(uint8_t id) {
+  return id < PROBE_COUNT ? PROBE_NAMES[id] : "unknown";
+}
+
+const LatencyProbe::Stats& LatencyProbe::getStats(uint8_t id) {
+  return stats[id];
+}
+
+uint32_t LatencyProbe::getLimitMicros(uint8_t id) {
+  return id < PROBE_COUNT ? PROBE_LIMITS_US[id] : 0;
+}
+
+bool LatencyProbe::isOverLimit(uint8_t id) {
+  uint32_t limit = getLimitMicros(id);
+  return limit > 0 && stats[id].count > 0 && cyclesToMicros(stats[id].maxCycles) > limit;
+}
+
+bool LatencyProbe::isMeasurementPathAtRisk() {
+  return isOverLimit(PROBE_ISR) || isOverLimit(PROBE_RPM_UPDATE) || isOverLimit(PROBE_ACCEL_UPDATE);
+}
+
+uint32_t LatencyProbe::cyclesToMicros(uint32_t cycles) {
+  return cycles / Hal::cpuFreqMHz();
+}
+
+void LatencyProbe::reset() {
+  // Keep the ISR from writing its slot while it is cleared
+  Hal::disableInterrupts();
+  memset(stats, 0, sizeof(stats));
+  Hal::enableInterrupts();
+}
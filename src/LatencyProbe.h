@@ -0,0 +1,76 @@
+#ifndef MOTOR_TESTER_LATENCY_PROBE_H
+#define MOTOR_TESTER_LATENCY_PROBE_H
+
+#include "Hal.h"
+
+// Cycle-count probes around the ISR, the measurement path and the web handlers.
+// Build with -DLATENCY_PROBES=0 to compile every probe out.
+#ifndef LATENCY_PROBES
+#define LATENCY_PROBES 1
+#endif
+
+enum ProbeId : uint8_t {
+  PROBE_ISR = 0,
+  PROBE_RPM_UPDATE,
+  PROBE_ACCEL_UPDATE,
+  PROBE_LOOP,
+  PROBE_WEB_ROOT,
+  PROBE_WEB_RPM,
+  PROBE_WEB_MOTOR,
+  PROBE_WEB_SPEED,
+  PROBE_WEB_STATUS,
+  PROBE_WEB_SCHEDULER,
+  PROBE_WEB_ACCEL_TEST,
+  PROBE_WEB_LATENCY,
+  PROBE_COUNT
+};
+
+class LatencyProbe {
+  public:
+    // Bucket n counts samples in [2^n, 2^(n+1)) cycles; the last bucket is open-ended
+    static const uint8_t HISTOGRAM_BUCKETS = 24;
+
+    struct Stats {
+      uint32_t count;
+      uint32_t minCycles;
+      uint32_t maxCycles;
+      uint64_t totalCycles;
+      uint32_t histogram[HISTOGRAM_BUCKETS];
+    };
+
+    static inline uint32_t now() { return Hal::cycleCount(); }
+    static void IRAM_ATTR record(uint8_t id, uint32_t cycles);
+
+    static const char* getName(uint8_t id);
+    static const Stats& getStats(uint8_t id);
+    static uint32_t getLimitMicros(uint8_t id); // 0 = no limit
+    static bool isOverLimit(uint8_t id);
+    static bool isMeasurementPathAtRisk(); // Any measurement-path probe over its limit
+    static uint32_t cyclesToMicros(uint32_t cycles);
+    static void reset();
+
+  private:
+    static Stats stats[PROBE_COUNT];
+};
+
+// Records the cycles spent between construction and destruction
+class LatencyScope {
+  public:
+    inline __attribute__((always_inline)) explicit LatencyScope(uint8_t id)
+      : id(id), start(LatencyProbe::now()) {}
+    inline __attribute__((always_inline)) ~LatencyScope() {
+      LatencyProbe::record(id, LatencyProbe::now() - start);
+    }
+
+  private:
+    uint8_t id;
+    uint32_t start;
+};
+
+#if LATENCY_PROBES
+#define LATENCY_PROBE(id) LatencyScope latencyScope_(id)
+#else
+#define LATENCY_PROBE(id) do {} while (0)
+#endif
+
+#endif
@@ -0,0 +1,83 @@
+#include "Logger.h"
+
+// Static member definitions
+LogRecord Logger::records[Logger::CAPACITY];
+uint32_t Logger::nextSequence = 0;
+uint32_t Logger::serialSequence = 0;
+unsigned long Logger::droppedCount = 0;
+
+void Logger::append(uint8_t level, const char* format, const long* values) {
+  LogRecord& record = records[nextSequence % CAPACITY];
+  record.timestamp = Hal::millis();
+  record.format = format;
+  record.level = level;
+  memcpy(record.args, values, sizeof(record.args));
+  nextSequence++;
+}
+
+void Logger::drain() {
+  // Serial fell behind by more than the ring holds - skip what was overwritten
+  if (nextSequence - serialSequence > CAPACITY) {
+    droppedCount += (nextSequence - serialSequence) - CAPACITY;
+    serialSequence = nextSequence - CAPACITY;
+  }
+
+  char line[LINE_LENGTH];
+  while (serialSequence != nextSequence) {
+    size_t length = format(records[serialSequence % CAPACITY], line, sizeof(line) - 2);
+    line[length++] = '\r';
+    line[length++] = '\n';
+
+    // Never block: leave the record for the next run if the UART FIFO is full
+    if ((size_t)Hal::consoleAvailableForWrite() < length) {
+      return;
+    }
+
+    Hal::consoleWrite((const uint8_t*)line, length);
+    serialSequence++;
+  }
+}
+
+uint32_t Logger::getNextSequence() {
+  return nextSequence;
+}
+
+uint32_t Logger::getOldestSequence() {
+  return nextSequence > CAPACITY ? nextSequence - CAPACITY : 0;
+}
+
+bool Logger::getRecord(uint32_t sequence, LogRecord& record) {
+  if (sequence >= nextSequence || sequence < getOldestSequence()) {
+    return false;
+  }
+  record = records[sequence % CAPACITY];
+  return true;
+}
+
+size_t Logger::format(const LogRecord& record, char* buffer, size_t size) {
+  int prefix = snprintf(buffer, size, "[%c %lu] ", levelChar(record.level), (unsigned long)record.timestamp);
+  if (prefix < 0 || (size_t)prefix >= size) {
+    return size > 0 ? size - 1 : 0;
+  }
+
+  int body = snprintf(buffer + prefix, size - prefix, record.format,
+                      record.args[0], record.args[1], record.args[2], record.args[3]);
+  if (body < 0) body = 0;
+
+  size_t length = prefix + body;
+  return length < size ? length : size - 1;
+}
+
+unsigned long Logger::getDroppedCount() {
+  return droppedCount;
+}
+
+char Logger::levelChar(uint8_t level) {
+  switch (level) {
+    case LOG_LEVEL_DEBUG: return 'D';
+    case LOG_LEVEL_INFO:  return 'I';
+    case LOG_LEVEL_WARN:  return 'W';
+    case LOG_LEVEL_ERROR: return 'E';
+    default:              return '?';
+  }
+}
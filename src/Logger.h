@@ -0,0 +1,88 @@
+#ifndef MOTOR_TESTER_LOGGER_H
+#define MOTOR_TESTER_LOGGER_H
+
+#include "Hal.h"
+
+// Log levels. Calls below LOG_MIN_LEVEL are compiled out, e.g. build with
+// -DLOG_MIN_LEVEL=2 to keep only warnings and errors.
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO  1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_ERROR 3
+
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_LEVEL_INFO
+#endif
+
+// One log entry as stored in RAM. Only the pointer to the (static) format
+// string and the raw integer arguments are captured; formatting happens
+// later in the low-priority drain task.
+struct LogRecord {
+  uint32_t timestamp;   // millis()
+  const char* format;   // Must point to a string literal
+  long args[4];
+  uint8_t level;
+};
+
+// Non-blocking logger: callers append a compact record to a RAM ring buffer,
+// Logger::drain() (a scheduler task) formats records and writes them to
+// Serial only as fast as the UART FIFO accepts them. Recent records can
+// also be fetched over /api/log. Not ISR-safe - call from loop/handler context.
+class Logger {
+  public:
+    static const uint8_t MAX_ARGS = 4;
+    static const uint16_t CAPACITY = 64; // Records kept in RAM
+    static const uint8_t LINE_LENGTH = 120;
+
+    template <typename... Args>
+    static void log(uint8_t level, const char* format, Args... args) {
+      static_assert(sizeof...(Args) <= MAX_ARGS, "Logger supports at most 4 arguments");
+      long values[MAX_ARGS] = { static_cast<long>(args)... };
+      append(level, format, values);
+    }
+
+    static void drain(); // Scheduler task: flush pending records to Serial
+
+    // Access for /api/log. Sequence numbers increase monotonically;
+    // records older than getNextSequence() - CAPACITY have been overwritten.
+    static uint32_t getNextSequence();
+    static uint32_t getOldestSequence();
+    static bool getRecord(uint32_t sequence, LogRecord& record);
+    static size_t format(const LogRecord& record, char* buffer, size_t size);
+    static unsigned long getDroppedCount(); // Records overwritten before Serial drained them
+    static char levelChar(uint8_t level);
+
+  private:
+    static LogRecord records[CAPACITY];
+    static uint32_t nextSequence;
+    static uint32_t serialSequence;
+    static unsigned long droppedCount;
+
+    static void append(uint8_t level, const char* format, const long* values);
+};
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) Logger::log(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do { if (0) Logger::log(LOG_LEVEL_DEBUG, __VA_ARGS__); } while (0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) Logger::log(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) do { if (0) Logger::log(LOG_LEVEL_INFO, __VA_ARGS__); } while (0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(...) Logger::log(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) do { if (0) Logger::log(LOG_LEVEL_WARN, __VA_ARGS__); } while (0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) Logger::log(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) do { if (0) Logger::log(LOG_LEVEL_ERROR, __VA_ARGS__); } while (0)
+#endif
+
+#endif
@@ -1,26 +1,59 @@
 #include "MDNSService.h"
+#include "NetworkService.h"
+#include "Channels.h"
+#include "Version.h"
+
+const char* MDNSService::SERVICE_NAME = "motor-tester";
 
 bool MDNSService::isStarted = false;
+#ifdef ESP32
+bool MDNSService::testerService = false;
+#else
+MDNSResponder::hMDNSService MDNSService::testerService = nullptr;
+#endif
+const char* MDNSService::publishedState = nullptr;
+unsigned long MDNSService::publishedResultId = 0;
 
 void MDNSService::begin() {
   if (isStarted) return;
   
-  if (!MDNS.begin("esp-racepi-motor-tester")) {
+  const char* hostname = NetworkService::getHostname();
+  if (!MDNS.begin(hostname)) {
     Serial.println("Error setting up MDNS responder!");
     return;
   }
   
-  Serial.println("mDNS responder started: esp-racepi-motor-tester.local");
+  Serial.printf("mDNS responder started: %s.local\n", hostname);
   
   // Add HTTP service
   MDNS.addService("http", "tcp", 80);
   
+  // Status service for discovery - the static values never change
+  testerService = MDNS.addService(SERVICE_NAME, "tcp", 80);
+  if (testerService) {
+    addTxt("fw", FIRMWARE_VERSION);
+    addTxt("channels", String(Channels::getCount()).c_str());
+    publishStatus();
+  }
+  
   isStarted = true;
 }
 
 void MDNSService::update() {
-  if (isStarted) {
-    MDNS.update();
+  if (!isStarted) return;
+  
+#ifndef ESP32
+  MDNS.update();
+#endif
+  
+  // Re-announce only on a change, so an idle fleet stays quiet. Runs outside
+  // the scheduler's lock, so take it just for the channel state.
+  Hal::MeasurementLock lock;
+  if (testerService && (Channels::getStateName() != publishedState || Channels::getLastResultId() != publishedResultId)) {
+    publishStatus();
+#ifndef ESP32
+    MDNS.announce();
+#endif
   }
 }
 
@@ -28,4 +61,22 @@ void MDNSService::addService(const char* service, const char* proto, uint16_t po
   if (isStarted) {
     MDNS.addService(service, proto, port);
   }
-}
\ No newline at end of file
+}
+
+void MDNSService::publishStatus() {
+  publishedState = Channels::getStateName();
+  publishedResultId = Channels::getLastResultId();
+  
+  // Adding an existing key replaces its value
+  addTxt("state", publishedState);
+  addTxt("result", String(publishedResultId).c_str());
+}
+
+void MDNSService::addTxt(const char* key, const char* value) {
+#ifdef ESP32
+  // ESPmDNS looks services up by name instead of a handle
+  MDNS.addServiceTxt(SERVICE_NAME, "tcp", key, value);
+#else
+  MDNS.addServiceTxt(testerService, key, value);
+#endif
+}
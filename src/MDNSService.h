@@ -1,16 +1,43 @@
 #ifndef MDNS_SERVICE_H
 #define MDNS_SERVICE_H
 
+#ifdef ESP32
+#include <ESPmDNS.h>
+#else
 #include <ESP8266mDNS.h>
+#endif
 
+// mDNS responder on the per-board hostname (NetworkService::getHostname()).
+// Besides http/tcp, every tester advertises a _motor-tester._tcp service
+// whose TXT record carries its status, so a fleet dashboard can find all
+// testers and see which are idle by browsing, without polling each board:
+//
+//   fw=<version>  channels=<n>  state=idle|running|testing  result=<id>
+//
+// state is Channels::getStateName() and result Channels::getLastResultId() -
+// when it changes, fetch /api/channels for the new target times.
+// The TXT record is re-announced only when a value changes. (The ESP32's
+// responder runs in its own task and sends the update itself.)
 class MDNSService {
   public:
+    static const char* SERVICE_NAME; // "motor-tester"
+
     static void begin();
     static void update();
     static void addService(const char* service, const char* proto, uint16_t port);
     
   private:
     static bool isStarted;
+#ifdef ESP32
+    static bool testerService;
+#else
+    static MDNSResponder::hMDNSService testerService;
+#endif
+    static const char* publishedState;
+    static unsigned long publishedResultId;
+    
+    static void publishStatus();
+    static void addTxt(const char* key, const char* value);
 };
 
-#endif
\ No newline at end of file
+#endif
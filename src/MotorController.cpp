@@ -1,51 +1,40 @@
 #include "MotorController.h"
 #include "RPMCounter.h"
+#include "LatencyProbe.h"
+#include "Logger.h"
+#include "ConfigStore.h"
+#include "EdgeTrace.h"
 
-// Static member definitions
-int MotorController::currentSpeed = 0;
-bool MotorController::motorRunning = false;
-unsigned long MotorController::lastUpdateTime = 0;
-bool MotorController::accelerationTestActive = false;
-unsigned long MotorController::testStartTime = 0;
-unsigned long MotorController::testCompletionTime = 0;
-float MotorController::targetRPM = 0.0;
-bool MotorController::targetRPMReached = false;
-
-// Multi-test sequence variables
-const float MotorController::RPM_TARGETS[4] = {15000.0, 16000.0, 17000.0, 18000.0};
-int MotorController::currentTestIndex = 0;
-unsigned long MotorController::targetTimes[4] = {0, 0, 0, 0};
-bool MotorController::allTestsComplete = false;
-bool MotorController::waitingBetweenTests = false;
-unsigned long MotorController::pauseStartTime = 0;
-
-void MotorController::begin() {
+void MotorController::begin(uint8_t channelIndex, const MotorPins& motorPins, RPMCounter* counter) {
+  channel = channelIndex;
+  pins = motorPins;
+  rpm = counter;
+  accelerationTestActive = false;
+  
   // Initialize the motor control pins
-  pinMode(IN3_PIN, OUTPUT);
-  pinMode(IN4_PIN, OUTPUT);
-  pinMode(ENB_PIN, OUTPUT);
+  Hal::pinMode(pins.in1, OUTPUT);
+  Hal::pinMode(pins.in2, OUTPUT);
+  Hal::pinMode(pins.enable, OUTPUT);
   
   // Set PWM frequency for motor control (higher frequency for smoother operation)
   // ESP8266 default is 1000Hz, motors typically work better with 10-20kHz
-  analogWriteFreq(1000); // 10kHz PWM frequency
+  applyConfig();
   
   // Stop motor initially
   stop();
   
-  Serial.println("Motor Controller initialized");
-  Serial.println("L298N connections:");
-  Serial.println("  IN3 -> D1");
-  Serial.println("  IN4 -> D2");
-  Serial.println("  ENB -> D3 (PWM)");
-  Serial.println("  Motor: OUT3(+) and OUT4(-)");
+  LOG_INFO("ch%ld: Motor Controller initialized", channel);
+  LOG_INFO("ch%ld: L298N connections: IN1 -> GPIO%ld, IN2 -> GPIO%ld, EN -> GPIO%ld (PWM)",
+           channel, pins.in1, pins.in2, pins.enable);
 }
 
 void MotorController::setSpeed(int percentage) {
   // Clamp percentage to valid range
-  percentage = constrain(percentage, 0, 100);
+  if (percentage < 0) percentage = 0;
+  if (percentage > 100) percentage = 100;
   
   currentSpeed = percentage;
-  lastUpdateTime = millis();
+  lastUpdateTime = Hal::millis();
   
   if (percentage == 0) {
     stop();
@@ -54,55 +43,52 @@ void MotorController::setSpeed(int percentage) {
     updateMotor();
   }
   
-  Serial.print("Motor speed set to: ");
-  Serial.print(percentage);
-  Serial.print("% (PWM: ");
-  Serial.print(speedToPWM(percentage));
-  Serial.println(")");
+  LOG_INFO("ch%ld: motor speed set to: %ld%% (PWM: %ld)", channel, percentage, speedToPWM(percentage));
 }
 
 void MotorController::stop() {
   currentSpeed = 0;
   motorRunning = false;
-  lastUpdateTime = millis();
+  lastUpdateTime = Hal::millis();
   
   // Stop the motor by setting both direction pins LOW
-  digitalWrite(IN3_PIN, LOW);
-  digitalWrite(IN4_PIN, LOW);
-  analogWrite(ENB_PIN, 0);
+  Hal::digitalWrite(pins.in1, LOW);
+  Hal::digitalWrite(pins.in2, LOW);
+  Hal::analogWrite(pins.enable, 0);
+  EdgeTrace::recordPwm(channel, 0);
   
-  Serial.println("Motor stopped");
+  LOG_INFO("ch%ld: motor stopped", channel);
 }
 
-int MotorController::getCurrentSpeed() {
+int MotorController::getCurrentSpeed() const {
   return currentSpeed;
 }
 
-bool MotorController::isRunning() {
+int MotorController::getCurrentPwm() const {
+  return motorRunning ? speedToPWM(currentSpeed) : 0;
+}
+
+bool MotorController::isRunning() const {
   return motorRunning;
 }
 
-unsigned long MotorController::getLastUpdateTime() {
+unsigned long MotorController::getLastUpdateTime() const {
   return lastUpdateTime;
 }
 
 void MotorController::updateMotor() {
   if (motorRunning && currentSpeed > 0) {
     // Set direction for forward rotation
-    // IN3 = HIGH, IN4 = LOW for forward direction
-    digitalWrite(IN3_PIN, HIGH);
-    digitalWrite(IN4_PIN, LOW);
+    // IN1 = HIGH, IN2 = LOW for forward direction
+    Hal::digitalWrite(pins.in1, HIGH);
+    Hal::digitalWrite(pins.in2, LOW);
     
     // Set PWM speed
     int pwmValue = speedToPWM(currentSpeed);
-    analogWrite(ENB_PIN, pwmValue);
+    Hal::analogWrite(pins.enable, pwmValue);
+    EdgeTrace::recordPwm(channel, pwmValue);
     
-    Serial.print("Motor running: ");
-    Serial.print(currentSpeed);
-    Serial.print("% -> PWM: ");
-    Serial.print(pwmValue);
-    Serial.print(" (IN3=HIGH, IN4=LOW, ENB=PWM)");
-    Serial.println();
+    LOG_DEBUG("ch%ld: motor running: %ld%% -> PWM: %ld (IN1=HIGH, IN2=LOW, EN=PWM)", channel, currentSpeed, pwmValue);
   }
 }
 
@@ -117,10 +103,8 @@ int MotorController::speedToPWM(int percentage) {
   // L298N has voltage drop (~1.4-2V), so we need higher PWM for same effective voltage
   // Map 1-100% to a higher PWM range to compensate
   // Minimum PWM value to overcome L298N voltage drop
-  int minPWM = 50;  // Start motor movement
-  int maxPWM = 255; // Full speed
-  
-  return map(percentage, 1, 100, minPWM, maxPWM);
+  const TesterConfig& config = ConfigStore::get();
+  return config.minPwm + (percentage - 1) * (config.maxPwm - config.minPwm) / 99;
 }
 
 void MotorController::startAccelerationTest() {
@@ -140,31 +124,45 @@ void MotorController::startAccelerationTest() {
   pauseStartTime = 0;
   for (int i = 0; i < 4; i++) {
     targetTimes[i] = 0;
+    spinUpModels[i] = SpinUpModel{0, 0, 0, 0, false};
+    testSupply[i] = SupplyStats{0, 0, 0, 0};
   }
   
   // Start with first target RPM
-  targetRPM = RPM_TARGETS[0];
+  const TesterConfig& config = ConfigStore::get();
+  targetRPM = config.rpmTargets[0];
   
   // Record start time for the 2-second pause before first test
-  testStartTime = millis();
+  testStartTime = Hal::millis();
+  EdgeTrace::recordTestStart(channel);
   
-  Serial.println("=== MULTI-TEST ACCELERATION SEQUENCE STARTED ===");
-  Serial.println("Tests: 0->15k, 0->16k, 0->17k, 0->18k RPM");
-  Serial.println("Each test: 2s pause + 0% -> 100% -> target RPM");
-  Serial.print("Test 1/4: Target ");
-  Serial.print(targetRPM);
-  Serial.println(" RPM");
-  Serial.println("Motor: Stopping for 2s...");
+  LOG_INFO("=== ch%ld: MULTI-TEST ACCELERATION SEQUENCE STARTED ===", channel);
+  LOG_INFO("Tests: 0->%lu, 0->%lu, 0->%lu, 0->%lu RPM",
+           config.rpmTargets[0], config.rpmTargets[1], config.rpmTargets[2], config.rpmTargets[3]);
+  LOG_INFO("Each test: %lu ms pause + 0%% -> 100%% -> target RPM", config.pauseMs);
+  LOG_INFO("ch%ld: test 1/4: Target %ld RPM", channel, (long)targetRPM);
+  LOG_INFO("ch%ld: motor stopping for %lu ms...", channel, config.pauseMs);
+}
+
+void MotorController::abortAccelerationTest() {
+  if (accelerationTestActive) {
+    accelerationTestActive = false;
+    LOG_WARN("ch%ld: acceleration test aborted during test %ld/4", channel, currentTestIndex + 1);
+    SupplyMonitor::stopCapture(channel);
+  }
+  stop();
 }
 
-bool MotorController::isAccelerationTestRunning() {
+bool MotorController::isAccelerationTestRunning() const {
   return accelerationTestActive;
 }
 
 void MotorController::updateAccelerationTest() {
+  LATENCY_PROBE(PROBE_ACCEL_UPDATE);
   if (!accelerationTestActive) return;
   
-  unsigned long currentTime = millis();
+  unsigned long currentTime = Hal::millis();
+  const TesterConfig& config = ConfigStore::get();
   
   // Handle pause before any test (including first test)
   if (waitingBetweenTests || (currentTestIndex == 0 && pauseStartTime == 0)) {
@@ -174,49 +172,43 @@ void MotorController::updateAccelerationTest() {
       waitingBetweenTests = true;
     }
     
-    if (currentTime - pauseStartTime < 2000) {
-      return; // Still in 2-second pause
+    if (currentTime - pauseStartTime < config.pauseMs) {
+      return; // Still in pause
     }
     
     // Pause complete, start the motor for current test
     waitingBetweenTests = false;
     
     // CRITICAL: Reset RPM counter to ensure clean start
-    RPMCounter::reset();
+    rpm->reset();
     
     setSpeed(100);
     testStartTime = currentTime; // Reset timer for acceleration measurement
+    spinUpFit.reset();
+    nextFitSampleMs = SpinUpFit::SAMPLE_MS;
+    SupplyMonitor::startCapture(channel);
     
     // Start the acceleration test timing in RPM counter
-    RPMCounter::startAccelerationTest();
+    rpm->startAccelerationTest();
     
-    Serial.print("Starting test ");
-    Serial.print(currentTestIndex + 1);
-    Serial.print("/4: 0% -> 100% -> ");
-    Serial.print(targetRPM);
-    Serial.println(" RPM");
+    LOG_INFO("ch%ld: starting test %ld/4: 0%% -> 100%% -> %ld RPM", channel, currentTestIndex + 1, (long)targetRPM);
     return;
   }
   
   // Get current RPM from RPMCounter (using acceleration test method)
-  float currentRPM = RPMCounter::getAccelerationRPM();
+  uint32_t currentCentiRpm = rpm->getAccelerationCentiRpm();
   
-  // Check if we've reached the current target RPM
-  if (!targetRPMReached && currentRPM >= targetRPM) {
+  // Check if we've reached the current target RPM (integer compare, readings are RPM x 100)
+  if (!targetRPMReached && currentCentiRpm >= targetRPM * 100) {
     unsigned long accelerationTime = currentTime - testStartTime;
     targetTimes[currentTestIndex] = accelerationTime;
+    spinUpModels[currentTestIndex] = spinUpFit.getModel();
+    testSupply[currentTestIndex] = SupplyMonitor::stopCapture(channel);
     targetRPMReached = true;
     
-    Serial.print("✓ Test ");
-    Serial.print(currentTestIndex + 1);
-    Serial.print("/4 complete: 0 -> ");
-    Serial.print(targetRPM);
-    Serial.print(" RPM in ");
-    Serial.print(accelerationTime);
-    Serial.print(" ms. (Measured: ");
-    Serial.print(currentRPM);
-    Serial.println(" RPM)");
-
+    LOG_INFO("✓ ch%ld: test %ld/4 complete: 0 -> %ld RPM in %lu ms",
+             channel, currentTestIndex + 1, (long)targetRPM, accelerationTime);
+    LOG_DEBUG("ch%ld: measured %ld RPM at the target", channel, (long)(currentCentiRpm / 100));
     
     // Stop motor and prepare for next test
     stop();
@@ -226,86 +218,175 @@ void MotorController::updateAccelerationTest() {
     
     if (currentTestIndex < 4) {
       // Prepare next test
-      targetRPM = RPM_TARGETS[currentTestIndex];
+      targetRPM = config.rpmTargets[currentTestIndex];
       targetRPMReached = false;
       waitingBetweenTests = true;
       pauseStartTime = currentTime;
       
-      Serial.print("Next test ");
-      Serial.print(currentTestIndex + 1);
-      Serial.print("/4: Target ");
-      Serial.print(targetRPM);
-      Serial.println(" RPM");
-      Serial.println("Motor: Stopping for 2s...");
+      LOG_INFO("ch%ld: next test %ld/4: Target %ld RPM", channel, currentTestIndex + 1, (long)targetRPM);
+      LOG_INFO("ch%ld: motor stopping for %lu ms...", channel, config.pauseMs);
     } else {
       // All tests complete
       allTestsComplete = true;
       accelerationTestActive = false;
+      completedSequences++;
       
-      Serial.println("=== ALL ACCELERATION TESTS COMPLETE ===");
+      LOG_INFO("=== ch%ld: ALL ACCELERATION TESTS COMPLETE ===", channel);
       for (int i = 0; i < 4; i++) {
-        Serial.print("Test ");
-        Serial.print(i + 1);
-        Serial.print(" (0 -> ");
-        Serial.print(RPM_TARGETS[i]);
-        Serial.print(" RPM): ");
         if (targetTimes[i] > 0) {
-          Serial.print(targetTimes[i]);
-          Serial.println(" ms");
+          LOG_INFO("ch%ld: test %ld (0 -> %ld RPM): %lu ms", channel, i + 1, (long)config.rpmTargets[i], targetTimes[i]);
         } else {
-          Serial.println("Failed");
+          LOG_INFO("ch%ld: test %ld (0 -> %ld RPM): Failed", channel, i + 1, (long)config.rpmTargets[i]);
         }
       }
-      Serial.println("============================================");
+      LOG_INFO("============================================");
+    }
+  }
+  
+  // Fit the spin-up so far; once it clearly levels off below the target
+  // there's no point waiting for the timeout
+  if (!waitingBetweenTests && currentSpeed > 0) {
+    sampleSpinUp(currentTime);
+    if (config.earlyAbortMarginPercent > 0 &&
+        spinUpFit.predictsShortOf(targetRPM * 100, config.earlyAbortMarginPercent)) {
+      const SpinUpModel& model = spinUpFit.getModel();
+      LOG_WARN("✗ ch%ld: test %ld/4 aborted after %lu ms: levels off at %ld RPM",
+               channel, currentTestIndex + 1, currentTime - testStartTime, (long)(model.finalCentiRpm / 100));
+      uint32_t abortedTarget = targetRPM;
+      spinUpModels[currentTestIndex] = model;
+      spinUpModels[currentTestIndex].earlyAbort = true;
+      failCurrentTest(currentTime);
+      
+      // Later targets at least as high can't be reached either - skip them
+      while (accelerationTestActive && targetRPM >= abortedTarget) {
+        LOG_WARN("✗ ch%ld: test %ld/4 skipped", channel, currentTestIndex + 1);
+        spinUpModels[currentTestIndex] = spinUpModels[currentTestIndex - 1];
+        failCurrentTest(currentTime);
+      }
+      return;
     }
   }
   
   // Timeout for individual test (10 seconds acceleration)
-  if (!waitingBetweenTests && currentSpeed > 0 && currentTime - testStartTime > 10000) {
-    float timeoutRPM = RPMCounter::getAccelerationRPM();
-    Serial.print("✗ Test ");
-    Serial.print(currentTestIndex + 1);
-    Serial.print("/4 timeout: Max RPM ");
-    Serial.println(timeoutRPM);
+  if (!waitingBetweenTests && currentSpeed > 0 && currentTime - testStartTime > config.timeoutMs) {
+    uint32_t timeoutCentiRpm = rpm->getAccelerationCentiRpm();
+    LOG_WARN("✗ ch%ld: test %ld/4 timeout: Max RPM %ld", channel, currentTestIndex + 1, (long)(timeoutCentiRpm / 100));
+    spinUpModels[currentTestIndex] = spinUpFit.getModel();
+    failCurrentTest(currentTime);
+  }
+}
+
+void MotorController::failCurrentTest(unsigned long currentTime) {
+  const TesterConfig& config = ConfigStore::get();
+  
+  // Stop motor and move to next test (skipped tests never started a capture)
+  stop();
+  targetTimes[currentTestIndex] = 0; // Mark as failed
+  testSupply[currentTestIndex] = SupplyMonitor::stopCapture(channel);
+  currentTestIndex++;
+  
+  if (currentTestIndex < 4) {
+    targetRPM = config.rpmTargets[currentTestIndex];
+    targetRPMReached = false;
+    waitingBetweenTests = true;
+    pauseStartTime = currentTime;
     
-    // Stop motor and move to next test
-    stop();
-    targetTimes[currentTestIndex] = 0; // Mark as failed
-    currentTestIndex++;
+    LOG_INFO("ch%ld: next test %ld/4: Target %ld RPM", channel, currentTestIndex + 1, (long)targetRPM);
+  } else {
+    accelerationTestActive = false;
+    completedSequences++;
     
-    if (currentTestIndex < 4) {
-      targetRPM = RPM_TARGETS[currentTestIndex];
-      targetRPMReached = false;
-      waitingBetweenTests = true;
-      pauseStartTime = currentTime;
-      
-      Serial.print("Next test ");
-      Serial.print(currentTestIndex + 1);
-      Serial.print("/4: Target ");
-      Serial.print(targetRPM);
-      Serial.println(" RPM");
-    } else {
-      accelerationTestActive = false;
-      
-      Serial.println("=== ALL TESTS COMPLETE (WITH TIMEOUTS) ===");
-      for (int i = 0; i < 4; i++) {
-        Serial.print("Test ");
-        Serial.print(i + 1);
-        Serial.print(" (0 -> ");
-        Serial.print(RPM_TARGETS[i]);
-        Serial.print(" RPM): ");
-        if (targetTimes[i] > 0) {
-          Serial.print(targetTimes[i]);
-          Serial.println(" ms");
-        } else {
-          Serial.println("Failed/Timeout");
-        }
+    LOG_INFO("=== ch%ld: ALL TESTS COMPLETE (WITH FAILURES) ===", channel);
+    for (int i = 0; i < 4; i++) {
+      if (targetTimes[i] > 0) {
+        LOG_INFO("ch%ld: test %ld (0 -> %ld RPM): %lu ms", channel, i + 1, (long)config.rpmTargets[i], targetTimes[i]);
+      } else {
+        LOG_INFO("ch%ld: test %ld (0 -> %ld RPM): Failed/Timeout", channel, i + 1, (long)config.rpmTargets[i]);
       }
     }
   }
 }
 
-unsigned long MotorController::getAccelerationTestResult() {
+void MotorController::sampleSpinUp(unsigned long currentTime) {
+  unsigned long elapsed = currentTime - testStartTime;
+  if (elapsed < nextFitSampleMs) return;
+  
+  // Pairs must be one grid step apart - after a late call start a new pair
+  bool late = elapsed - nextFitSampleMs >= SpinUpFit::SAMPLE_MS;
+  while (nextFitSampleMs <= elapsed) {
+    nextFitSampleMs += SpinUpFit::SAMPLE_MS;
+  }
+  
+  // Early estimates are still settling and would skew the whole fit
+  const SpeedEstimator& estimator = rpm->getEstimator();
+  if (late || !estimator.isSettled()) {
+    spinUpFit.skipSample();
+  }
+  if (estimator.isSettled()) {
+    spinUpFit.addSample(elapsed, estimator.getCentiRpm(Hal::micros()));
+  }
+}
+
+const SpinUpModel& MotorController::getSpinUpModel(int index) const {
+  static const SpinUpModel NONE = {0, 0, 0, 0, false};
+  if (index < 0 || index >= 4) return NONE;
+  if (accelerationTestActive && !waitingBetweenTests && index == currentTestIndex) {
+    return spinUpFit.getModel();
+  }
+  return spinUpModels[index];
+}
+
+const SupplyStats& MotorController::getTestSupply(int index) const {
+  static const SupplyStats NONE = {0, 0, 0, 0};
+  if (index < 0 || index >= 4) return NONE;
+  return testSupply[index];
+}
+
+unsigned long MotorController::getNormalizedTargetTime(int index) const {
+  if (index < 0 || index >= 4 || targetTimes[index] == 0 || testSupply[index].samples == 0) return 0;
+
+  // Only the supply above the stall voltage (bridge drop, and what friction
+  // takes up) speeds the motor up - it scales the torque and the speed the
+  // motor levels off at
+  const TesterConfig& config = ConfigStore::get();
+  if (testSupply[index].meanMv <= config.stallSupplyMv) return 0;
+  double stall = config.stallSupplyMv;
+  double scale = ((double)config.nominalSupplyMv - stall) / ((double)testSupply[index].meanMv - stall);
+
+  // With a spin-up model, correct the measured time by the model's change
+  // in time to target; without one (too short a run) assume the torque,
+  // and so the acceleration, scales with the voltage
+  const SpinUpModel& model = spinUpModels[index];
+  const uint32_t target = config.rpmTargets[index];
+  unsigned long modelled = SpinUpFit::timeToRpm(model, target);
+  unsigned long scaled = SpinUpFit::timeToRpm(model, target, scale);
+  if (modelled > 0 && scaled > 0) {
+    long corrected = (long)targetTimes[index] + (long)scaled - (long)modelled;
+    return corrected > 0 ? (unsigned long)corrected : 0;
+  }
+  return (unsigned long)(targetTimes[index] / scale + 0.5);
+}
+
+int MotorController::getLatestSpinUpIndex() const {
+  for (int i = 3; i >= 0; i--) {
+    if (getSpinUpModel(i).finalCentiRpm > 0) return i;
+  }
+  return -1;
+}
+
+unsigned long MotorController::getTargetTime(int index) const {
+  if (index < 0 || index >= 4) return 0;
+  return targetTimes[index];
+}
+
+void MotorController::applyConfig() {
+  Hal::analogWriteFreq(ConfigStore::get().pwmFrequencyHz);
+  
+  // Re-apply the duty cycle in case the PWM range changed
+  updateMotor();
+}
+
+unsigned long MotorController::getAccelerationTestResult() const {
   if (testCompletionTime > 0) {
     return testCompletionTime - testStartTime;
   }
@@ -1,22 +1,56 @@
 #ifndef MOTOR_TESTER_MOTOR_CONTROLLER_H
 #define MOTOR_TESTER_MOTOR_CONTROLLER_H
 
-#include <Arduino.h>
+#include "Hal.h"
+#include "SpinUpFit.h"
+#include "SupplyMonitor.h"
 
+// L298N bridge inputs of one channel
+struct MotorPins {
+  uint8_t in1;     // Direction control 1
+  uint8_t in2;     // Direction control 2
+  uint8_t enable;  // PWM speed control (ENA/ENB)
+};
+
+class RPMCounter;
+
+// One L298N bridge and the acceleration test sequence that runs on it. Each
+// tested motor (see Channels) owns an instance, paired with its RPMCounter.
 class MotorController {
   public:
-    static void begin();
-    static void setSpeed(int percentage); // 0-100%
-    static void stop();
-    static int getCurrentSpeed();
-    static bool isRunning();
-    static unsigned long getLastUpdateTime();
+    void begin(uint8_t channel, const MotorPins& pins, RPMCounter* rpm);
+    void setSpeed(int percentage); // 0-100%
+    void stop();
+    int getCurrentSpeed() const;
+    int getCurrentPwm() const; // Duty cycle currently on the enable pin
+    bool isRunning() const;
+    unsigned long getLastUpdateTime() const;
+    const MotorPins& getPins() const { return pins; }
     
     // Acceleration test functionality
-    static void startAccelerationTest();
-    static bool isAccelerationTestRunning();
-    static void updateAccelerationTest(); // Call in main loop
-    static unsigned long getAccelerationTestResult(); // Returns time in ms, 0 if test not complete
+    void startAccelerationTest();
+    void abortAccelerationTest(); // Ends any test sequence and stops the motor
+    bool isAccelerationTestRunning() const;
+    int getCurrentTestIndex() const { return currentTestIndex; } // 0-3 while a test runs
+    void updateAccelerationTest(); // Call in main loop
+    unsigned long getAccelerationTestResult() const; // Returns time in ms, 0 if test not complete
+    unsigned long getTargetTime(int index) const; // Time to reach target `index` in ms, 0 if failed/not run
+    unsigned long getCompletedSequences() const { return completedSequences; } // Finished since boot
+    
+    // Spin-up model of test `index`: live while that test runs, then kept
+    // until the next sequence starts. finalCentiRpm is 0 if there's no fit.
+    const SpinUpModel& getSpinUpModel(int index) const;
+    int getLatestSpinUpIndex() const; // Most recent test with a model, -1 if none
+    
+    // Supply voltage during test `index` (samples 0 without a sensor), and
+    // its target time normalized to TesterConfig::nominalSupplyMv - 0 if the
+    // test failed or there was no supply reading
+    const SupplyStats& getTestSupply(int index) const;
+    unsigned long getNormalizedTargetTime(int index) const;
+    
+    // Re-read PWM frequency and range from ConfigStore (targets, pause and
+    // timeout are read on every use)
+    void applyConfig();
     
     // Predefined speed levels
     static const int SPEED_OFF = 0;
@@ -26,31 +60,38 @@ class MotorController {
     static const int SPEED_100 = 100;
     
   private:
-    // L298N pin definitions
-    static const int IN3_PIN = D1;  // Direction control 1
-    static const int IN4_PIN = D2;  // Direction control 2
-    static const int ENB_PIN = D3;  // PWM speed control (Enable B)
+    MotorPins pins = {0, 0, 0};
+    uint8_t channel = 0;
+    RPMCounter* rpm = nullptr;
     
-    static int currentSpeed;
-    static bool motorRunning;
-    static unsigned long lastUpdateTime;
+    int currentSpeed = 0;
+    bool motorRunning = false;
+    unsigned long lastUpdateTime = 0;
     
     // Acceleration test variables
-    static bool accelerationTestActive;
-    static unsigned long testStartTime;
-    static unsigned long testCompletionTime;
-    static float targetRPM;
-    static bool targetRPMReached;
+    bool accelerationTestActive = false;
+    unsigned long testStartTime = 0;
+    unsigned long testCompletionTime = 0;
+    uint32_t targetRPM = 0;
+    bool targetRPMReached = false;
     
     // Multi-test sequence variables
-    static const float RPM_TARGETS[4]; // Array of target RPMs
-    static int currentTestIndex;
-    static unsigned long targetTimes[4]; // Store time for each target
-    static bool allTestsComplete;
-    static bool waitingBetweenTests;
-    static unsigned long pauseStartTime;
-    
-    static void updateMotor();
+    int currentTestIndex = 0;
+    unsigned long targetTimes[4] = {0, 0, 0, 0}; // Store time for each target
+    bool allTestsComplete = false;
+    unsigned long completedSequences = 0;
+    bool waitingBetweenTests = false;
+    unsigned long pauseStartTime = 0;
+    
+    // Online fit of the current spin-up, sampled every SpinUpFit::SAMPLE_MS
+    SpinUpFit spinUpFit;
+    SpinUpModel spinUpModels[4] = {};
+    unsigned long nextFitSampleMs = 0; // Since testStartTime
+    SupplyStats testSupply[4] = {};
+    
+    void updateMotor();
+    void sampleSpinUp(unsigned long currentTime);
+    void failCurrentTest(unsigned long currentTime); // Stop, mark failed and move on
     static int speedToPWM(int percentage);
 };
 
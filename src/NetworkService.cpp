@@ -0,0 +1,166 @@
+#include "NetworkService.h"
+#ifdef ESP32
+#include <WiFi.h>
+#else
+#include <ESP8266WiFi.h>
+#endif
+#include "wifi_secrets.h"
+#include "MDNSService.h"
+#include "OTAService.h"
+#include "WebServer.h"
+#include "Logger.h"
+
+NetworkService::State NetworkService::state = NetworkService::STATE_CONNECTING;
+unsigned long NetworkService::stateSince = 0;
+unsigned long NetworkService::lastRetry = 0;
+unsigned long NetworkService::connectedTime = 0;
+bool NetworkService::servicesStarted = false;
+char NetworkService::hostname[32] = "";
+
+// Last three bytes of the MAC on both chips - the ESP32 has no getChipId()
+static unsigned long chipId() {
+#ifdef ESP32
+  uint64_t mac = ESP.getEfuseMac();
+  // Byte 0 of the MAC is the low byte of getEfuseMac()
+  return (unsigned long)(((mac >> 24) & 0xff) << 16 | ((mac >> 32) & 0xff) << 8 | ((mac >> 40) & 0xff));
+#else
+  return ESP.getChipId();
+#endif
+}
+
+void NetworkService::begin() {
+  // Several testers can share a network, so the name carries the chip ID
+  snprintf(hostname, sizeof(hostname), "esp-racepi-motor-tester-%06lx", chipId());
+
+  // Don't write credentials to flash on every boot
+  WiFi.persistent(false);
+#ifdef ESP32
+  // Only taken if set before the interface comes up
+  WiFi.setHostname(hostname);
+  WiFi.mode(WIFI_STA);
+  WiFi.setAutoReconnect(true);
+#else
+  WiFi.mode(WIFI_STA);
+  WiFi.setAutoReconnect(true);
+  WiFi.hostname(hostname);
+#endif
+  WiFi.begin(MY_SSID, MY_PW);
+
+  setState(STATE_CONNECTING);
+  LOG_INFO("Connecting to WiFi in the background");
+}
+
+void NetworkService::update() {
+  bool connected = (WiFi.status() == WL_CONNECTED);
+  unsigned long now = millis();
+
+  switch (state) {
+    case STATE_CONNECTING:
+      if (connected) {
+        setState(STATE_CONNECTED);
+      } else if (now - stateSince > AP_FALLBACK_TIMEOUT_MS) {
+        startAccessPoint();
+        setState(STATE_AP_FALLBACK);
+      }
+      break;
+
+    case STATE_CONNECTED:
+      if (!connected) {
+        // The SDK reconnects on its own; fall back to AP if that takes too long
+        LOG_WARN("WiFi connection lost, reconnecting");
+        setState(STATE_CONNECTING);
+      }
+      break;
+
+    case STATE_AP_FALLBACK:
+      if (connected) {
+        stopAccessPoint();
+        setState(STATE_CONNECTED);
+      } else if (now - lastRetry > STATION_RETRY_INTERVAL_MS) {
+        lastRetry = now;
+        WiFi.begin(MY_SSID, MY_PW);
+      }
+      break;
+  }
+}
+
+void NetworkService::setState(State newState) {
+  state = newState;
+  stateSince = millis();
+
+  if (newState == STATE_CONNECTED) {
+    if (connectedTime == 0) connectedTime = stateSince;
+    IPAddress ip = WiFi.localIP();
+    LOG_INFO("WiFi connected %lu ms after boot", stateSince);
+    LOG_INFO("IP address: %ld.%ld.%ld.%ld", ip[0], ip[1], ip[2], ip[3]);
+    startServices();
+  } else if (newState == STATE_AP_FALLBACK) {
+    startServices();
+  }
+}
+
+void NetworkService::startAccessPoint() {
+  char ssid[32];
+  snprintf(ssid, sizeof(ssid), "esp-motor-tester-%06lx", chipId());
+
+  // Keep the station interface up so we can still join the configured AP
+  WiFi.mode(WIFI_AP_STA);
+#ifdef MY_AP_PW
+  WiFi.softAP(ssid, MY_AP_PW);
+#else
+  WiFi.softAP(ssid);
+#endif
+  lastRetry = millis();
+
+  IPAddress ip = WiFi.softAPIP();
+  LOG_WARN("WiFi unavailable - fallback AP started, connect to it and open http://%ld.%ld.%ld.%ld",
+           ip[0], ip[1], ip[2], ip[3]);
+}
+
+void NetworkService::stopAccessPoint() {
+  WiFi.softAPdisconnect(true);
+  WiFi.mode(WIFI_STA);
+  LOG_INFO("Fallback AP stopped");
+}
+
+void NetworkService::startServices() {
+  if (servicesStarted) return;
+
+  MDNSService::begin();
+  OTAService::begin();
+  WebServer::begin();
+
+  servicesStarted = true;
+}
+
+NetworkService::State NetworkService::getState() {
+  return state;
+}
+
+const char* NetworkService::getStateName() {
+  switch (state) {
+    case STATE_CONNECTING:  return "connecting";
+    case STATE_CONNECTED:   return "connected";
+    case STATE_AP_FALLBACK: return "ap-fallback";
+  }
+  return "unknown";
+}
+
+bool NetworkService::isConnected() {
+  return WiFi.status() == WL_CONNECTED;
+}
+
+bool NetworkService::isAccessPointActive() {
+  return state == STATE_AP_FALLBACK;
+}
+
+String NetworkService::getIP() {
+  if (isAccessPointActive() && !isConnected()) {
+    return WiFi.softAPIP().toString();
+  }
+  return WiFi.localIP().toString();
+}
+
+unsigned long NetworkService::getConnectedTime() {
+  return connectedTime;
+}
@@ -0,0 +1,51 @@
+#ifndef MOTOR_TESTER_NETWORK_SERVICE_H
+#define MOTOR_TESTER_NETWORK_SERVICE_H
+
+#include <Arduino.h>
+
+// Asynchronous WiFi bring-up. begin() returns immediately; update() (a
+// scheduler task) tracks the connection, starts MDNS/OTA/WebServer once a
+// network is available, reconnects automatically and opens a fallback
+// access point when the configured AP can't be reached.
+class NetworkService {
+  public:
+    enum State : uint8_t {
+      STATE_CONNECTING,
+      STATE_CONNECTED,
+      STATE_AP_FALLBACK
+    };
+
+    static void begin();
+    static void update();
+
+    static State getState();
+    static const char* getStateName();
+    static bool isConnected();          // Station connected to the configured AP
+    static bool isAccessPointActive();  // Fallback AP running
+    static String getIP();              // Station IP, or AP IP in fallback mode
+    static unsigned long getConnectedTime(); // millis() of the first connection, 0 if never
+
+    // esp-racepi-motor-tester-<chip id>, unique per board. Used for DHCP,
+    // mDNS (<hostname>.local) and OTA. Valid after begin().
+    static const char* getHostname() { return hostname; }
+
+  private:
+    static State state;
+    static unsigned long stateSince;
+    static unsigned long lastRetry;
+    static unsigned long connectedTime;
+    static bool servicesStarted;
+    static char hostname[32];
+
+    // Fall back to AP mode if the station hasn't connected within this time
+    static const unsigned long AP_FALLBACK_TIMEOUT_MS = 15000;
+    // While in AP fallback, retry the configured network this often
+    static const unsigned long STATION_RETRY_INTERVAL_MS = 30000;
+
+    static void setState(State newState);
+    static void startAccessPoint();
+    static void stopAccessPoint();
+    static void startServices();
+};
+
+#endif
@@ -1,11 +1,25 @@
 #include "OTAService.h"
+#include "NetworkService.h"
+#include "Channels.h"
+#include "EdgeTrace.h"
+#include "UdpTelemetry.h"
+#include "Endurance.h"
+#include "Logger.h"
 
 bool OTAService::isStarted = false;
+OTAService::State OTAService::state = OTAService::STATE_IDLE;
+unsigned long OTAService::startTime = 0;
+unsigned long OTAService::endTime = 0;
+unsigned long OTAService::progress = 0;
+unsigned long OTAService::total = 0;
+unsigned long OTAService::deferredCount = 0;
+uint8_t OTAService::loggedQuarter = 0;
+const char* OTAService::lastError = "";
 
 void OTAService::begin() {
   if (isStarted) return;
   
-  ArduinoOTA.setHostname("esp-racepi-motor-tester");
+  ArduinoOTA.setHostname(NetworkService::getHostname());
   
   ArduinoOTA.onStart([]() {
     onStart();
@@ -30,41 +44,113 @@ void OTAService::begin() {
 }
 
 void OTAService::handle() {
-  if (isStarted) {
-    ArduinoOTA.handle();
+  if (!isStarted) return;
+  
+  {
+    // Runs outside the scheduler's lock: an upload blocks in handle() and
+    // /api/ota has to keep answering meanwhile (ESP32)
+    Hal::MeasurementLock lock;
+    
+    // Don't answer an invitation mid-test - the upload would block the
+    // scheduler and ruin the measurement. It stays queued in the UDP socket.
+    if (Channels::isAnyTestRunning()) {
+      if (state != STATE_DEFERRED) {
+        state = STATE_DEFERRED;
+        deferredCount++;
+        LOG_INFO("OTA deferred until the acceleration test finishes");
+      }
+      return;
+    }
+    if (state == STATE_DEFERRED) {
+      state = STATE_IDLE;
+      LOG_INFO("OTA accepted again");
+    }
+  }
+  
+  ArduinoOTA.handle();
+}
+
+const char* OTAService::getStateName() {
+  switch (state) {
+    case STATE_IDLE:     return "idle";
+    case STATE_DEFERRED: return "deferred";
+    case STATE_UPDATING: return "updating";
+    case STATE_DONE:     return "done";
+    case STATE_ERROR:    return "error";
   }
+  return "unknown";
+}
+
+unsigned long OTAService::getElapsedMs() {
+  if (startTime == 0) return 0;
+  return (state == STATE_UPDATING ? millis() : endTime) - startTime;
+}
+
+unsigned long OTAService::getBytesPerSecond() {
+  unsigned long elapsed = getElapsedMs();
+  return elapsed > 0 ? (unsigned long)((uint64_t)progress * 1000 / elapsed) : 0;
 }
 
 void OTAService::onStart() {
-  String type;
+  // Safe state first: nothing may keep driving a bridge while we flash.
+  // An endurance run ends here and saves its archives before the reboot -
+  // stopAll() ends the acceleration tests, so the save isn't held back.
+  Hal::MeasurementLock lock;
+  Channels::stopAll();
+  Endurance::stop();
+  UdpTelemetry::stop();
+  EdgeTrace::stop();
+  
+  state = STATE_UPDATING;
+  startTime = millis();
+  endTime = 0;
+  progress = 0;
+  total = 0;
+  loggedQuarter = 0;
+  lastError = "";
+  
   if (ArduinoOTA.getCommand() == U_FLASH) {
-    type = "sketch";
+    LOG_INFO("OTA update started (sketch), motors stopped");
   } else { // U_SPIFFS
-    type = "filesystem";
+    LOG_INFO("OTA update started (filesystem), motors stopped");
   }
-  
-  Serial.println("Start updating " + type);
 }
 
 void OTAService::onEnd() {
-  Serial.println("\nEnd");
+  state = STATE_DONE;
+  endTime = millis();
+  LOG_INFO("OTA update complete: %lu bytes in %lu ms", progress, endTime - startTime);
 }
 
-void OTAService::onProgress(unsigned int progress, unsigned int total) {
-  Serial.printf("Progress: %u%%\r", (progress / (total / 100)));
+void OTAService::onProgress(unsigned int written, unsigned int size) {
+  // Called for every chunk - keep it to a few stores, and a log line per 25%
+  progress = written;
+  total = size;
+  
+  uint8_t quarter = size > 0 ? (uint8_t)((uint64_t)written * 4 / size) : 0;
+  if (quarter > loggedQuarter && quarter < 4) {
+    loggedQuarter = quarter;
+    LOG_INFO("OTA progress: %ld%%", quarter * 25);
+  }
 }
 
 void OTAService::onError(ota_error_t error) {
-  Serial.printf("Error[%u]: ", error);
+  state = STATE_ERROR;
+  endTime = millis();
+  
   if (error == OTA_AUTH_ERROR) {
-    Serial.println("Auth Failed");
+    lastError = "auth";
   } else if (error == OTA_BEGIN_ERROR) {
-    Serial.println("Begin Failed");
+    lastError = "begin";
   } else if (error == OTA_CONNECT_ERROR) {
-    Serial.println("Connect Failed");
+    lastError = "connect";
   } else if (error == OTA_RECEIVE_ERROR) {
-    Serial.println("Receive Failed");
+    lastError = "receive";
   } else if (error == OTA_END_ERROR) {
-    Serial.println("End Failed");
+    lastError = "end";
+  } else {
+    lastError = "unknown";
   }
-}
\ No newline at end of file
+  
+  LOG_ERROR("OTA update failed (error %ld) after %lu bytes", (long)error, progress);
+}
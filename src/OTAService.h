@@ -3,11 +3,39 @@
 
 #include <ArduinoOTA.h>
 
+// ArduinoOTA, coordinated with the test channels. Flash writes stall the CPU
+// for tens of milliseconds and the scheduler doesn't run until the update
+// is over, so:
+//  - while an acceleration test runs on any channel, handle() leaves the
+//    invitation unanswered (STATE_DEFERRED). espota.py retries for about
+//    10 s; if the test is still running after that, the upload fails and can
+//    be retried once the tester is idle.
+//  - onStart() aborts any test and stops every motor before flashing, so the
+//    L298N is never left driven without supervision.
+// Progress and throughput are kept for /api/ota instead of printed.
 class OTAService {
   public:
+    enum State : uint8_t {
+      STATE_IDLE,
+      STATE_DEFERRED,  // Test running, invitations not answered
+      STATE_UPDATING,
+      STATE_DONE,      // Rebooting into the new firmware
+      STATE_ERROR
+    };
+    
     static void begin();
     static void handle();
     
+    static State getState() { return state; }
+    static const char* getStateName();
+    static bool isUpdating() { return state == STATE_UPDATING; }
+    static unsigned long getProgress() { return progress; }    // Bytes written
+    static unsigned long getTotal() { return total; }          // Image size
+    static unsigned long getElapsedMs();                       // Of the current/last update
+    static unsigned long getBytesPerSecond();
+    static unsigned long getDeferredCount() { return deferredCount; } // Times an update was held back
+    static const char* getLastError() { return lastError; }
+    
   private:
     static void onStart();
     static void onEnd();
@@ -15,6 +43,14 @@ class OTAService {
     static void onError(ota_error_t error);
     
     static bool isStarted;
+    static State state;
+    static unsigned long startTime;
+    static unsigned long endTime;
+    static unsigned long progress;
+    static unsigned long total;
+    static unsigned long deferredCount;
+    static uint8_t loggedQuarter;
+    static const char* lastError;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -1,50 +1,39 @@
 #include "RPMCounter.h"
+#include "LatencyProbe.h"
+#include "Logger.h"
+#include "ConfigStore.h"
+#include "EdgeTrace.h"
 
-// Static member definitions
-volatile bool RPMCounter::signalPending = false;
-volatile unsigned long RPMCounter::signalCount = 0;
-volatile unsigned long RPMCounter::lastSignalTime = 0;
-volatile unsigned long RPMCounter::blockingTimestamp = 0;
-volatile float RPMCounter::currentRPM = 0.0;
-volatile unsigned long RPMCounter::lastIntervalMicros = 0;
-uint8_t RPMCounter::sensorPin = 0;
-volatile unsigned long RPMCounter::currentTimestamp = 0;
-volatile unsigned long RPMCounter::previousTimestamp = 0;
-volatile bool RPMCounter::timestampReady = false;
-volatile unsigned long RPMCounter::accelerationTestStartTime = 0;
-volatile bool RPMCounter::accelerationTestActive = false;
-volatile unsigned long RPMCounter::risingEdgeTime = 0;
-volatile unsigned long RPMCounter::fallingEdgeTime = 0;
-volatile bool RPMCounter::risingEdgeDetected = false;
-volatile unsigned long RPMCounter::lastValidSignalLength = 0;
-volatile unsigned long RPMCounter::consistentSignalCount = 0;
-
-void RPMCounter::begin(uint8_t pin) {
+void RPMCounter::begin(uint8_t channelIndex, uint8_t pin, EdgeCapture& capture) {
+    channel = channelIndex;
     sensorPin = pin;
     signalPending = false;
     signalCount = 0;
+    rejectedCount = 0;
     lastSignalTime = 0;
     blockingTimestamp = 0;
     currentTimestamp = 0;
     previousTimestamp = 0;
     timestampReady = false;
-    currentRPM = 0.0;
+    currentCentiRpm = 0;
     lastIntervalMicros = 0;
     accelerationTestStartTime = 0;
     accelerationTestActive = false;
     risingEdgeTime = 0;
     fallingEdgeTime = 0;
     risingEdgeDetected = false;
+    estimator.reset();
+    estimatorCursor = 0;
+    diagnostics.clear();
     
-    // Configure pin as input with pull-up resistor
-    pinMode(pin, INPUT_PULLUP);
-    
-    // Attach single interrupt to handle both edges
-    attachInterrupt(digitalPinToInterrupt(pin), handleSignalChange, CHANGE);
+    // The backend sets up the pin and its interrupt
+    if (!capture.attach(channel, pin, this)) {
+        LOG_ERROR("ch%ld: edge capture can't take GPIO%ld - no RPM on this channel", channel, pin);
+        return;
+    }
     
-    Serial.print("RPM Counter initialized on pin D");
-    Serial.print(pin);
-    Serial.println(" with dual-edge signal length filtering (600μs - 1.4ms)");
+    LOG_INFO("ch%ld: RPM Counter initialized on GPIO%ld with dual-edge signal length filtering (%luμs - %luμs)",
+             channel, pin, ConfigStore::get().minSignalLengthUs, ConfigStore::get().maxSignalLengthUs);
 }
 
 void RPMCounter::reset() {
@@ -55,7 +44,7 @@ void RPMCounter::reset() {
     currentTimestamp = 0;
     previousTimestamp = 0;
     timestampReady = false;
-    currentRPM = 0.0;
+    currentCentiRpm = 0;
     lastIntervalMicros = 0;
     accelerationTestStartTime = 0;
     accelerationTestActive = false;
@@ -64,18 +53,33 @@ void RPMCounter::reset() {
     risingEdgeDetected = false;
     lastValidSignalLength = 0;
     consistentSignalCount = 0;
+    estimator.reset();
+    estimatorCursor = signalCount; // Pulses from before the reset don't count
     
     // Note: we don't reset signalCount to preserve total count
     
-    Serial.println("RPM Counter reset - all values cleared");
+    if (channel != NO_CHANNEL) LOG_DEBUG("ch%ld: RPM Counter reset - all values cleared", channel);
 }
 
 void IRAM_ATTR RPMCounter::handleSignalChange() {
-    unsigned long now = micros();
-    bool pinState = digitalRead(sensorPin);  // Read current pin state
-    
+    LATENCY_PROBE(PROBE_ISR);
+    unsigned long now = Hal::micros();
+    bool pinState = Hal::digitalRead(sensorPin);  // Read current pin state
+    EdgeTrace::recordEdge(channel, now, pinState);  // Raw edge, before any filtering
+    processEdge(now, pinState);
+}
+
+void IRAM_ATTR RPMCounter::handleCapturedEdge(unsigned long timestamp, bool pinState) {
+    LATENCY_PROBE(PROBE_ISR);
+    EdgeTrace::recordEdge(channel, timestamp, pinState);
+    processEdge(timestamp, pinState);
+}
+
+void IRAM_ATTR RPMCounter::processEdge(unsigned long now, bool pinState) {
     // Simple debounce: ignore signals that come too quickly
-    if (now - blockingTimestamp < DEBOUNCE_TIME_US) {
+    const TesterConfig& config = ConfigStore::get();
+    if (now - blockingTimestamp < config.debounceUs) {
+        diagnostics.reject(SensorDiagnostics::REJECT_DEBOUNCE);
         return;
     }
     
@@ -83,21 +87,27 @@ void IRAM_ATTR RPMCounter::handleSignalChange() {
         // Rising edge detected
         risingEdgeTime = now;
         risingEdgeDetected = true;
+        diagnostics.recordRisingEdge(now);
     } else {
         // Falling edge detected
         fallingEdgeTime = now;
         
         // Only process falling edge if we have a valid rising edge
         if (!risingEdgeDetected) {
+            diagnostics.reject(SensorDiagnostics::REJECT_NO_RISING_EDGE);
             return;
         }
         
         // Calculate signal length
         unsigned long signalLength = fallingEdgeTime - risingEdgeTime;
+        diagnostics.recordWidth(signalLength);
         
         // Filter by signal length - reject obvious noise
-        if (signalLength < MIN_SIGNAL_LENGTH_US || signalLength > MAX_SIGNAL_LENGTH_US) {
+        if (signalLength < config.minSignalLengthUs || signalLength > config.maxSignalLengthUs) {
             risingEdgeDetected = false;
+            rejectedCount++;
+            diagnostics.reject(signalLength < config.minSignalLengthUs ? SensorDiagnostics::REJECT_TOO_SHORT
+                                                                        : SensorDiagnostics::REJECT_TOO_LONG);
             return;
         }
         
@@ -111,6 +121,8 @@ void IRAM_ATTR RPMCounter::handleSignalChange() {
             // Reject if signal length differs by more than 50% from the last valid signal
             if (lengthDiff > (lastValidSignalLength / 2)) {
                 risingEdgeDetected = false;
+                rejectedCount++;
+                diagnostics.reject(SensorDiagnostics::REJECT_INCONSISTENT);
                 return;
             }
         }
@@ -124,9 +136,11 @@ void IRAM_ATTR RPMCounter::handleSignalChange() {
         previousTimestamp = currentTimestamp;
         currentTimestamp = risingEdgeTime; // Use rising edge for timing consistency
         
+        pulseTimes[signalCount & (PULSE_HISTORY - 1)] = risingEdgeTime;
         signalCount++;
         signalPending = true;
         risingEdgeDetected = false;
+        diagnostics.recordAccepted();
         
         // Mark that we have two timestamps ready for calculation
         if (previousTimestamp > 0) {
@@ -136,12 +150,14 @@ void IRAM_ATTR RPMCounter::handleSignalChange() {
 }
 
 void RPMCounter::update() {
+    LATENCY_PROBE(PROBE_RPM_UPDATE);
+    
     // Check if there's a pending signal to process
     if (signalPending) {
         signalPending = false;
         
         // Update lastSignalTime here (safe to call millis() outside ISR)
-        lastSignalTime = millis();
+        lastSignalTime = Hal::millis();
         
         // Calculate RPM if we have two timestamps
         if (timestampReady) {
@@ -152,82 +168,125 @@ void RPMCounter::update() {
             if (current > previous) { // Sanity check for timer overflow
                 unsigned long interval = current - previous;
                 
-                // Sanity check: interval must be reasonable
-                // Min interval: 25000 RPM = 417 RPS = ~2400 microseconds
-                // Max interval: 10 RPM = 0.167 RPS = 6,000,000 microseconds  
-                if (interval >= 2400 && interval <= 6000000) {
-                    // Calculate RPM: 60,000,000 microseconds = 1 minute
-                    float calculatedRPM = 60000000.0 / interval;
+                // Calculate RPM: 60,000,000 microseconds = 1 minute
+                uint32_t calculatedCentiRpm = intervalToCentiRpm(interval);
+                
+                // Apply bounds checking to filter out erroneous readings
+                const TesterConfig& config = ConfigStore::get();
+                if (calculatedCentiRpm >= config.minReasonableRpm * 100UL &&
+                    calculatedCentiRpm <= config.maxReasonableRpm * 100UL) {
+                    lastIntervalMicros = interval;
+                    currentCentiRpm = calculatedCentiRpm;
                     
-                    // Apply bounds checking to filter out erroneous readings
-                    if (calculatedRPM >= MIN_REASONABLE_RPM && calculatedRPM <= MAX_REASONABLE_RPM) {
-                            lastIntervalMicros = interval;
-                            currentRPM = calculatedRPM;                     
+                    if (firstReadingTime == 0) {
+                        firstReadingTime = lastSignalTime;
+                        if (channel != NO_CHANNEL) {
+                            LOG_INFO("ch%ld: first RPM reading %lu ms after boot", channel, firstReadingTime);
+                        }
                     }
+                } else {
+                    diagnostics.reject(SensorDiagnostics::REJECT_IMPLAUSIBLE);
                 }
             }
             
             timestampReady = false; // Reset flag
         }
-        
-        // Only print occasionally to avoid slowing down the system
-        static unsigned long lastPrintTime = 0;
-        
-        if (millis() - lastPrintTime > 1000) { // Print max once per second
-            Serial.print("RPM: ");
-            Serial.print(currentRPM, 1);
-            Serial.print(" (Count: ");
-            Serial.print(signalCount);
-            Serial.print(", Interval: ");
-            Serial.print(lastIntervalMicros / 1000.0, 2); // Convert to ms with 2 decimal places
-            Serial.println(" ms)");
-            
-            lastPrintTime = millis();
+    }
+    
+    // The estimator sees every accepted pulse, not just the latest interval
+    uint32_t pulses[16];
+    uint8_t pulseCount;
+    while ((pulseCount = readPulses(estimatorCursor, pulses, 16, estimatorLost)) > 0) {
+        for (uint8_t i = 0; i < pulseCount; i++) {
+            estimator.addPulse(pulses[i]);
         }
     }
     
     // Check if RPM data is stale (motor stopped)
-    if (millis() - lastSignalTime > 2000) {
-        currentRPM = 0.0;
+    if (Hal::millis() - lastSignalTime > 2000) {
+        currentCentiRpm = 0;
+        estimator.restart();
     }
 }
 
-unsigned long RPMCounter::getSignalCount() {
+uint32_t RPMCounter::intervalToCentiRpm(unsigned long intervalMicros) {
+    if (intervalMicros == 0) return 0;
+    if (intervalMicros == 1) return UINT32_MAX; // 6,000,000,000 doesn't fit - saturate
+    if (intervalMicros > 60000000UL) {
+        // Below 1 RPM - never a valid reading, not worth optimising
+        return (uint32_t)((6000000000ULL + intervalMicros / 2) / intervalMicros);
+    }
+    
+    // 6,000,000,000 / interval doesn't fit 32 bits, so divide in two steps:
+    // whole RPM first, then the hundredths from the remainder (remainder * 100
+    // fits 32 bits for every interval up to 60 s). Integer only - the ESP8266
+    // has no FPU, so a double divide is a long software routine.
+    uint32_t wholeRpm = 60000000UL / intervalMicros;
+    uint32_t remainder = 60000000UL % intervalMicros;
+    return wholeRpm * 100 + (remainder * 100 + intervalMicros / 2) / intervalMicros;
+}
+
+unsigned long RPMCounter::getSignalCount() const {
     return signalCount;
 }
 
-unsigned long RPMCounter::getLastSignalTime() {
+unsigned long RPMCounter::getLastSignalTime() const {
     return lastSignalTime;
 }
 
-bool RPMCounter::hasPendingSignal() {
+bool RPMCounter::hasPendingSignal() const {
     return signalPending;
 }
 
-float RPMCounter::getCurrentRPM() {
+uint32_t RPMCounter::getCurrentCentiRpm() const {
     // Check if the reading is too old (more than 2 seconds = motor likely stopped)
-    if (millis() - lastSignalTime > 2000) {
-        return 0.0;
+    if (Hal::millis() - lastSignalTime > 2000) {
+        return 0;
     }
     
-    return currentRPM;
+    return currentCentiRpm;
+}
+
+float RPMCounter::getCurrentRPM() const {
+    return getCurrentCentiRpm() / 100.0f;
 }
 
-unsigned long RPMCounter::getTimeBetweenSignals() {
+unsigned long RPMCounter::getTimeBetweenSignals() const {
     return lastIntervalMicros;
 }
 
+unsigned long RPMCounter::getFirstReadingTime() const {
+    return firstReadingTime;
+}
+
+uint8_t RPMCounter::readPulses(unsigned long& cursor, uint32_t* times, uint8_t maxCount, unsigned long& lost) const {
+    unsigned long head = signalCount;
+    if (head - cursor > PULSE_HISTORY) {
+        lost += head - cursor - PULSE_HISTORY;
+        cursor = head - PULSE_HISTORY;
+    }
+    
+    // The ISR writes the slot before bumping signalCount, and can't lap a
+    // 64-entry history during this copy, so no need to mask interrupts
+    uint8_t count = 0;
+    while (cursor != head && count < maxCount) {
+        times[count++] = pulseTimes[cursor & (PULSE_HISTORY - 1)];
+        cursor++;
+    }
+    return count;
+}
+
 void RPMCounter::startAccelerationTest() {
-    accelerationTestStartTime = micros();
+    accelerationTestStartTime = Hal::micros();
     accelerationTestActive = true;
-    Serial.println("Acceleration test timing started");
+    if (channel != NO_CHANNEL) LOG_DEBUG("ch%ld: acceleration test timing started", channel);
 }
 
-float RPMCounter::getAccelerationRPM() {
+uint32_t RPMCounter::getAccelerationCentiRpm() const {
     if (!accelerationTestActive) {
-        return 0.0; // No test running
+        return 0; // No test running
     }
     
     // Use the real-time RPM calculation instead of trying to calculate from total count
-    return getCurrentRPM();
+    return getCurrentCentiRpm();
 }
\ No newline at end of file
@@ -1,68 +1,109 @@
 #ifndef RPM_COUNTER_H
 #define RPM_COUNTER_H
 
-#include <Arduino.h>
+#include "Hal.h"
+#include "SpeedEstimator.h"
+#include "SensorDiagnostics.h"
+#include "EdgeCapture.h"
 
+// One sensor input. Each tested motor (see Channels) owns an instance; its
+// edges arrive from an EdgeCapture backend (a GPIO interrupt, or a hardware
+// capture unit on the ESP32).
 class RPMCounter {
 public:
-    static void begin(uint8_t pin);
-    static void update(); // Call this regularly in loop() to process pending signals
-    static void reset(); // Reset all counters and RPM values
-    static void startAccelerationTest(); // Mark start time for acceleration test
-    static float getAccelerationRPM(); // Get RPM based on time since test start
+    static const uint8_t PULSE_HISTORY = 64; // Accepted pulses kept for readPulses(), power of two
     
-    // ISR function - must be public and static for interrupt attachment
-    static void IRAM_ATTR handleSignalChange();
+    // Receive `pin`'s edges through `capture`
+    void begin(uint8_t channel, uint8_t pin, EdgeCapture& capture);
+    void update(); // Call this regularly in loop() to process pending signals
+    void reset(); // Reset all counters and RPM values
+    void startAccelerationTest(); // Mark start time for acceleration test
+    uint32_t getAccelerationCentiRpm() const; // Current reading while a test is active, 0 otherwise
+    
+    // Body of the sensor interrupt (GPIO backend): reads the time and the pin
+    void IRAM_ATTR handleSignalChange();
+    // Same for backends that timestamp the edge in hardware
+    void IRAM_ATTR handleCapturedEdge(unsigned long timestamp, bool pinState);
+    // Filter and timestamp logic of the ISR, given an edge time and the pin
+    // level after the edge (also driven directly by the benchmarks)
+    void IRAM_ATTR processEdge(unsigned long timestamp, bool pinState);
+    
+    // Channel of a counter begin() was never called for (the benchmarks'):
+    // it logs nothing and never matches the traced channel
+    static const uint8_t NO_CHANNEL = 0xFF;
     
     // Getters for RPM data
-    static unsigned long getSignalCount();
-    static unsigned long getLastSignalTime();
-    static bool hasPendingSignal();
-    static float getCurrentRPM(); // Calculate current RPM based on recent signals
-    static unsigned long getTimeBetweenSignals(); // Get last interval in microseconds
+    uint8_t getChannel() const { return channel; }
+    uint8_t getPin() const { return sensorPin; }
+    unsigned long getSignalCount() const;
+    unsigned long getRejectedCount() const { return rejectedCount; } // Pulses dropped by the width/consistency filters
+    unsigned long getLastSignalTime() const;
+    bool hasPendingSignal() const;
+    // RPM readings are kept in hundredths of an RPM (centi-RPM) so nothing on
+    // the measurement path needs soft-float
+    uint32_t getCurrentCentiRpm() const; // Latest reading, 0 once signals are stale
+    float getCurrentRPM() const; // Convenience for host tools - avoid on the device
+    static uint32_t intervalToCentiRpm(unsigned long intervalMicros);
+    unsigned long getTimeBetweenSignals() const; // Get last interval in microseconds
+    unsigned long getFirstReadingTime() const; // millis() of the first valid RPM reading since boot, 0 if none yet
+    // Smoothed speed, acceleration and torque, updated from every accepted
+    // pulse by update(). Restarts on reset() and when the signal goes stale.
+    const SpeedEstimator& getEstimator() const { return estimator; }
+    // Width/interval histograms and reject counters since begin() or the
+    // last clear - not touched by reset(), so they span test runs
+    const SensorDiagnostics& getDiagnostics() const { return diagnostics; }
+    void clearDiagnostics() { diagnostics.clear(); }
+    
+    // Per-pulse data for consumers that need every pulse (UDP telemetry).
+    // `cursor` is the consumer's position in the signal count; start it at
+    // getSignalCount(). Copies the micros() of each accepted pulse since then,
+    // oldest first, and advances the cursor. Pulses the history has already
+    // overwritten are skipped and added to `lost`.
+    uint8_t readPulses(unsigned long& cursor, uint32_t* times, uint8_t maxCount, unsigned long& lost) const;
     
 private:
-    static volatile bool signalPending;
-    static volatile unsigned long signalCount;
-    static volatile unsigned long lastSignalTime;
-    static volatile unsigned long blockingTimestamp;
-    static volatile float currentRPM; // Store current RPM calculation
-    static volatile unsigned long lastIntervalMicros; // Time between last two signals in microseconds
-    static uint8_t sensorPin;
+    // ISR state first, main-loop state after it
+    volatile bool signalPending = false;
+    volatile bool timestampReady = false;
+    volatile bool risingEdgeDetected = false;
+    volatile bool accelerationTestActive = false; // Flag to track if test is active
+    uint8_t sensorPin = 0;
+    uint8_t channel = NO_CHANNEL;
+    
+    // Simple two-timestamp approach - capture in ISR, process in main thread
+    volatile unsigned long currentTimestamp = 0;
+    volatile unsigned long previousTimestamp = 0;
+    volatile unsigned long blockingTimestamp = 0;
+    volatile unsigned long signalCount = 0;
+    volatile unsigned long rejectedCount = 0;
     
     // Signal length filtering variables
-    static volatile unsigned long risingEdgeTime;
-    static volatile unsigned long fallingEdgeTime;
-    static volatile bool risingEdgeDetected;
+    volatile unsigned long risingEdgeTime = 0;
+    volatile unsigned long fallingEdgeTime = 0;
     
     // Signal consistency checking to detect multiple apertures
-    static volatile unsigned long lastValidSignalLength;
-    static volatile unsigned long consistentSignalCount;
+    volatile unsigned long lastValidSignalLength = 0;
+    volatile unsigned long consistentSignalCount = 0;
     
-    // Signal length limits for noise filtering
-    // Optical disc: 2mm aperture on 30mm diameter disc = 2.1% duty cycle
-    // At 30000 RPM: 42μs HIGH, at 1000 RPM: 1.26ms HIGH
-    // Tightened range based on actual measurements to filter multiple apertures
-    static const unsigned long MIN_SIGNAL_LENGTH_US = 600;  // 600μs minimum (more selective)
-    static const unsigned long MAX_SIGNAL_LENGTH_US = 1400; // 1.4ms maximum (more selective)
+    SensorDiagnostics diagnostics;
     
-    // Acceleration test timing
-    static volatile unsigned long accelerationTestStartTime; // Test start time in microseconds
-    static volatile bool accelerationTestActive; // Flag to track if test is active
+    // Main-loop side
+    volatile unsigned long lastSignalTime = 0;
+    volatile uint32_t currentCentiRpm = 0; // Latest reading in RPM x 100
+    volatile unsigned long lastIntervalMicros = 0; // Time between last two signals in microseconds
+    unsigned long firstReadingTime = 0;
+    SpeedEstimator estimator;
+    unsigned long estimatorCursor = 0; // readPulses() position of the estimator
+    unsigned long estimatorLost = 0;
     
-    // Simple two-timestamp approach - capture in ISR, process in main thread
-    static volatile unsigned long currentTimestamp;
-    static volatile unsigned long previousTimestamp;
-    static volatile bool timestampReady;
+    // Acceleration test timing
+    volatile unsigned long accelerationTestStartTime = 0; // Test start time in microseconds
     
-    // Minimum time between valid signals (debouncing)
-    // Should be much shorter than our shortest valid signal (30μs)
-    // Set to 10μs to handle electrical bounce without blocking valid signals
-    static const unsigned long DEBOUNCE_TIME_US = 10; // 10μs in microseconds
+    // Rising edge of the last PULSE_HISTORY accepted pulses, indexed by signalCount
+    volatile uint32_t pulseTimes[PULSE_HISTORY] = {0};
     
-    // Maximum reasonable RPM to filter out erroneous readings
-    static constexpr float MAX_REASONABLE_RPM = 25000.0; // Reject readings above 25k RPM
-    static constexpr float MIN_REASONABLE_RPM = 10.0;     // Reject readings below 10 RPM
+    // Debounce time, signal length limits and RPM bounds come from
+    // ConfigStore (see TesterConfig) so they can be tuned at runtime
 };
 
 #endif
\ No newline at end of file
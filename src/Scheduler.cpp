@@ -0,0 +1,169 @@
+#include "Scheduler.h"
+#include "Logger.h"
+
+// Static member definitions
+SchedulerTask Scheduler::tasks[Scheduler::MAX_TASKS];
+uint8_t Scheduler::taskCount = 0;
+unsigned long Scheduler::idleMicros = 0;
+
+int Scheduler::addTask(const char* name, TaskFunction function,
+                       unsigned long periodMicros, uint8_t priority, unsigned long budgetMicros,
+                       bool locked) {
+  if (taskCount >= MAX_TASKS) {
+    LOG_ERROR("Scheduler full, task not added (MAX_TASKS = %ld)", (long)MAX_TASKS);
+    return -1;
+  }
+  if (function == nullptr || periodMicros == 0) {
+    return -1;
+  }
+
+  SchedulerTask& task = tasks[taskCount];
+  memset(&task, 0, sizeof(task));
+  task.name = name;
+  task.function = function;
+  task.periodMicros = periodMicros;
+  task.budgetMicros = budgetMicros;
+  task.priority = priority;
+  task.locked = locked;
+  task.nextRelease = Hal::micros();
+
+  return taskCount++;
+}
+
+void Scheduler::run() {
+  // Run every due task at most once per call so loop() returns to the
+  // ESP8266 system context (WiFi stack) between passes. On the ESP32 this
+  // runs in its own task on core 1 and WiFi has core 0 to itself.
+  for (uint8_t i = 0; i < taskCount; i++) {
+    unsigned long now = Hal::micros();
+    int id = pickTask(now);
+    if (id < 0) {
+      // Nothing runnable: every task is either waiting for its release or
+      // deferred until a higher-priority release has been served
+      sleepUntilNextRelease();
+      return;
+    }
+    runTask(tasks[id], now);
+  }
+}
+
+int Scheduler::pickTask(unsigned long now) {
+  int best = -1;
+
+  for (uint8_t i = 0; i < taskCount; i++) {
+    SchedulerTask& task = tasks[i];
+    long lateness = (long)(now - task.nextRelease);
+    if (lateness < 0) continue; // Not released yet
+
+    // Only start this task if its budget fits before the next release of any
+    // higher-priority task - unless it has already waited a whole period
+    if ((unsigned long)lateness < task.periodMicros) {
+      bool fits = true;
+      for (uint8_t j = 0; j < taskCount; j++) {
+        if (tasks[j].priority >= task.priority) continue;
+        long slack = (long)(tasks[j].nextRelease - now);
+        if (slack > 0 && task.budgetMicros > (unsigned long)slack) {
+          fits = false;
+          break;
+        }
+      }
+      if (!fits) {
+        // A release can be held back over many passes - count it once
+        if (!task.deferredThisRelease) {
+          task.deferred++;
+          task.deferredThisRelease = true;
+        }
+        continue;
+      }
+    }
+
+    // Highest priority wins, earliest release breaks ties
+    if (best < 0 ||
+        task.priority < tasks[best].priority ||
+        (task.priority == tasks[best].priority &&
+         (long)(task.nextRelease - tasks[best].nextRelease) < 0)) {
+      best = i;
+    }
+  }
+
+  return best;
+}
+
+void Scheduler::runTask(SchedulerTask& task, unsigned long now) {
+  if (task.locked) {
+    // Web handlers on the other core (ESP32) wait for the task to finish,
+    // never for the sleep in between
+    Hal::MeasurementLock lock;
+    task.function();
+  } else {
+    task.function();
+  }
+
+  unsigned long end = Hal::micros();
+  unsigned long runTime = end - now;
+  task.deferredThisRelease = false;
+
+  task.runCount++;
+  task.lastRunMicros = runTime;
+  task.totalRunMicros += runTime;
+  if (runTime > task.maxRunMicros) task.maxRunMicros = runTime;
+  if (runTime > task.budgetMicros) task.overBudget++;
+
+  // Implicit deadline: the task must complete before its next release
+  task.nextRelease += task.periodMicros;
+  if ((long)(end - task.nextRelease) > 0) {
+    task.missedDeadlines++;
+
+    // Fell behind by at least one period - resynchronise instead of
+    // running a burst of back-to-back catch-up invocations
+    if ((long)(end - task.nextRelease) >= (long)task.periodMicros) {
+      task.nextRelease = end;
+    }
+  }
+}
+
+void Scheduler::sleepUntilNextRelease() {
+  // Released tasks that weren't picked are deferred, so the next thing
+  // worth waking up for is the earliest future release
+  unsigned long now = Hal::micros();
+  long wait = 0;
+  for (uint8_t i = 0; i < taskCount; i++) {
+    long untilRelease = (long)(tasks[i].nextRelease - now);
+    if (untilRelease > 0 && (wait == 0 || untilRelease < wait)) wait = untilRelease;
+  }
+
+  if (wait <= 0) return;
+
+  Hal::sleepMicros(wait);
+
+  // The sleep may round down to whole milliseconds (and may overrun), so
+  // count the time actually slept rather than the wait
+  idleMicros += Hal::micros() - now;
+}
+
+uint8_t Scheduler::getTaskCount() {
+  return taskCount;
+}
+
+const SchedulerTask& Scheduler::getTask(uint8_t id) {
+  return tasks[id];
+}
+
+unsigned long Scheduler::getIdleMicros() {
+  return idleMicros;
+}
+
+void Scheduler::resetStats() {
+  for (uint8_t i = 0; i < taskCount; i++) {
+    SchedulerTask& task = tasks[i];
+    task.runCount = 0;
+    task.lastRunMicros = 0;
+    task.maxRunMicros = 0;
+    task.totalRunMicros = 0;
+    task.missedDeadlines = 0;
+    task.overBudget = 0;
+    task.deferred = 0;
+    task.deferredThisRelease = false;
+  }
+  idleMicros = 0;
+}
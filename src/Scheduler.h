@@ -0,0 +1,65 @@
+#ifndef MOTOR_TESTER_SCHEDULER_H
+#define MOTOR_TESTER_SCHEDULER_H
+
+#include "Hal.h"
+
+typedef void (*TaskFunction)();
+
+// Per-task bookkeeping, exposed read-only for the /api/scheduler endpoint
+struct SchedulerTask {
+  const char* name;
+  TaskFunction function;
+  unsigned long periodMicros;   // Release period (deadline = release + period)
+  unsigned long budgetMicros;   // Expected worst-case run time per invocation
+  uint8_t priority;             // 0 = highest priority
+
+  unsigned long nextRelease;    // micros() timestamp of the next release
+
+  // Statistics
+  unsigned long runCount;
+  unsigned long lastRunMicros;
+  unsigned long maxRunMicros;
+  unsigned long totalRunMicros;
+  unsigned long missedDeadlines; // Finished after release + period (or skipped a period)
+  unsigned long overBudget;      // Ran longer than budgetMicros
+  unsigned long deferred;        // Releases held back to protect a higher-priority deadline
+  bool deferredThisRelease;      // Already counted in deferred since the last run
+  bool locked;                  // Runs under Hal::MeasurementLock
+};
+
+// Cooperative deadline scheduler that replaces the delay()-driven main loop.
+// Tasks run to completion; the scheduler picks the highest-priority due task,
+// only starts a lower-priority task if its budget fits before the next
+// higher-priority release, and sleeps until the next deadline when idle.
+// A task that has been held back for a whole period runs regardless, so
+// background services can't be starved by the measurement path.
+class Scheduler {
+  public:
+    // Exactly the tasks main.cpp registers, see the table in README_RPM.md
+    // ("Main Loop Scheduling") - raise it along with a new task
+    static const uint8_t MAX_TASKS = 12;
+
+    // Returns the task id, or -1 (and logs an error) if the task table is full.
+    // Pass locked = false for network tasks that may block (OTA upload, WiFi):
+    // they take Hal::MeasurementLock themselves around any shared state.
+    static int addTask(const char* name, TaskFunction function,
+                       unsigned long periodMicros, uint8_t priority, unsigned long budgetMicros,
+                       bool locked = true);
+    static void run(); // Call from loop()
+
+    static uint8_t getTaskCount();
+    static const SchedulerTask& getTask(uint8_t id);
+    static unsigned long getIdleMicros();
+    static void resetStats();
+
+  private:
+    static SchedulerTask tasks[MAX_TASKS];
+    static uint8_t taskCount;
+    static unsigned long idleMicros;
+
+    static int pickTask(unsigned long now);
+    static void runTask(SchedulerTask& task, unsigned long now);
+    static void sleepUntilNextRelease();
+};
+
+#endif
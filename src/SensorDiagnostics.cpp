@@ -0,0 +1,48 @@
+#include "SensorDiagnostics.h"
+
+void SensorDiagnostics::clear() {
+  // The ISR may be counting on this channel - a count lost across a clear
+  // doesn't matter, a half-cleared array would
+  Hal::disableInterrupts();
+  for (uint8_t i = 0; i < BINS; i++) {
+    widths[i] = 0;
+    intervals[i] = 0;
+  }
+  for (uint8_t i = 0; i < REASON_COUNT; i++) {
+    rejected[i] = 0;
+  }
+  accepted = 0;
+  haveRisingEdge = false;
+  Hal::enableInterrupts();
+}
+
+uint32_t SensorDiagnostics::getTotalRejected() const {
+  uint32_t total = 0;
+  for (uint8_t i = 0; i < REASON_COUNT; i++) {
+    total += rejected[i];
+  }
+  return total;
+}
+
+bool SensorDiagnostics::isClean() const {
+  return accepted >= MIN_CLEAN_PULSES && (uint64_t)getTotalRejected() * 100 <= accepted;
+}
+
+const char* SensorDiagnostics::getReasonName(Reason reason) {
+  switch (reason) {
+    case REJECT_DEBOUNCE: return "debounce";
+    case REJECT_NO_RISING_EDGE: return "noRisingEdge";
+    case REJECT_TOO_SHORT: return "tooShort";
+    case REJECT_TOO_LONG: return "tooLong";
+    case REJECT_INCONSISTENT: return "inconsistent";
+    case REJECT_IMPLAUSIBLE: return "implausibleRpm";
+    default: return "unknown";
+  }
+}
+
+uint32_t SensorDiagnostics::getBinStartUs(uint8_t bin) {
+  // Bin 0 holds 0 and 1 us, bin 1 stays empty
+  if (bin < 2) return 0;
+  uint8_t msb = bin / 2;
+  return (1UL << msb) | ((uint32_t)(bin & 1) << (msb - 1));
+}
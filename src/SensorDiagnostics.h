@@ -0,0 +1,77 @@
+#ifndef MOTOR_TESTER_SENSOR_DIAGNOSTICS_H
+#define MOTOR_TESTER_SENSOR_DIAGNOSTICS_H
+
+#include "Hal.h"
+
+// What one sensor input has seen, filled in by the ISR: histograms of every
+// pulse width and every rising-to-rising interval (before any filtering),
+// and a counter per reason a pulse was thrown away. A misaligned sensor
+// shows up here as a spread-out width histogram or a climbing reject
+// counter long before the RPM readings look wrong.
+//
+// The histograms are log scale, two bins per octave (bin 2n covers
+// 2^n..1.5*2^n us, bin 2n+1 the rest of the octave), from 1 us up to 16.7 s.
+// Recording is a handful of compares and one increment, whatever the value.
+class SensorDiagnostics {
+  public:
+    static const uint8_t BINS = 48;
+    static const uint16_t MIN_CLEAN_PULSES = 20;
+
+    enum Reason : uint8_t {
+      REJECT_DEBOUNCE,       // Edge within debounceUs of the last accepted pulse
+      REJECT_NO_RISING_EDGE, // Falling edge without a rising edge before it
+      REJECT_TOO_SHORT,      // Below minSignalLengthUs
+      REJECT_TOO_LONG,       // Above maxSignalLengthUs
+      REJECT_INCONSISTENT,   // More than 50 % off the last accepted width
+      REJECT_IMPLAUSIBLE,    // Accepted, but the interval is outside min/maxReasonableRpm (main loop)
+      REASON_COUNT
+    };
+
+    void clear();
+
+    // Called from the sensor ISR
+    inline void IRAM_ATTR recordWidth(uint32_t widthUs) { widths[binOf(widthUs)]++; }
+    inline void IRAM_ATTR recordRisingEdge(uint32_t timeUs) {
+      if (haveRisingEdge) intervals[binOf(timeUs - lastRisingEdgeUs)]++;
+      lastRisingEdgeUs = timeUs;
+      haveRisingEdge = true;
+    }
+    inline void IRAM_ATTR recordAccepted() { accepted++; }
+    inline void IRAM_ATTR reject(Reason reason) { rejected[reason]++; }
+
+    uint32_t getWidthCount(uint8_t bin) const { return widths[bin]; }
+    uint32_t getIntervalCount(uint8_t bin) const { return intervals[bin]; }
+    uint32_t getAcceptedCount() const { return accepted; }
+    uint32_t getRejectedCount(Reason reason) const { return rejected[reason]; }
+    uint32_t getTotalRejected() const;
+    // At least MIN_CLEAN_PULSES accepted and at most 1 % as many thrown away
+    bool isClean() const;
+
+    static const char* getReasonName(Reason reason);
+    static uint32_t getBinStartUs(uint8_t bin);
+
+    // Bins are found with shifts and compares - __builtin_clz is a libgcc
+    // call on the ESP8266, which may not be in IRAM
+    static inline uint8_t IRAM_ATTR binOf(uint32_t us) {
+      uint32_t value = us;
+      uint8_t msb = 0;
+      if (value >= 1UL << 16) { value >>= 16; msb += 16; }
+      if (value >= 1UL << 8) { value >>= 8; msb += 8; }
+      if (value >= 1UL << 4) { value >>= 4; msb += 4; }
+      if (value >= 1UL << 2) { value >>= 2; msb += 2; }
+      if (value >= 1UL << 1) { msb += 1; }
+      uint8_t half = msb > 0 ? (us >> (msb - 1)) & 1 : 0;
+      uint8_t bin = msb * 2 + half;
+      return bin < BINS ? bin : BINS - 1;
+    }
+
+  private:
+    volatile uint32_t widths[BINS] = {0};
+    volatile uint32_t intervals[BINS] = {0};
+    volatile uint32_t rejected[REASON_COUNT] = {0};
+    volatile uint32_t accepted = 0;
+    volatile uint32_t lastRisingEdgeUs = 0;
+    volatile bool haveRisingEdge = false;
+};
+
+#endif
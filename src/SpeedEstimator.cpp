@@ -0,0 +1,150 @@
+#include "SpeedEstimator.h"
+#include "RPMCounter.h"
+#include "ConfigStore.h"
+
+#include <math.h>
+
+SpeedEstimator::Gains SpeedEstimator::bandGains[BANDS];
+SpeedEstimator::Gains SpeedEstimator::startupGains[STARTUP_STEPS];
+
+namespace {
+  uint32_t toQ16(double value) {
+    return (uint32_t)(value * 65536.0 + 0.5);
+  }
+}
+
+void SpeedEstimator::reset() {
+  restart();
+  peakTorqueMicroNm = 0;
+  outliers = 0;
+}
+
+void SpeedEstimator::restart() {
+  speed = 0;
+  acceleration = 0;
+  havePrevious = false;
+  lastIntervalUs = 0;
+  steps = 0;
+  consecutiveOutliers = 0;
+}
+
+void SpeedEstimator::addPulse(uint32_t pulseUs) {
+  uint32_t interval = pulseUs - previousPulseUs; // Wraps correctly
+  bool first = !havePrevious;
+  previousPulseUs = pulseUs;
+  havePrevious = true;
+  if (first) return;
+
+  // Same bounds as RPMCounter's own reading; anything outside them starts over
+  const TesterConfig& config = ConfigStore::get();
+  uint32_t centiRpm = RPMCounter::intervalToCentiRpm(interval);
+  if (centiRpm < config.minReasonableRpm * 100UL || centiRpm > config.maxReasonableRpm * 100UL) {
+    steps = 0;
+    return;
+  }
+  addInterval(interval, centiRpm);
+}
+
+void SpeedEstimator::addInterval(uint32_t intervalUs, uint32_t centiRpm) {
+  int64_t measured = (int64_t)centiRpm << 16;
+  lastIntervalUs = intervalUs;
+  if (steps == 0) {
+    speed = measured;
+    acceleration = 0;
+    steps = 1;
+    return;
+  }
+
+  // Predict the speed at this pulse; the measurement is the average over the
+  // interval, i.e. the prediction minus half the change across it
+  int64_t change = acceleration / 1000 * intervalUs / 1000; // Split so long intervals can't overflow
+  int64_t predicted = speed + change;
+  int64_t residual = measured - (predicted - change / 2);
+
+  // A pulse the ISR filtered out doubles an interval and halves its RPM.
+  // Coast through such outliers on the prediction; several in a row mean
+  // the speed really changed, so start over from the measurement.
+  if (steps > 4 && (residual > predicted / 4 || residual < -predicted / 4)) {
+    outliers++;
+    if (++consecutiveOutliers >= MAX_OUTLIERS) {
+      consecutiveOutliers = 0;
+      speed = measured;
+      acceleration = 0;
+      steps = 1;
+    } else {
+      speed = predicted;
+    }
+    return;
+  }
+  consecutiveOutliers = 0;
+
+  // Fresh filters use least-squares (growing memory) gains, which settle
+  // far faster than the steady-state ones would from a zero acceleration
+  const Gains& gains = bandGains[bandOf(intervalUs)];
+  uint32_t alpha = gains.alpha;
+  uint32_t beta = gains.beta;
+  if (steps <= STARTUP_STEPS) {
+    const Gains& startup = startupGains[steps - 1];
+    if (startup.alpha > alpha) alpha = startup.alpha;
+    if (startup.beta > beta) beta = startup.beta;
+    steps++;
+  }
+
+  speed = predicted + ((residual * alpha) >> 16);
+  acceleration += ((residual * beta) >> 16) * 1000000 / intervalUs;
+
+  // The first few acceleration estimates are mostly noise
+  if (steps > 4) {
+    int32_t torque = getTorqueMicroNm();
+    if (torque > peakTorqueMicroNm) peakTorqueMicroNm = torque;
+  }
+}
+
+uint32_t SpeedEstimator::getCentiRpm(uint32_t nowUs) const {
+  if (steps == 0) return 0;
+  uint32_t elapsed = nowUs - previousPulseUs;
+  if (elapsed > lastIntervalUs) elapsed = lastIntervalUs;
+  int64_t centiRpm = (speed + acceleration / 1000 * elapsed / 1000) >> 16;
+  return centiRpm > 0 ? (uint32_t)centiRpm : 0;
+}
+
+int32_t SpeedEstimator::getCentiRpmPerSecond() const {
+  if (steps == 0) return 0;
+  return (int32_t)(acceleration >> 16);
+}
+
+int32_t SpeedEstimator::getTorqueMicroNm() const {
+  // T = J * dw/dt: g cm^2 = 1e-7 kg m^2, 1 RPM/s = 2 pi / 60 rad/s^2, so
+  // uN m = J * centi-RPM/s * 1.0472e-4
+  int64_t inertia = ConfigStore::get().rotorInertiaGcm2;
+  return (int32_t)(inertia * getCentiRpmPerSecond() * 10472 / 100000000);
+}
+
+void SpeedEstimator::buildGains(uint32_t noiseRpm, uint32_t jerkRpmPerS2) {
+  // Steady-state alpha-beta gains from the tracking index
+  // lambda = jerk * T^2 / noise, T at the geometric centre of each band
+  for (uint8_t band = 0; band < BANDS; band++) {
+    double bit = ldexp(1.0, band / 2);
+    double low = bit * (1.0 + 0.5 * (band & 1));
+    double seconds = sqrt(low * (low + 0.5 * bit)) / 1000000.0;
+    double lambda = (double)jerkRpmPerS2 * seconds * seconds / noiseRpm;
+    double r = (4.0 + lambda - sqrt(8.0 * lambda + lambda * lambda)) / 4.0;
+    double alpha = 1.0 - r * r;
+    double beta = 2.0 * (2.0 - alpha) - 4.0 * sqrt(1.0 - alpha);
+    bandGains[band].alpha = toQ16(alpha);
+    bandGains[band].beta = toQ16(beta);
+  }
+
+  // Growing-memory gains after n measurements: a least-squares line fit
+  for (uint8_t n = 1; n <= STARTUP_STEPS; n++) {
+    double denominator = (n + 1.0) * (n + 2.0);
+    startupGains[n - 1].alpha = toQ16(2.0 * (2.0 * n + 1.0) / denominator);
+    startupGains[n - 1].beta = toQ16(6.0 / denominator);
+  }
+}
+
+uint8_t SpeedEstimator::bandOf(uint32_t intervalUs) {
+  uint8_t msb = 31 - __builtin_clz(intervalUs); // Bounds checks guarantee intervalUs > 0
+  uint8_t half = msb > 0 ? (intervalUs >> (msb - 1)) & 1 : 0;
+  return msb * 2 + half;
+}
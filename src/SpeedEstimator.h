@@ -0,0 +1,69 @@
+#ifndef MOTOR_TESTER_SPEED_ESTIMATOR_H
+#define MOTOR_TESTER_SPEED_ESTIMATOR_H
+
+#include "Hal.h"
+
+// Two-state (speed, acceleration) Kalman filter over the accepted pulses of
+// one RPMCounter, run once per pulse. With a constant-jerk process model and
+// constant measurement noise the Kalman gains settle to those of an
+// alpha-beta filter, which only depend on the interval length. They are
+// precomputed per half-octave of interval (Kalata's tracking index), so a
+// pulse costs a few integer multiplies and one 64-bit divide.
+//
+// An interval's RPM is the average speed across it - the speed at its
+// midpoint, half an interval old. The filter compares the measurement with
+// its prediction for that midpoint, so the estimate refers to the latest
+// pulse instead of lagging behind it.
+class SpeedEstimator {
+  public:
+    static const uint8_t STARTUP_STEPS = 16; // Least-squares gains until the steady-state ones take over
+    static const uint8_t MAX_OUTLIERS = 3;   // Consecutive implausible intervals before starting over
+
+    void reset();   // Start over and clear the peak torque
+    void restart(); // Start over from the next pulse, e.g. after a stall
+    void addPulse(uint32_t pulseUs); // micros() of an accepted pulse, in order
+
+    bool isValid() const { return steps > 0; }
+    bool isSettled() const { return steps > STARTUP_STEPS; } // Past the start-up gains
+    // Speed extrapolated to `nowUs` (at most one interval past the last
+    // pulse), 0 until the filter has a reading
+    uint32_t getCentiRpm(uint32_t nowUs) const;
+    int32_t getCentiRpmPerSecond() const; // Acceleration, 0 until the filter has a reading
+    // Torque accelerating the rotor, from TesterConfig::rotorInertiaGcm2
+    // (0 if that isn't configured). The peak is kept since reset().
+    int32_t getTorqueMicroNm() const;
+    int32_t getPeakTorqueMicroNm() const { return peakTorqueMicroNm; }
+    unsigned long getOutlierCount() const { return outliers; }
+
+    // Rebuilds the gain tables shared by all channels. Milliseconds of
+    // software floating point on the ESP8266, so ConfigStore calls it when
+    // the configuration is loaded or applied - never from the pulse path.
+    static void buildGains(uint32_t noiseRpm, uint32_t jerkRpmPerS2);
+
+  private:
+    struct Gains {
+      uint32_t alpha; // Q16
+      uint32_t beta;  // Q16, divided by the interval when applied
+    };
+    static const uint8_t BANDS = 64; // Two per bit of a 32-bit interval
+
+    // Speed in centi-RPM and acceleration in centi-RPM/s, both Q16
+    int64_t speed = 0;
+    int64_t acceleration = 0;
+    uint32_t previousPulseUs = 0;
+    uint32_t lastIntervalUs = 0;
+    bool havePrevious = false;
+    uint8_t steps = 0;              // Intervals filtered since the last restart, up to STARTUP_STEPS + 1
+    uint8_t consecutiveOutliers = 0;
+    unsigned long outliers = 0;
+    int32_t peakTorqueMicroNm = 0;
+
+    // Shared by all channels, see buildGains()
+    static Gains bandGains[BANDS];
+    static Gains startupGains[STARTUP_STEPS];
+
+    void addInterval(uint32_t intervalUs, uint32_t centiRpm);
+    static uint8_t bandOf(uint32_t intervalUs);
+};
+
+#endif
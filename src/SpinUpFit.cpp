@@ -0,0 +1,100 @@
+#include "SpinUpFit.h"
+
+#include <math.h>
+
+void SpinUpFit::reset() {
+  pairs = 0;
+  sumX = 0;
+  sumY = 0;
+  sumXX = 0;
+  sumXY = 0;
+  previousCentiRpm = 0;
+  havePrevious = false;
+  stableCount = 0;
+  model = {0, 0, 0, 0, false};
+}
+
+void SpinUpFit::skipSample() {
+  havePrevious = false;
+}
+
+void SpinUpFit::addSample(unsigned long timeMs, uint32_t centiRpm) {
+  if (havePrevious) {
+    int64_t x = previousCentiRpm;
+    int64_t y = centiRpm;
+    sumX += x;
+    sumY += y;
+    sumXX += x * x;
+    sumXY += x * y;
+    if (pairs < UINT16_MAX) pairs++;
+    solve(timeMs, centiRpm);
+  }
+  previousCentiRpm = centiRpm;
+  havePrevious = true;
+}
+
+void SpinUpFit::solve(unsigned long timeMs, uint32_t centiRpm) {
+  // Sums stay integer (exact); the 2x2 solve needs double - the
+  // determinant is a small difference of two large numbers. Once per
+  // sample, so soft-float is affordable here.
+  double n = pairs;
+  double determinant = n * (double)sumXX - (double)sumX * (double)sumX;
+  if (pairs < 2 || determinant <= 0.0) return;
+  double p = (n * (double)sumXY - (double)sumX * (double)sumY) / determinant;
+  double q = ((double)sumY - p * (double)sumX) / n;
+
+  // Only a speed levelling off upwards is a spin-up
+  if (p <= 0.0 || p >= 1.0 || q <= 0.0) {
+    stableCount = 0;
+    model.finalCentiRpm = 0;
+    return;
+  }
+
+  double finalCentiRpm = q / (1.0 - p);
+  double tauMs = -SAMPLE_MS / log(p);
+  if (finalCentiRpm > 1e9 || tauMs > 1e9) return; // Still a straight line, nothing to report
+
+  uint32_t previousFinal = model.finalCentiRpm;
+  model.finalCentiRpm = (uint32_t)(finalCentiRpm + 0.5);
+  model.tauMs = (uint32_t)(tauMs + 0.5);
+  model.samples = pairs + 1;
+
+  // Dead time from the latest sample - near wInf the log is too sensitive,
+  // keep the last value then
+  if (centiRpm > 0 && centiRpm < 0.9 * finalCentiRpm) {
+    model.offsetMs = (int32_t)lround(timeMs + tauMs * log(1.0 - centiRpm / finalCentiRpm));
+  }
+
+  uint32_t change = model.finalCentiRpm > previousFinal ? model.finalCentiRpm - previousFinal
+                                                        : previousFinal - model.finalCentiRpm;
+  if (previousFinal > 0 && change * 100ULL <= (uint64_t)model.finalCentiRpm * STABLE_PERCENT) {
+    if (stableCount < UINT8_MAX) stableCount++;
+  } else {
+    stableCount = 0;
+  }
+}
+
+bool SpinUpFit::predictsShortOf(uint32_t centiRpm, uint32_t marginPercent) const {
+  if (model.samples < MIN_SAMPLES || stableCount < STABLE_SAMPLES || model.finalCentiRpm == 0) {
+    return false;
+  }
+  return (uint64_t)model.finalCentiRpm * (100 + marginPercent) < (uint64_t)centiRpm * 100;
+}
+
+unsigned long SpinUpFit::timeToRpm(const SpinUpModel& model, uint32_t rpm, double finalScale) {
+  double finalCentiRpm = model.finalCentiRpm * finalScale;
+  double target = rpm * 100.0;
+  if (model.finalCentiRpm == 0 || target >= finalCentiRpm) return 0;
+
+  double timeMs;
+  if (model.offsetMs >= 0) {
+    // From standstill after the dead time
+    timeMs = model.offsetMs + model.tauMs * log(finalCentiRpm / (finalCentiRpm - target));
+  } else {
+    // Still coasting at switch-on: the speed the unscaled model had at t = 0
+    double startCentiRpm = model.finalCentiRpm * (1.0 - exp((double)model.offsetMs / model.tauMs));
+    if (target <= startCentiRpm) return 0;
+    timeMs = model.tauMs * log((finalCentiRpm - startCentiRpm) / (finalCentiRpm - target));
+  }
+  return timeMs > 0.0 ? (unsigned long)(timeMs + 0.5) : 0;
+}
@@ -0,0 +1,59 @@
+#ifndef MOTOR_TESTER_SPIN_UP_FIT_H
+#define MOTOR_TESTER_SPIN_UP_FIT_H
+
+#include "Hal.h"
+
+// First-order spin-up model w(t) = wInf * (1 - e^(-(t - offset) / tau)),
+// t in ms since the bridge was switched on
+struct SpinUpModel {
+  uint32_t finalCentiRpm;  // wInf, 0 = no fit yet
+  uint32_t tauMs;
+  int32_t offsetMs;        // Dead time; negative if the rotor was still coasting
+  uint16_t samples;
+  bool earlyAbort;         // The test gave up on this fit instead of timing out
+};
+
+// Online least-squares fit of the spin-up curve. Speed samples on a fixed
+// SAMPLE_MS grid of a first-order system satisfy
+//   w[k+1] = p * w[k] + q,  p = e^(-SAMPLE_MS / tau),  q = wInf * (1 - p)
+// which is linear in p and q, so the fit only keeps running sums and solves
+// a 2x2 system per sample. It needs neither the start time nor the starting
+// speed, so dead time and a rotor still coasting from the last run don't
+// bias it.
+class SpinUpFit {
+  public:
+    static const uint16_t SAMPLE_MS = 50;
+    static const uint8_t MIN_SAMPLES = 8;     // Before the model is used at all
+    static const uint8_t STABLE_SAMPLES = 3;  // wInf within STABLE_PERCENT this many times in a row
+    static const uint8_t STABLE_PERCENT = 2;
+
+    void reset();
+    void addSample(unsigned long timeMs, uint32_t centiRpm); // timeMs since the bridge was switched on
+    void skipSample(); // No reading for a grid point - don't pair across the gap
+
+    const SpinUpModel& getModel() const { return model; }
+    // True once the model is settled and says the speed will level off more
+    // than marginPercent below `centiRpm`
+    bool predictsShortOf(uint32_t centiRpm, uint32_t marginPercent) const;
+
+    // Time (ms since the bridge was switched on) to reach `rpm`, 0 if the
+    // model doesn't reach it or there is no model. `finalScale` scales
+    // wInf, keeping tau and the starting speed - a different supply voltage.
+    static unsigned long timeToRpm(const SpinUpModel& model, uint32_t rpm, double finalScale = 1.0);
+
+  private:
+    // Running sums over (w[k], w[k+1]) pairs, centi-RPM
+    uint16_t pairs = 0;
+    int64_t sumX = 0;
+    int64_t sumY = 0;
+    int64_t sumXX = 0;
+    int64_t sumXY = 0;
+    uint32_t previousCentiRpm = 0;
+    bool havePrevious = false;
+    uint8_t stableCount = 0;
+    SpinUpModel model = {0, 0, 0, 0, false};
+
+    void solve(unsigned long timeMs, uint32_t centiRpm);
+};
+
+#endif
@@ -0,0 +1,85 @@
+#include "SupplyMonitor.h"
+#include "Channels.h"
+#include "ConfigStore.h"
+#include "Logger.h"
+
+SupplySample SupplyMonitor::history[SupplyMonitor::HISTORY];
+unsigned long SupplyMonitor::sampleCount = 0;
+uint16_t SupplyMonitor::latestMv = 0;
+SupplyMonitor::Capture SupplyMonitor::captures[Channels::MAX_CHANNELS];
+
+void SupplyMonitor::begin() {
+  sampleCount = 0;
+  latestMv = 0;
+  memset(captures, 0, sizeof(captures));
+  if (isEnabled()) {
+    LOG_INFO("Supply monitor on A0, %lu mV full scale", ConfigStore::get().supplyFullScaleMv);
+  }
+}
+
+bool SupplyMonitor::isEnabled() {
+  return ConfigStore::get().supplyFullScaleMv > 0;
+}
+
+uint16_t SupplyMonitor::toMillivolts(int reading) {
+  return (uint16_t)(((uint32_t)reading * ConfigStore::get().supplyFullScaleMv + 511) / 1023);
+}
+
+void SupplyMonitor::update() {
+  if (!isEnabled()) return;
+
+  // analogRead() takes ~100 us on the ESP8266, and much more frequent
+  // conversions upset WiFi - hence one per task period
+  uint32_t time = Hal::micros();
+  uint16_t millivolts = toMillivolts(Hal::analogRead(PIN));
+
+  SupplySample& sample = history[sampleCount & (HISTORY - 1)];
+  sample.timeUs = time;
+  sample.millivolts = millivolts;
+  sampleCount++;
+  latestMv = millivolts;
+
+  for (uint8_t channel = 0; channel < Channels::MAX_CHANNELS; channel++) {
+    Capture& capture = captures[channel];
+    if (!capture.active || capture.samples == UINT16_MAX) continue;
+    capture.sumMv += millivolts;
+    if (capture.samples == 0 || millivolts < capture.minMv) capture.minMv = millivolts;
+    if (millivolts > capture.maxMv) capture.maxMv = millivolts;
+    capture.samples++;
+  }
+}
+
+uint8_t SupplyMonitor::readSamples(unsigned long& cursor, SupplySample* samples, uint8_t maxCount, unsigned long& lost) {
+  unsigned long head = sampleCount;
+  if (head - cursor > HISTORY) {
+    lost += head - cursor - HISTORY;
+    cursor = head - HISTORY;
+  }
+
+  // Written by a task, read from the loop or a web handler - no ISR involved
+  uint8_t count = 0;
+  while (cursor != head && count < maxCount) {
+    samples[count++] = history[cursor & (HISTORY - 1)];
+    cursor++;
+  }
+  return count;
+}
+
+void SupplyMonitor::startCapture(uint8_t channel) {
+  Capture& capture = captures[channel];
+  memset(&capture, 0, sizeof(capture));
+  capture.active = true;
+}
+
+SupplyStats SupplyMonitor::stopCapture(uint8_t channel) {
+  Capture& capture = captures[channel];
+  SupplyStats stats = {0, 0, 0, 0};
+  if (capture.active && capture.samples > 0) {
+    stats.meanMv = (uint16_t)((capture.sumMv + capture.samples / 2) / capture.samples);
+    stats.minMv = capture.minMv;
+    stats.maxMv = capture.maxMv;
+    stats.samples = capture.samples;
+  }
+  capture.active = false;
+  return stats;
+}
@@ -0,0 +1,61 @@
+#ifndef MOTOR_TESTER_SUPPLY_MONITOR_H
+#define MOTOR_TESTER_SUPPLY_MONITOR_H
+
+#include "Hal.h"
+
+// One ADC conversion of the motor supply
+struct SupplySample {
+  uint32_t timeUs;      // Hal::micros(), the same clock as RPMCounter's pulse times
+  uint16_t millivolts;
+};
+
+// Supply voltage over one test run
+struct SupplyStats {
+  uint16_t meanMv;
+  uint16_t minMv;
+  uint16_t maxMv;
+  uint16_t samples;     // 0 = no sensor, or the run was skipped
+};
+
+// Motor supply voltage on A0 through a divider (TesterConfig::supplyFullScaleMv).
+// A scheduler task takes one conversion per period into a ring buffer,
+// timestamped with micros() so samples line up with the pulse history.
+// MotorController captures mean, min and max over each test run, so time
+// to target can be normalized to TesterConfig::nominalSupplyMv.
+class SupplyMonitor {
+  public:
+    static const uint8_t HISTORY = 64;   // Samples kept for readSamples(), power of two
+    static const uint8_t PIN = A0;
+
+    static void begin();
+    static void update(); // Scheduler task, one conversion
+
+    static bool isEnabled();
+    static uint16_t getLatestMv() { return latestMv; }
+    static unsigned long getSampleCount() { return sampleCount; }
+    static uint16_t toMillivolts(int reading);
+
+    // Same contract as RPMCounter::readPulses(): start `cursor` at
+    // getSampleCount(); copies the samples since then, oldest first
+    static uint8_t readSamples(unsigned long& cursor, SupplySample* samples, uint8_t maxCount, unsigned long& lost);
+
+    // Accumulate statistics for one channel's test run
+    static void startCapture(uint8_t channel);
+    static SupplyStats stopCapture(uint8_t channel);
+
+  private:
+    struct Capture {
+      bool active;
+      uint32_t sumMv;
+      uint16_t minMv;
+      uint16_t maxMv;
+      uint16_t samples;
+    };
+
+    static SupplySample history[HISTORY];
+    static unsigned long sampleCount;
+    static uint16_t latestMv;
+    static Capture captures[]; // One per channel (MotorController includes this header, so no Channels.h here)
+};
+
+#endif
@@ -0,0 +1,167 @@
+#include "UdpTelemetry.h"
+#include "Logger.h"
+
+#ifdef ARDUINO
+#include <WiFiUdp.h>
+
+namespace {
+  WiFiUDP udp;
+
+  bool sendDatagram(const uint8_t address[4], uint16_t port, const uint8_t* data, size_t length) {
+    if (!udp.beginPacket(IPAddress(address[0], address[1], address[2], address[3]), port)) return false;
+    udp.write(data, length);
+    return udp.endPacket() == 1;
+  }
+}
+#else
+// Native build: a plain POSIX socket, so the stream can be checked against a
+// receiver on localhost
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+namespace {
+  int udpSocket = -1;
+
+  bool sendDatagram(const uint8_t address[4], uint16_t port, const uint8_t* data, size_t length) {
+    if (udpSocket < 0) udpSocket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (udpSocket < 0) return false;
+
+    sockaddr_in destination;
+    memset(&destination, 0, sizeof(destination));
+    destination.sin_family = AF_INET;
+    destination.sin_port = htons(port);
+    memcpy(&destination.sin_addr.s_addr, address, 4);
+    return sendto(udpSocket, data, length, 0, (const sockaddr*)&destination, sizeof(destination)) == (ssize_t)length;
+  }
+}
+#endif
+
+// Static member definitions
+bool UdpTelemetry::enabled = false;
+uint8_t UdpTelemetry::address[4] = {0, 0, 0, 0};
+uint16_t UdpTelemetry::port = UdpTelemetry::DEFAULT_PORT;
+uint16_t UdpTelemetry::rateHz = UdpTelemetry::DEFAULT_RATE_HZ;
+unsigned long UdpTelemetry::periodMicros = 1000000UL / UdpTelemetry::DEFAULT_RATE_HZ;
+unsigned long UdpTelemetry::lastSendMicros = 0;
+unsigned long UdpTelemetry::packetsSent = 0;
+unsigned long UdpTelemetry::sendErrors = 0;
+UdpTelemetry::Stream UdpTelemetry::streams[Channels::MAX_CHANNELS];
+TelemetryPacket UdpTelemetry::packet;
+
+bool UdpTelemetry::start(const uint8_t destination[4], uint16_t destinationPort, uint16_t rate) {
+  if (rate < MIN_RATE_HZ || rate > MAX_RATE_HZ || destinationPort == 0) return false;
+
+  memcpy(address, destination, sizeof(address));
+  port = destinationPort;
+  rateHz = rate;
+  periodMicros = 1000000UL / rate;
+  lastSendMicros = Hal::micros();
+  packetsSent = 0;
+  sendErrors = 0;
+
+  // Start every stream at the current pulse, with fresh sequence numbers
+  for (uint8_t i = 0; i < Channels::MAX_CHANNELS; i++) {
+    Stream& stream = streams[i];
+    stream.cursor = i < Channels::getCount() ? Channels::get(i).rpm.getSignalCount() : 0;
+    stream.lost = 0;
+    stream.sequence = 0;
+    stream.previousPulseUs = 0;
+    stream.havePrevious = false;
+  }
+  enabled = true;
+
+  LOG_INFO("UDP telemetry to %ld.%ld.%ld.%ld", address[0], address[1], address[2], address[3]);
+  LOG_INFO("UDP telemetry port %lu at %lu Hz", (unsigned long)port, (unsigned long)rateHz);
+  return true;
+}
+
+void UdpTelemetry::stop() {
+  if (!enabled) return;
+  enabled = false;
+  LOG_INFO("UDP telemetry stopped after %lu packets (%lu send errors)", packetsSent, sendErrors);
+}
+
+unsigned long UdpTelemetry::getLostSamples() {
+  unsigned long lost = 0;
+  for (uint8_t i = 0; i < Channels::getCount(); i++) {
+    lost += streams[i].lost;
+  }
+  return lost;
+}
+
+void UdpTelemetry::update() {
+  {
+    // This task runs without the scheduler's lock so a slow send can't hold
+    // up the web server (ESP32) - state is only touched under it
+    Hal::MeasurementLock lock;
+    if (!enabled) return;
+
+    unsigned long now = Hal::micros();
+    if (now - lastSendMicros < periodMicros) return;
+    // Keep the average rate, but don't burst to catch up after a long stall
+    lastSendMicros = (now - lastSendMicros < 2 * periodMicros) ? lastSendMicros + periodMicros : now;
+  }
+
+  for (uint8_t i = 0; i < Channels::getCount(); i++) {
+    sendChannel(i);
+  }
+}
+
+void UdpTelemetry::sendChannel(uint8_t channel) {
+  uint8_t destination[4];
+  uint16_t destinationPort;
+  {
+    Hal::MeasurementLock lock;
+    buildPacket(channel);
+    memcpy(destination, address, sizeof(destination));
+    destinationPort = port;
+  }
+
+  if (sendDatagram(destination, destinationPort, (const uint8_t*)&packet, sizeof(packet))) {
+    packetsSent++;
+  } else {
+    sendErrors++;
+  }
+}
+
+void UdpTelemetry::buildPacket(uint8_t channel) {
+  const Channel& source = Channels::get(channel);
+  Stream& stream = streams[channel];
+
+  // Pulse times go straight into the interval slots, then become intervals
+  unsigned long lostBefore = stream.lost;
+  uint8_t pulses = source.rpm.readPulses(stream.cursor, packet.intervalsUs, TelemetryPacket::MAX_SAMPLES, stream.lost);
+  if (stream.lost != lostBefore) stream.havePrevious = false; // No interval across a gap
+
+  uint8_t samples = 0;
+  for (uint8_t p = 0; p < pulses; p++) {
+    uint32_t pulseUs = packet.intervalsUs[p];
+    if (stream.havePrevious) {
+      packet.intervalsUs[samples++] = pulseUs - stream.previousPulseUs;
+    }
+    stream.previousPulseUs = pulseUs;
+    stream.havePrevious = true;
+  }
+  for (uint8_t p = samples; p < TelemetryPacket::MAX_SAMPLES; p++) {
+    packet.intervalsUs[p] = 0;
+  }
+
+  uint8_t state = 0;
+  if (source.motor.isRunning()) state |= TelemetryPacket::STATE_RUNNING;
+  if (source.motor.isAccelerationTestRunning()) state |= TelemetryPacket::STATE_TEST_ACTIVE;
+
+  packet.magic = TelemetryPacket::MAGIC;
+  packet.version = TelemetryPacket::VERSION;
+  packet.channel = channel;
+  packet.sequence = stream.sequence++;
+  packet.timestampUs = Hal::micros64();
+  packet.centiRpm = source.rpm.getCurrentCentiRpm();
+  packet.lastPulseUs = stream.previousPulseUs;
+  packet.lostSamples = (uint32_t)stream.lost;
+  packet.pwm = (uint16_t)source.motor.getCurrentPwm();
+  packet.state = state;
+  packet.testIndex = (uint8_t)source.motor.getCurrentTestIndex();
+  packet.sampleCount = samples;
+  memset(packet.reserved, 0, sizeof(packet.reserved));
+}
@@ -0,0 +1,92 @@
+#ifndef MOTOR_TESTER_UDP_TELEMETRY_H
+#define MOTOR_TESTER_UDP_TELEMETRY_H
+
+#include "Hal.h"
+#include "Channels.h"
+
+#include <stddef.h>
+
+// Fixed-layout telemetry datagram, little-endian, 128 bytes. One packet per
+// channel per send period carries every pulse-to-pulse interval accepted
+// since the previous packet (up to MAX_SAMPLES; the rest follow in the next
+// packets). Every field is naturally aligned, so there is no padding on
+// either the ESP8266 or the host (checked below) and no unaligned access.
+struct TelemetryPacket {
+  static const uint16_t MAGIC = 0x5254; // "TR" on the wire
+  static const uint8_t VERSION = 1;
+  static const uint8_t MAX_SAMPLES = 23;
+
+  enum State : uint8_t {
+    STATE_RUNNING = 0x01,     // Bridge driving the motor
+    STATE_TEST_ACTIVE = 0x02  // Acceleration test sequence in progress
+  };
+
+  uint16_t magic;
+  uint8_t version;
+  uint8_t channel;
+  uint32_t sequence;       // Per channel, +1 per packet - gaps are lost packets
+  uint64_t timestampUs;    // Hal::micros64() when the packet was built
+  uint32_t centiRpm;       // Current reading, RPM x 100
+  uint32_t lastPulseUs;    // micros() of the newest sample's pulse (rising edge)
+  uint32_t lostSamples;    // Pulses overwritten before they could be sent, since start
+  uint16_t pwm;            // Duty cycle on the enable pin
+  uint8_t state;           // State bits
+  uint8_t testIndex;       // Test 0-3 while STATE_TEST_ACTIVE
+  uint8_t sampleCount;
+  uint8_t reserved[3];
+  uint32_t intervalsUs[MAX_SAMPLES]; // Pulse-to-pulse intervals, oldest first
+};
+
+static_assert(sizeof(TelemetryPacket) == 128, "TelemetryPacket layout changed");
+static_assert(offsetof(TelemetryPacket, timestampUs) == 8 && offsetof(TelemetryPacket, intervalsUs) == 36,
+              "TelemetryPacket layout changed");
+
+// Optional high-rate telemetry for logging a spin-up on a PC: per-pulse
+// intervals that JSON polling can't keep up with. Off until start(); the
+// packet is built in a static buffer, so sending allocates nothing on our
+// side. The reference receiver is the native `receive` command.
+class UdpTelemetry {
+  public:
+    static const uint16_t DEFAULT_PORT = 4210;
+    static const uint16_t DEFAULT_RATE_HZ = 100;
+    static const uint16_t MIN_RATE_HZ = 20;   // Slowest rate that still carries 350 pulses/s
+    static const uint16_t MAX_RATE_HZ = 500;
+
+    static bool start(const uint8_t address[4], uint16_t port, uint16_t rateHz);
+    static void stop();
+    static void update(); // Scheduler task, sends when a period is due
+
+    static bool isEnabled() { return enabled; }
+    static const uint8_t* getAddress() { return address; }
+    static uint16_t getPort() { return port; }
+    static uint16_t getRateHz() { return rateHz; }
+    static unsigned long getPacketsSent() { return packetsSent; }
+    static unsigned long getSendErrors() { return sendErrors; }
+    static unsigned long getLostSamples();
+
+  private:
+    // Consumer state per channel
+    struct Stream {
+      unsigned long cursor;       // Position in RPMCounter's pulse history
+      unsigned long lost;
+      uint32_t sequence;
+      uint32_t previousPulseUs;
+      bool havePrevious;
+    };
+
+    static bool enabled;
+    static uint8_t address[4];
+    static uint16_t port;
+    static uint16_t rateHz;
+    static unsigned long periodMicros;
+    static unsigned long lastSendMicros;
+    static unsigned long packetsSent;
+    static unsigned long sendErrors;
+    static Stream streams[Channels::MAX_CHANNELS];
+    static TelemetryPacket packet;
+
+    static void sendChannel(uint8_t channel);
+    static void buildPacket(uint8_t channel);
+};
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef MOTOR_TESTER_VERSION_H
+#define MOTOR_TESTER_VERSION_H
+
+// Reported in /api/status and the mDNS TXT record. Release builds can set it
+// from the build, e.g. build_flags = -DFIRMWARE_VERSION=\"1.2.0\"
+#ifndef FIRMWARE_VERSION
+#define FIRMWARE_VERSION "1.0.0"
+#endif
+
+#endif
@@ -0,0 +1,251 @@
+#include "Vibration.h"
+#include "LatencyProbe.h"
+
+#include <math.h>
+
+// Static member definitions
+Vibration::Collector Vibration::collectors[Channels::MAX_CHANNELS];
+VibrationResult Vibration::results[Channels::MAX_CHANNELS];
+int32_t Vibration::real[Vibration::WINDOW];
+int32_t Vibration::imag[Vibration::WINDOW];
+int16_t Vibration::cosTable[Vibration::WINDOW / 2];
+int16_t Vibration::sinTable[Vibration::WINDOW / 2];
+int16_t Vibration::hannTable[Vibration::WINDOW];
+bool Vibration::tablesReady = false;
+
+namespace {
+  uint32_t isqrt64(uint64_t value) {
+    uint64_t root = 0;
+    uint64_t bit = 1ULL << 62;
+    while (bit > value) bit >>= 2;
+    while (bit != 0) {
+      if (value >= root + bit) {
+        value -= root + bit;
+        root = (root >> 1) + bit;
+      } else {
+        root >>= 1;
+      }
+      bit >>= 2;
+    }
+    return (uint32_t)root;
+  }
+
+  uint8_t log2Window() {
+    uint8_t bits = 0;
+    while ((1U << bits) < Vibration::WINDOW) bits++;
+    return bits;
+  }
+}
+
+void Vibration::begin() {
+  buildTables();
+  for (uint8_t i = 0; i < Channels::MAX_CHANNELS; i++) {
+    Collector& collector = collectors[i];
+    collector.cursor = i < Channels::getCount() ? Channels::get(i).rpm.getSignalCount() : 0;
+    collector.lost = 0;
+    collector.windows = 0;
+    collector.unsteady = 0;
+    collector.havePrevious = false;
+    collector.count = 0;
+    memset(&results[i], 0, sizeof(results[i]));
+  }
+}
+
+void Vibration::buildTables() {
+  if (tablesReady) return;
+  // Floating point once at startup; everything per window is integer
+  for (uint16_t k = 0; k < WINDOW / 2; k++) {
+    double angle = 2.0 * M_PI * k / WINDOW;
+    cosTable[k] = (int16_t)lround(cos(angle) * 32767.0);
+    sinTable[k] = (int16_t)lround(sin(angle) * 32767.0);
+  }
+  for (uint16_t n = 0; n < WINDOW; n++) {
+    hannTable[n] = (int16_t)lround(0.5 * (1.0 - cos(2.0 * M_PI * n / WINDOW)) * 32767.0);
+  }
+  tablesReady = true;
+}
+
+void Vibration::update() {
+  for (uint8_t i = 0; i < Channels::getCount(); i++) {
+    collect(i);
+  }
+}
+
+void Vibration::collect(uint8_t channel) {
+  Collector& collector = collectors[channel];
+  const RPMCounter& rpm = Channels::get(channel).rpm;
+
+  uint32_t times[RPMCounter::PULSE_HISTORY];
+  uint8_t count;
+  do {
+    unsigned long lost = 0;
+    count = rpm.readPulses(collector.cursor, times, RPMCounter::PULSE_HISTORY, lost);
+    if (lost > 0) {
+      // A window must be consecutive revolutions - start over
+      collector.lost += lost;
+      collector.havePrevious = false;
+      collector.count = 0;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+      if (collector.havePrevious) {
+        collector.intervalsUs[collector.count++] = times[i] - collector.previousPulseUs;
+        if (collector.count == WINDOW) {
+          if (analyse(collector.intervalsUs, results[channel])) {
+            results[channel].time = Hal::millis();
+            collector.windows++;
+          } else {
+            collector.unsteady++;
+          }
+          collector.count = 0;
+        }
+      }
+      collector.previousPulseUs = times[i];
+      collector.havePrevious = true;
+    }
+  } while (count == RPMCounter::PULSE_HISTORY);
+}
+
+bool Vibration::analyse(const uint32_t* intervalsUs, VibrationResult& result) {
+  buildTables();
+
+  // Steady speed only: no outliers (a missed or extra pulse) and little
+  // drift between the first and the last quarter of the window
+  uint64_t sum = 0;
+  uint64_t firstQuarter = 0;
+  uint64_t lastQuarter = 0;
+  for (uint16_t n = 0; n < WINDOW; n++) {
+    if (intervalsUs[n] > MAX_INTERVAL_US) return false;
+    sum += intervalsUs[n];
+    if (n < WINDOW / 4) firstQuarter += intervalsUs[n];
+    if (n >= WINDOW - WINDOW / 4) lastQuarter += intervalsUs[n];
+  }
+  uint64_t drift = lastQuarter > firstQuarter ? lastQuarter - firstQuarter : firstQuarter - lastQuarter;
+  if (drift * 4 * 100 > sum * MAX_DRIFT_PERCENT) return false;
+
+  int64_t meanNs = (int64_t)(sum * 1000 / WINDOW);
+  int64_t maxDeviationNs = meanNs * MAX_DEVIATION_PERCENT / 100;
+  uint64_t cycleSquares = 0; // us^2
+  uint32_t cycleMaxUs = 0;
+  for (uint16_t n = 0; n < WINDOW; n++) {
+    int64_t deviation = (int64_t)intervalsUs[n] * 1000 - meanNs;
+    if (deviation > maxDeviationNs || deviation < -maxDeviationNs) return false;
+    if (n > 0) {
+      uint32_t change = intervalsUs[n] > intervalsUs[n - 1] ? intervalsUs[n] - intervalsUs[n - 1]
+                                                          : intervalsUs[n - 1] - intervalsUs[n];
+      cycleSquares += (uint64_t)change * change;
+      if (change > cycleMaxUs) cycleMaxUs = change;
+    }
+  }
+
+  // Remove the linear trend (least squares, x = 2n - (N - 1) keeps it integer)
+  int64_t sumXY = 0;
+  for (uint16_t n = 0; n < WINDOW; n++) {
+    sumXY += (int64_t)(2 * n - (WINDOW - 1)) * ((int64_t)intervalsUs[n] * 1000 - meanNs);
+  }
+  const int64_t sumXX = (int64_t)WINDOW * ((int64_t)WINDOW * WINDOW - 1) / 3;
+
+  uint64_t squares = 0;
+  int64_t maxAbs = 0;
+  for (uint16_t n = 0; n < WINDOW; n++) {
+    int64_t x = 2 * n - (WINDOW - 1);
+    int64_t deviation = (int64_t)intervalsUs[n] * 1000 - meanNs - sumXY * x / sumXX;
+    real[n] = (int32_t)deviation; // |deviation| < 12% of 1 s fits
+    squares += (uint64_t)(deviation * deviation);
+    if (deviation > maxAbs) maxAbs = deviation;
+    if (-deviation > maxAbs) maxAbs = -deviation;
+  }
+
+  // Scale so the FFT's growth (up to N) can't overflow 32 bits but small
+  // deviations keep their resolution
+  const int64_t limit = 1LL << (30 - log2Window());
+  int8_t shift = 0;
+  while (maxAbs >= limit) {
+    maxAbs >>= 1;
+    shift--;
+  }
+  while (maxAbs > 0 && (maxAbs << 1) < limit && shift < 16) {
+    maxAbs <<= 1;
+    shift++;
+  }
+  for (uint16_t n = 0; n < WINDOW; n++) {
+    int64_t scaled = shift >= 0 ? (int64_t)real[n] << shift : (int64_t)real[n] >> -shift;
+    real[n] = (int32_t)((scaled * hannTable[n]) >> 15);
+    imag[n] = 0;
+  }
+
+  fft();
+
+  result.meanIntervalUs = (uint32_t)(sum / WINDOW);
+  result.centiRpm = RPMCounter::intervalToCentiRpm(result.meanIntervalUs);
+  result.jitterRmsNs = isqrt64(squares / WINDOW);
+  result.cycleJitterRmsNs = isqrt64(cycleSquares * 1000000 / (WINDOW - 1));
+  result.cycleJitterMaxNs = cycleMaxUs * 1000;
+
+  // Amplitude of a sinusoid in bin k: |X| = A * N / 4 with the Hann window
+  // (N / 2 for the one-sided spectrum, halved again by the window's gain);
+  // the Nyquist bin has no mirror image, so it's A * N / 2 there
+  for (VibrationResult::Peak& peak : result.peaks) peak = {0, 0};
+  for (uint16_t bin = 1; bin <= VibrationResult::BINS; bin++) {
+    int64_t re = real[bin];
+    int64_t im = imag[bin];
+    uint64_t magnitude = isqrt64((uint64_t)(re * re) + (uint64_t)(im * im));
+    uint64_t amplitude = magnitude * (bin == WINDOW / 2 ? 2 : 4);
+    amplitude = shift >= 0 ? amplitude >> shift : amplitude << -shift;
+    result.amplitudeNs[bin - 1] = (uint32_t)(amplitude / WINDOW);
+  }
+
+  // Strongest local maxima
+  for (uint16_t bin = 1; bin <= VibrationResult::BINS; bin++) {
+    uint32_t amplitude = result.amplitudeNs[bin - 1];
+    if (amplitude == 0) continue;
+    if (bin > 1 && result.amplitudeNs[bin - 2] >= amplitude) continue;
+    if (bin < VibrationResult::BINS && result.amplitudeNs[bin] > amplitude) continue;
+
+    for (uint8_t i = 0; i < VibrationResult::MAX_PEAKS; i++) {
+      if (amplitude > result.peaks[i].amplitudeNs) {
+        for (uint8_t j = VibrationResult::MAX_PEAKS - 1; j > i; j--) result.peaks[j] = result.peaks[j - 1];
+        result.peaks[i] = {bin, amplitude};
+        break;
+      }
+    }
+  }
+  return true;
+}
+
+void Vibration::fft() {
+  // Bit-reversal permutation
+  for (uint16_t i = 1, j = 0; i < WINDOW; i++) {
+    uint16_t bit = WINDOW >> 1;
+    for (; j & bit; bit >>= 1) j ^= bit;
+    j ^= bit;
+    if (i < j) {
+      int32_t swap = real[i];
+      real[i] = real[j];
+      real[j] = swap;
+      swap = imag[i];
+      imag[i] = imag[j];
+      imag[j] = swap;
+    }
+  }
+
+  // Radix-2 butterflies with Q15 twiddles, W = cos - j sin
+  for (uint16_t length = 2; length <= WINDOW; length <<= 1) {
+    uint16_t half = length >> 1;
+    uint16_t step = WINDOW / length;
+    for (uint16_t start = 0; start < WINDOW; start += length) {
+      for (uint16_t k = 0; k < half; k++) {
+        int64_t c = cosTable[k * step];
+        int64_t s = sinTable[k * step];
+        uint16_t a = start + k;
+        uint16_t b = a + half;
+        int32_t tr = (int32_t)((real[b] * c + imag[b] * s) >> 15);
+        int32_t ti = (int32_t)((imag[b] * c - real[b] * s) >> 15);
+        real[b] = real[a] - tr;
+        imag[b] = imag[a] - ti;
+        real[a] += tr;
+        imag[a] += ti;
+      }
+    }
+  }
+}
@@ -0,0 +1,93 @@
+#ifndef MOTOR_TESTER_VIBRATION_H
+#define MOTOR_TESTER_VIBRATION_H
+
+#include "Hal.h"
+#include "Channels.h"
+
+// Consecutive pulse intervals per analysis window, a power of two. Buffers
+// are static: about 6 bytes per interval and channel, plus 12 per interval
+// of shared FFT scratch and tables.
+#ifndef VIBRATION_WINDOW
+#define VIBRATION_WINDOW 128
+#endif
+
+// Result of one steady-speed window. Times are in nanoseconds: pulse times
+// are whole microseconds, but means and RMS values over a window resolve
+// much finer than that.
+struct VibrationResult {
+  static const uint16_t BINS = VIBRATION_WINDOW / 2; // Bins 1..N/2 of the spectrum
+  static const uint8_t MAX_PEAKS = 3;
+
+  struct Peak {
+    uint16_t bin;           // Order = bin / VIBRATION_WINDOW cycles per revolution
+    uint32_t amplitudeNs;   // Of the interval variation
+  };
+
+  unsigned long time;             // millis() when the window closed, 0 = no result yet
+  uint32_t meanIntervalUs;
+  uint32_t centiRpm;              // From the mean interval
+  uint32_t jitterRmsNs;           // Deviation from the (detrended) window mean
+  uint32_t cycleJitterRmsNs;      // Interval-to-interval change
+  uint32_t cycleJitterMaxNs;
+  uint32_t amplitudeNs[BINS];     // Spectrum, index 0 = bin 1
+  Peak peaks[MAX_PEAKS];          // Strongest local maxima, amplitude 0 = none
+};
+
+// Vibration and jitter analysis on the interval stream. Rotor imbalance,
+// bearing damage and cogging show up as periodic variation of the time
+// between pulses, which RPMCounter averages away. Each channel collects
+// windows of consecutive intervals through RPMCounter::readPulses(); a
+// window at steady speed (slow drift only, no outliers) is detrended,
+// Hann-windowed and run through a fixed-point radix-2 FFT.
+//
+// With one aperture the intervals are sampled once per revolution, so the
+// spectrum covers orders 0 to 0.5 (sub-synchronous components such as
+// whirl or bearing cage frequencies); faster components alias into it.
+class Vibration {
+  public:
+    static const uint16_t WINDOW = VIBRATION_WINDOW;
+    static const uint8_t MAX_DRIFT_PERCENT = 2;     // First vs last quarter of a window
+    static const uint8_t MAX_DEVIATION_PERCENT = 12; // Any interval vs the window mean
+    static const uint32_t MAX_INTERVAL_US = 1000000; // Below 60 RPM nothing is analysed
+
+    static void begin();
+    static void update(); // Scheduler task, collects intervals and analyses full windows
+
+    static const VibrationResult& getResult(uint8_t channel) { return results[channel]; }
+    static unsigned long getWindowCount(uint8_t channel) { return collectors[channel].windows; }
+    static unsigned long getUnsteadyCount(uint8_t channel) { return collectors[channel].unsteady; }
+    static unsigned long getLostPulses(uint8_t channel) { return collectors[channel].lost; }
+
+    // Analyse one window of intervals (also used directly by the benchmarks)
+    static bool analyse(const uint32_t* intervalsUs, VibrationResult& result);
+
+  private:
+    struct Collector {
+      unsigned long cursor;
+      unsigned long lost;
+      unsigned long windows;      // Analysed
+      unsigned long unsteady;     // Discarded: speed changing or outliers
+      uint32_t previousPulseUs;
+      bool havePrevious;
+      uint16_t count;
+      uint32_t intervalsUs[WINDOW];
+    };
+
+    static Collector collectors[Channels::MAX_CHANNELS];
+    static VibrationResult results[Channels::MAX_CHANNELS];
+    static int32_t real[WINDOW];
+    static int32_t imag[WINDOW];
+    static int16_t cosTable[WINDOW / 2]; // Q15 twiddles
+    static int16_t sinTable[WINDOW / 2];
+    static int16_t hannTable[WINDOW];    // Q15
+    static bool tablesReady;
+
+    static void buildTables();
+    static void collect(uint8_t channel);
+    static void fft();
+};
+
+static_assert((VIBRATION_WINDOW & (VIBRATION_WINDOW - 1)) == 0 && VIBRATION_WINDOW >= 16 && VIBRATION_WINDOW <= 1024,
+              "VIBRATION_WINDOW must be a power of two between 16 and 1024");
+
+#endif
@@ -4,8 +4,19 @@
 #elif defined(ESP8266)
 #include <ESP8266WiFi.h>
 #endif
-#include "RPMCounter.h"
-#include "MotorController.h"
+#include "Channels.h"
+#include "Scheduler.h"
+#include "LatencyProbe.h"
+#include "Logger.h"
+#include "NetworkService.h"
+#include "ConfigStore.h"
+#include "EdgeTrace.h"
+#include "ApiJson.h"
+#include "Benchmark.h"
+#include "UdpTelemetry.h"
+#include "Version.h"
+#include "OTAService.h"
+#include "Endurance.h"
 
 AsyncWebServer WebServer::server(80);
 bool WebServer::isStarted = false;
@@ -26,8 +37,16 @@ void WebServer::handle() {
 }
 
 void WebServer::setupRoutes() {
+  // Every /api handler starts with Hal::MeasurementLock: on the ESP32 this
+  // server runs on core 0 while the scheduler's tasks run on core 1, so a
+  // handler must not read or change a channel halfway through a task.
+  // The wait is bounded - a task that holds on (benchmark, archive save)
+  // gets the client a 503 to retry rather than a stalled async server.
+  // Nothing to wait for on the ESP8266.
+
   // Serve a minimal home page that loads content via AJAX
   server.on("/", HTTP_GET, [](AsyncWebServerRequest *request){
+    LATENCY_PROBE(PROBE_WEB_ROOT);
     const char* html = R"(<!DOCTYPE html>
 <html><head><title>ESP Motor Tester</title>
 <meta name='viewport' content='width=device-width, initial-scale=1'>
@@ -49,6 +68,7 @@ h1{color:#333;text-align:center}
 <h1>ESP Motor Tester</h1>
 <div class='status'>System Status: <span id='status'>Loading...</span></div>
 <div class='control'>
+<label>Channel <select id='ch' onchange='update()'><option value='0'>0</option></select></label>
 <label><input type='checkbox' id='live' onclick='toggleLive()'> Live Updates (2s)</label>
 <div>RPM: <span id='rpm' class='rpm'>--</span></div>
 </div>
@@ -79,20 +99,26 @@ let cb=document.getElementById('live');
 if(cb.checked){interval=setInterval(update,2000);update();}
 else{clearInterval(interval);interval=null;}
 }
+function ch(){return document.getElementById('ch').value;}
 function update(){
 fetch('/api/status').then(r=>r.json()).then(d=>{
+let sel=document.getElementById('ch');
+if(sel.options.length!=d.channels.length){
+sel.innerHTML=d.channels.map(c=>'<option value='+c.channel+'>'+c.channel+'</option>').join('');
+}
+let c=d.channels[ch()];
 document.getElementById('status').textContent='Online';
-document.getElementById('rpm').textContent=d.rpm.current+' RPM';
-document.getElementById('speed').textContent=d.motor.speed;
+document.getElementById('rpm').textContent=c.rpm+' RPM';
+document.getElementById('speed').textContent=c.speed;
 document.getElementById('device').innerHTML='Free Heap: '+d.freeHeap+'<br>IP: '+d.ip;
-document.getElementById('sensor').innerHTML='Pin: D4<br>RPM: '+d.rpm.current+'<br>Signals: '+d.rpm.signalCount;
-document.getElementById('motor').innerHTML='Speed: '+d.motor.speed+'%<br>Running: '+(d.motor.running?'Yes':'No')+'<br>PWM: 0-255';
+document.getElementById('sensor').innerHTML='Pin: GPIO'+c.sensorPin+'<br>RPM: '+c.rpm+'<br>Signals: '+c.signalCount;
+document.getElementById('motor').innerHTML='Speed: '+c.speed+'%<br>Running: '+(c.running?'Yes':'No')+'<br>PWM: 0-255';
 document.getElementById('network').innerHTML='SSID: '+d.ssid+'<br>Signal: '+d.rssi+' dBm';
-updateBtns(d.motor.speed);
+updateBtns(c.speed);
 }).catch(e=>{document.getElementById('status').textContent='Error';});}
 function setSpeed(s){
 let fd=new FormData();fd.append('speed',s);
-fetch('/api/motor/speed',{method:'POST',body:fd})
+fetch('/api/ch/'+ch()+'/motor/speed',{method:'POST',body:fd})
 .then(r=>r.json()).then(d=>{
 if(d.success){document.getElementById('speed').textContent=s;updateBtns(s);}
 }).catch(e=>console.log(e));}
@@ -105,7 +131,7 @@ if(idx>=0)btns[idx].classList.add('active');
 }
 function startAccelerationTest(){
 document.getElementById('testResult').innerHTML='<span style="color:orange">Running acceleration test...</span>';
-fetch('/api/motor/acceleration-test',{method:'POST'})
+fetch('/api/ch/'+ch()+'/motor/acceleration-test',{method:'POST'})
 .then(r=>r.json()).then(d=>{
 if(d.success){
 document.getElementById('testResult').innerHTML='<span style="color:green">Test started! Check serial output for results.</span>';
@@ -122,29 +148,271 @@ update();
     request->send(200, "text/html", html);
   });
   
-  // API endpoint for RPM data
-  server.on("/api/rpm", HTTP_GET, [](AsyncWebServerRequest *request){
+  // Per-channel endpoints under /api/ch/{n}/..., and the original
+  // single-motor endpoints, which address channel 0
+  setupChannelRoutes(0, "/api");
+  for (uint8_t channel = 0; channel < Channels::getCount(); channel++) {
+    setupChannelRoutes(channel, "/api/ch/" + String(channel));
+  }
+  
+  // Pins and live readings of every channel
+  server.on("/api/channels", HTTP_GET, [](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    String json = ApiJson::channels();
+    
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+  
+  // Combined API endpoint for all data
+  server.on("/api/status", HTTP_GET, [](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    LATENCY_PROBE(PROBE_WEB_STATUS);
+    // "rpm" and "motor" are channel 0, as before channels existed
+    const Channel& first = Channels::get(0);
     String json = "{";
-    json += "\"rpm\":" + String(RPMCounter::getCurrentRPM(), 1) + ",";
-    json += "\"signalCount\":" + String(RPMCounter::getSignalCount()) + ",";
-    json += "\"lastSignalTime\":" + String(RPMCounter::getLastSignalTime()) + ",";
-    json += "\"timeBetweenSignalsMicros\":" + String(RPMCounter::getTimeBetweenSignals()) + ",";
-    json += "\"timeBetweenSignalsMs\":" + String(RPMCounter::getTimeBetweenSignals() / 1000.0, 3) + ",";
+    json += "\"rpm\":{";
+    json += "\"current\":" + ApiJson::formatCentiRpm(first.rpm.getCurrentCentiRpm()) + ",";
+    json += "\"signalCount\":" + String(first.rpm.getSignalCount()) + ",";
+    json += "\"lastSignalTime\":" + String(first.rpm.getLastSignalTime()) + ",";
+    json += "\"timeBetweenSignalsMicros\":" + String(first.rpm.getTimeBetweenSignals()) + ",";
+    json += "\"timeBetweenSignalsMs\":" + ApiJson::formatMicrosAsMillis(first.rpm.getTimeBetweenSignals());
+    json += "},";
+    json += "\"motor\":{";
+    json += "\"speed\":" + String(first.motor.getCurrentSpeed()) + ",";
+    json += "\"running\":" + String(first.motor.isRunning() ? "true" : "false") + ",";
+    json += "\"lastUpdate\":" + String(first.motor.getLastUpdateTime());
+    json += "},";
+    json += "\"channels\":" + ApiJson::channelList() + ",";
+    json += "\"boot\":{";
+    json += "\"firstRpmMs\":" + String(first.rpm.getFirstReadingTime()) + ",";
+    json += "\"wifiConnectedMs\":" + String(NetworkService::getConnectedTime());
+    json += "},";
+    json += "\"network\":\"" + String(NetworkService::getStateName()) + "\",";
+    json += "\"hostname\":\"" + String(NetworkService::getHostname()) + "\",";
+    json += "\"firmware\":\"" FIRMWARE_VERSION "\",";
+    json += "\"state\":\"" + String(Channels::getStateName()) + "\",";
+    json += "\"resultId\":" + String(Channels::getLastResultId()) + ",";
+    json += "\"freeHeap\":" + String(ESP.getFreeHeap()) + ",";
+    json += "\"ip\":\"" + NetworkService::getIP() + "\",";
+    json += "\"ssid\":\"" + WiFi.SSID() + "\",";
+    json += "\"rssi\":" + String(WiFi.RSSI()) + ",";
     json += "\"timestamp\":" + String(millis());
     json += "}";
     
-    // Set CORS headers for API access
     AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
     response->addHeader("Access-Control-Allow-Origin", "*");
     request->send(response);
   });
   
-  // API endpoint for motor control - GET current status
-  server.on("/api/motor", HTTP_GET, [](AsyncWebServerRequest *request){
+  // Scheduler statistics: per-task run time, deadline misses and budget overruns
+  server.on("/api/scheduler", HTTP_GET, [](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    LATENCY_PROBE(PROBE_WEB_SCHEDULER);
+    String json = ApiJson::scheduler();
+    
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+  
+  // Reset scheduler statistics
+  server.on("/api/scheduler/reset", HTTP_POST, [](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    Scheduler::resetStats();
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", "{\"success\":true}");
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+  
+  // Latency probes: min/max/mean cycles and log2 histogram per probe
+  server.on("/api/latency", HTTP_GET, [](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    LATENCY_PROBE(PROBE_WEB_LATENCY);
+    String json = "{";
+    json += "\"enabled\":" + String(LATENCY_PROBES ? "true" : "false") + ",";
+    json += "\"cpuMHz\":" + String(ESP.getCpuFreqMHz()) + ",";
+    json += "\"measurementPathAtRisk\":" + String(LatencyProbe::isMeasurementPathAtRisk() ? "true" : "false") + ",";
+    json += "\"probes\":[";
+    for (uint8_t id = 0; id < PROBE_COUNT; id++) {
+      const LatencyProbe::Stats& stats = LatencyProbe::getStats(id);
+      uint32_t meanCycles = stats.count > 0 ? (uint32_t)(stats.totalCycles / stats.count) : 0;
+      if (id > 0) json += ",";
+      json += "{";
+      json += "\"name\":\"" + String(LatencyProbe::getName(id)) + "\",";
+      json += "\"count\":" + String(stats.count) + ",";
+      json += "\"minCycles\":" + String(stats.minCycles) + ",";
+      json += "\"maxCycles\":" + String(stats.maxCycles) + ",";
+      json += "\"meanCycles\":" + String(meanCycles) + ",";
+      json += "\"maxMicros\":" + String(LatencyProbe::cyclesToMicros(stats.maxCycles)) + ",";
+      json += "\"limitMicros\":" + String(LatencyProbe::getLimitMicros(id)) + ",";
+      json += "\"overLimit\":" + String(LatencyProbe::isOverLimit(id) ? "true" : "false") + ",";
+      json += "\"log2Histogram\":[";
+      for (uint8_t b = 0; b < LatencyProbe::HISTOGRAM_BUCKETS; b++) {
+        if (b > 0) json += ",";
+        json += String(stats.histogram[b]);
+      }
+      json += "]}";
+    }
+    json += "],";
+    json += "\"timestamp\":" + String(millis());
+    json += "}";
+    
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+  
+  // Reset latency statistics (e.g. right before a measurement run)
+  server.on("/api/latency/reset", HTTP_POST, [](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    LatencyProbe::reset();
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", "{\"success\":true}");
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+  
+  // Recent log records from the RAM ring buffer; ?since=<seq> returns only newer ones
+  server.on("/api/log", HTTP_GET, [](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    uint32_t sequence = Logger::getOldestSequence();
+    if (request->hasParam("since")) {
+      uint32_t since = (uint32_t)request->getParam("since")->value().toInt();
+      if (since > sequence) sequence = since;
+    }
+    
+    String json = "{\"records\":[";
+    char line[Logger::LINE_LENGTH];
+    LogRecord record;
+    bool first = true;
+    for (; sequence < Logger::getNextSequence(); sequence++) {
+      if (!Logger::getRecord(sequence, record)) continue;
+      Logger::format(record, line, sizeof(line));
+      
+      if (!first) json += ",";
+      first = false;
+      json += "{\"seq\":" + String(sequence) + ",";
+      json += "\"level\":\"" + String(Logger::levelChar(record.level)) + "\",";
+      json += "\"message\":\"";
+      for (const char* c = line; *c; c++) {
+        if (*c == '"' || *c == '\\') json += '\\';
+        json += *c;
+      }
+      json += "\"}";
+    }
+    json += "],";
+    json += "\"next\":" + String(Logger::getNextSequence()) + ",";
+    json += "\"dropped\":" + String(Logger::getDroppedCount()) + ",";
+    json += "\"timestamp\":" + String(millis());
+    json += "}";
+    
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+  
+  // Hot-path micro-benchmarks in CPU cycles (same suite as the native `bench` command).
+  // A run blocks the loop for seconds, so the start request only queues it for the
+  // `benchmark` scheduler task; poll GET /api/benchmark until state is "done".
+  server.on("/api/benchmark/start", HTTP_POST, [](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    const char* error = nullptr;
+    if (Channels::isAnyBusy()) {
+      error = "Stop all motors before running benchmarks";
+    } else {
+      uint16_t iterations = Benchmark::DEFAULT_ITERATIONS;
+      if (request->hasParam("iterations")) {
+        iterations = constrain(request->getParam("iterations")->value().toInt(), 1, 5000);
+      }
+      if (!Benchmark::request(iterations)) error = "A benchmark run is already pending";
+    }
+
+    String json = error ? "{\"success\":false,\"error\":\"" + String(error) + "\"}"
+                        : String("{\"success\":true,\"state\":\"pending\"}");
+    AsyncWebServerResponse *response = request->beginResponse(error ? 409 : 202, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
+  server.on("/api/benchmark", HTTP_GET, [](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", Benchmark::toJson());
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
+  // Edge trace capture for offline replay (see EdgeTrace.h for the file format).
+  // Started per channel (/api/ch/{n}/trace/start); one capture at a time.
+  server.on("/api/trace/stop", HTTP_POST, [](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    EdgeTrace::stop();
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", "{\"success\":true}");
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
+  server.on("/api/trace/status", HTTP_GET, [](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
     String json = "{";
-    json += "\"speed\":" + String(MotorController::getCurrentSpeed()) + ",";
-    json += "\"running\":" + String(MotorController::isRunning() ? "true" : "false") + ",";
-    json += "\"lastUpdate\":" + String(MotorController::getLastUpdateTime()) + ",";
+    json += "\"recording\":" + String(EdgeTrace::isRecording() ? "true" : "false") + ",";
+    json += "\"channel\":" + String(EdgeTrace::getChannel()) + ",";
+    json += "\"events\":" + String(EdgeTrace::getCount()) + ",";
+    json += "\"capacity\":" + String(EdgeTrace::CAPACITY) + ",";
+    json += "\"dropped\":" + String(EdgeTrace::getDroppedCount()) + ",";
+    json += "\"timestamp\":" + String(millis());
+    json += "}";
+
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
+  // Download the trace file. Stops the capture so the file is consistent.
+  // Streamed line by line - a full buffer is far too big for one String.
+  // A capture started meanwhile ends the download early rather than mixing
+  // two traces; replay then rejects the short file.
+  static_assert(EdgeTrace::LINE_LENGTH <= MAX_LINE_LENGTH, "trace lines must fit streamLines()");
+  server.on("/api/trace", HTTP_GET, [](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    EdgeTrace::stop();
+    uint32_t generation = EdgeTrace::getGeneration();
+    AsyncWebServerResponse *response = request->beginChunkedResponse("text/plain",
+      streamLines([generation](uint32_t line, char* text, size_t size) -> int {
+        if (EdgeTrace::getGeneration() != generation || line >= EdgeTrace::getLineCount()) return -1;
+        return (int)EdgeTrace::formatLine((uint16_t)line, text, size);
+      }));
+    response->addHeader("Content-Disposition", "attachment; filename=\"motor.trace\"");
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+
+  // OTA state, progress and throughput of the current or last update
+  server.on("/api/ota", HTTP_GET, [](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    unsigned long total = OTAService::getTotal();
+    String json = "{";
+    json += "\"state\":\"" + String(OTAService::getStateName()) + "\",";
+    json += "\"progress\":" + String(OTAService::getProgress()) + ",";
+    json += "\"total\":" + String(total) + ",";
+    json += "\"percent\":" + String(total > 0 ? (unsigned long)((uint64_t)OTAService::getProgress() * 100 / total) : 0UL) + ",";
+    json += "\"elapsedMs\":" + String(OTAService::getElapsedMs()) + ",";
+    json += "\"bytesPerSecond\":" + String(OTAService::getBytesPerSecond()) + ",";
+    json += "\"deferredCount\":" + String(OTAService::getDeferredCount()) + ",";
+    json += "\"error\":\"" + String(OTAService::getLastError()) + "\",";
     json += "\"timestamp\":" + String(millis());
     json += "}";
     
@@ -153,18 +421,258 @@ update();
     request->send(response);
   });
   
+  // Endurance / burn-in runs. Parameters: channel (default 0), speed (1-100),
+  // durationMinutes (0 = until stopped)
+  server.on("/api/endurance/start", HTTP_POST, [](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    if (Endurance::isActive()) {
+      sendEnduranceStatus(request, 409, "An endurance run is already active");
+      return;
+    }
+    uint8_t channel = 0;
+    uint8_t speed = 0;
+    uint32_t durationMinutes = 0;
+    readConfigParam(request, "channel", channel);
+    readConfigParam(request, "speed", speed);
+    readConfigParam(request, "durationMinutes", durationMinutes);
+    
+    const char* error = nullptr;
+    if (!Endurance::start(channel, speed, durationMinutes, &error)) {
+      sendEnduranceStatus(request, 400, error);
+      return;
+    }
+    sendEnduranceStatus(request, 200, nullptr);
+  });
+  
+  server.on("/api/endurance/stop", HTTP_POST, [](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    Endurance::stop();
+    sendEnduranceStatus(request, 200, nullptr);
+  });
+  
+  // Graph data: the newest `count` buckets (default all) of archive `level`
+  // (0 = 1 s, 1 = 1 min, 2 = 10 min), streamed from RAM
+  server.on("/api/endurance/archive", HTTP_GET, [](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    uint8_t level = 0;
+    uint16_t count = 0;
+    readConfigParam(request, "level", level);
+    readConfigParam(request, "count", count);
+    if (level >= Endurance::LEVELS) {
+      sendEnduranceStatus(request, 400, "level must be 0-2");
+      return;
+    }
+    
+    // Buckets are read under the lock chunk by chunk (streamLines), so the
+    // endurance task can't write one halfway through its line
+    static_assert(Endurance::LINE_LENGTH <= MAX_LINE_LENGTH, "archive lines must fit streamLines()");
+    Endurance::ArchiveView archive = Endurance::view(level, count);
+    AsyncWebServerResponse *response = request->beginChunkedResponse("application/json",
+      streamLines([archive](uint32_t line, char* text, size_t size) -> int {
+        if (line >= Endurance::getLineCount(archive)) return -1;
+        return (int)Endurance::formatLine(archive, line, text, size);
+      }));
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+  
+  server.on("/api/endurance", HTTP_GET, [](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    sendEnduranceStatus(request, 200, nullptr);
+  });
+  
+  // High-rate UDP telemetry to a PC (see UdpTelemetry.h for the packet layout).
+  // Parameters: host (default: whoever sent this request), port, rateHz.
+  server.on("/api/telemetry/start", HTTP_POST, [](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    IPAddress host = request->client()->remoteIP();
+    const AsyncWebParameter* hostParam = nullptr;
+    if (request->hasParam("host", true)) {
+      hostParam = request->getParam("host", true);
+    } else if (request->hasParam("host")) {
+      hostParam = request->getParam("host");
+    }
+    if (hostParam && !host.fromString(hostParam->value().c_str())) {
+      sendTelemetryStatus(request, 400, "host must be an IPv4 address");
+      return;
+    }
+    
+    uint16_t port = UdpTelemetry::DEFAULT_PORT;
+    uint16_t rateHz = UdpTelemetry::DEFAULT_RATE_HZ;
+    readConfigParam(request, "port", port);
+    readConfigParam(request, "rateHz", rateHz);
+    
+    const uint8_t address[4] = {host[0], host[1], host[2], host[3]};
+    if (!UdpTelemetry::start(address, port, rateHz)) {
+      sendTelemetryStatus(request, 400, "rateHz must be 20-500 and port non-zero");
+      return;
+    }
+    sendTelemetryStatus(request, 200, nullptr);
+  });
+  
+  server.on("/api/telemetry/stop", HTTP_POST, [](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    UdpTelemetry::stop();
+    sendTelemetryStatus(request, 200, nullptr);
+  });
+  
+  server.on("/api/telemetry", HTTP_GET, [](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    sendTelemetryStatus(request, 200, nullptr);
+  });
+  
+  // Supply voltage on A0: latest reading and the recent sample history
+  server.on("/api/supply", HTTP_GET, [](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    String json = ApiJson::supply();
+    
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+  
+  // Runtime configuration - GET current values
+  server.on("/api/config", HTTP_GET, [](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    sendConfig(request, 200, nullptr);
+  });
+  
+  // Runtime configuration - PUT (or POST) any subset of fields as form parameters.
+  // Changes are validated, applied live and persisted to EEPROM.
+  server.on("/api/config", HTTP_PUT | HTTP_POST, [](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    if (Channels::isAnyTestRunning()) {
+      sendConfig(request, 409, "Configuration can't be changed while a test is running");
+      return;
+    }
+    
+    TesterConfig config = ConfigStore::get();
+    readConfigParam(request, "debounceUs", config.debounceUs);
+    readConfigParam(request, "minSignalLengthUs", config.minSignalLengthUs);
+    readConfigParam(request, "maxSignalLengthUs", config.maxSignalLengthUs);
+    readConfigParam(request, "minReasonableRpm", config.minReasonableRpm);
+    readConfigParam(request, "maxReasonableRpm", config.maxReasonableRpm);
+    readConfigParam(request, "rpmTarget0", config.rpmTargets[0]);
+    readConfigParam(request, "rpmTarget1", config.rpmTargets[1]);
+    readConfigParam(request, "rpmTarget2", config.rpmTargets[2]);
+    readConfigParam(request, "rpmTarget3", config.rpmTargets[3]);
+    readConfigParam(request, "pauseMs", config.pauseMs);
+    readConfigParam(request, "timeoutMs", config.timeoutMs);
+    readConfigParam(request, "minPwm", config.minPwm);
+    readConfigParam(request, "maxPwm", config.maxPwm);
+    readConfigParam(request, "pwmFrequencyHz", config.pwmFrequencyHz);
+    readConfigParam(request, "estimatorNoiseRpm", config.estimatorNoiseRpm);
+    readConfigParam(request, "estimatorJerkRpmPerS2", config.estimatorJerkRpmPerS2);
+    readConfigParam(request, "rotorInertiaGcm2", config.rotorInertiaGcm2);
+    readConfigParam(request, "earlyAbortMarginPercent", config.earlyAbortMarginPercent);
+    readConfigParam(request, "supplyFullScaleMv", config.supplyFullScaleMv);
+    readConfigParam(request, "nominalSupplyMv", config.nominalSupplyMv);
+    readConfigParam(request, "stallSupplyMv", config.stallSupplyMv);
+    
+    const char* error = nullptr;
+    if (!ConfigStore::apply(config, &error)) {
+      sendConfig(request, 400, error);
+      return;
+    }
+    
+    for (uint8_t channel = 0; channel < Channels::getCount(); channel++) {
+      Channels::get(channel).motor.applyConfig();
+    }
+    sendConfig(request, 200, nullptr);
+  });
+  
+  // Handle not found
+  server.onNotFound([](AsyncWebServerRequest *request){
+    handleNotFound(request);
+  });
+}
+
+void WebServer::setupChannelRoutes(uint8_t channel, const String& prefix) {
+  // API endpoint for RPM data
+  server.on((prefix + "/rpm").c_str(), HTTP_GET, [channel](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    LATENCY_PROBE(PROBE_WEB_RPM);
+    String json = ApiJson::rpm(channel);
+    
+    // Set CORS headers for API access
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+  
+  // Time to reach an RPM from a spin-up model: `rpm`, optional `test`
+  // (0-3, default the most recent). Registered before the shorter /motor.
+  server.on((prefix + "/motor/predict").c_str(), HTTP_GET, [channel](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    int test = Channels::get(channel).motor.getLatestSpinUpIndex();
+    uint32_t rpm = 0;
+    if (request->hasParam("test")) {
+      test = request->getParam("test")->value().toInt();
+    }
+    readConfigParam(request, "rpm", rpm);
+    
+    String json;
+    int code = 200;
+    if (rpm == 0 || test < 0 || test > 3) {
+      json = "{\"success\":false,\"error\":\"rpm (> 0) and test (0-3) required, or no spin-up model yet\"}";
+      code = 400;
+    } else {
+      json = ApiJson::prediction(channel, test, rpm);
+    }
+    
+    AsyncWebServerResponse *response = request->beginResponse(code, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+  
+  // API endpoint for motor control - GET current status
+  server.on((prefix + "/motor").c_str(), HTTP_GET, [channel](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    LATENCY_PROBE(PROBE_WEB_MOTOR);
+    String json = ApiJson::motor(channel);
+    
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+  
   // API endpoint for motor control - POST to set speed
-  server.on("/api/motor/speed", HTTP_POST, [](AsyncWebServerRequest *request){
+  server.on((prefix + "/motor/speed").c_str(), HTTP_POST, [channel](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    LATENCY_PROBE(PROBE_WEB_SPEED);
     String response = "{\"error\":\"No speed parameter provided\"}";
     int responseCode = 400;
     
-    if (request->hasParam("speed", true)) {
+    // Nothing supervises the motor while the flash is being written
+    if (OTAService::isUpdating()) {
+      response = "{\"success\":false,\"error\":\"Firmware update in progress\"}";
+      responseCode = 409;
+    } else if (Endurance::isActive() && Endurance::getChannel() == channel) {
+      // The run's archives assume its fixed speed - stop it first
+      response = "{\"success\":false,\"error\":\"Endurance run active on this channel\"}";
+      responseCode = 409;
+    } else if (request->hasParam("speed", true)) {
       int speed = request->getParam("speed", true)->value().toInt();
       speed = constrain(speed, 0, 100);
-      MotorController::setSpeed(speed);
+      Channels::get(channel).motor.setSpeed(speed);
       
       response = "{";
       response += "\"success\":true,";
+      response += "\"channel\":" + String(channel) + ",";
       response += "\"speed\":" + String(speed) + ",";
       response += "\"timestamp\":" + String(millis());
       response += "}";
@@ -176,62 +684,262 @@ update();
     request->send(resp);
   });
   
-  // Combined API endpoint for all data
-  server.on("/api/status", HTTP_GET, [](AsyncWebServerRequest *request){
-    String json = "{";
-    json += "\"rpm\":{";
-    json += "\"current\":" + String(RPMCounter::getCurrentRPM(), 1) + ",";
-    json += "\"signalCount\":" + String(RPMCounter::getSignalCount()) + ",";
-    json += "\"lastSignalTime\":" + String(RPMCounter::getLastSignalTime()) + ",";
-    json += "\"timeBetweenSignalsMicros\":" + String(RPMCounter::getTimeBetweenSignals()) + ",";
-    json += "\"timeBetweenSignalsMs\":" + String(RPMCounter::getTimeBetweenSignals() / 1000.0, 3);
-    json += "},";
-    json += "\"motor\":{";
-    json += "\"speed\":" + String(MotorController::getCurrentSpeed()) + ",";
-    json += "\"running\":" + String(MotorController::isRunning() ? "true" : "false") + ",";
-    json += "\"lastUpdate\":" + String(MotorController::getLastUpdateTime());
-    json += "},";
-    json += "\"freeHeap\":" + String(ESP.getFreeHeap()) + ",";
-    json += "\"ip\":\"" + WiFi.localIP().toString() + "\",";
-    json += "\"ssid\":\"" + WiFi.SSID() + "\",";
-    json += "\"rssi\":" + String(WiFi.RSSI()) + ",";
-    json += "\"timestamp\":" + String(millis());
-    json += "}";
-    
-    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
-    response->addHeader("Access-Control-Allow-Origin", "*");
-    request->send(response);
-  });
-  
   // Acceleration test endpoint
-  server.on("/api/motor/acceleration-test", HTTP_POST, [](AsyncWebServerRequest *request){
+  server.on((prefix + "/motor/acceleration-test").c_str(), HTTP_POST, [channel](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    LATENCY_PROBE(PROBE_WEB_ACCEL_TEST);
+    MotorController& motor = Channels::get(channel).motor;
     String response = "{";
+    int responseCode = 200;
     
-    // Check if test is already running
-    if (MotorController::isAccelerationTestRunning()) {
+    if (OTAService::isUpdating()) {
+      response += "\"success\":false,";
+      response += "\"error\":\"Firmware update in progress\",";
+      response += "\"timestamp\":" + String(millis());
+      response += "}";
+      responseCode = 409;
+    } else if (Endurance::isActive() && Endurance::getChannel() == channel) {
+      response += "\"success\":false,";
+      response += "\"error\":\"Endurance run active on this channel\",";
+      response += "\"timestamp\":" + String(millis());
+      response += "}";
+      responseCode = 409;
+    } else if (motor.isAccelerationTestRunning()) {
+      // Test already running
       response += "\"success\":false,";
       response += "\"error\":\"Test already running\",";
       response += "\"timestamp\":" + String(millis());
       response += "}";
     } else {
       // Start the acceleration test
-      MotorController::startAccelerationTest();
+      motor.startAccelerationTest();
       
       response += "\"success\":true,";
+      response += "\"channel\":" + String(channel) + ",";
       response += "\"message\":\"Acceleration test started\",";
       response += "\"timestamp\":" + String(millis());
       response += "}";
     }
     
-    AsyncWebServerResponse *resp = request->beginResponse(200, "application/json", response);
+    AsyncWebServerResponse *resp = request->beginResponse(responseCode, "application/json", response);
     resp->addHeader("Access-Control-Allow-Origin", "*");
     request->send(resp);
   });
   
-  // Handle not found
-  server.onNotFound([](AsyncWebServerRequest *request){
-    handleNotFound(request);
+  // Jitter and interval spectrum of the last steady-speed window
+  server.on((prefix + "/vibration").c_str(), HTTP_GET, [channel](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    String json = ApiJson::vibration(channel);
+    
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
   });
+  
+  // Pulse width / interval histograms and reject counters, for aligning the
+  // sensor before a run
+  server.on((prefix + "/sensor/diagnostics/reset").c_str(), HTTP_POST, [channel](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    Channels::get(channel).rpm.clearDiagnostics();
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", "{\"success\":true}");
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+  
+  server.on((prefix + "/sensor/diagnostics").c_str(), HTTP_GET, [channel](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    String json = ApiJson::sensorDiagnostics(channel);
+    
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+  
+  // Start an edge trace of this channel (replaces any capture in progress)
+  server.on((prefix + "/trace/start").c_str(), HTTP_POST, [channel](AsyncWebServerRequest *request){
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) { sendBusy(request); return; }
+    EdgeTrace::start(channel, Channels::get(channel).motor.getCurrentPwm());
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", "{\"success\":true}");
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+  });
+}
+
+template <typename T>
+void WebServer::readConfigParam(AsyncWebServerRequest *request, const char* name, T& value) {
+  // Accept form body parameters as well as query string parameters
+  const AsyncWebParameter* param = nullptr;
+  if (request->hasParam(name, true)) {
+    param = request->getParam(name, true);
+  } else if (request->hasParam(name)) {
+    param = request->getParam(name);
+  }
+  
+  if (param) {
+    // Clamp into the field's range so out-of-range input fails validation
+    // instead of silently wrapping around
+    long parsed = param->value().toInt();
+    T maxValue = (T)~(T)0;
+    if (parsed < 0) {
+      value = 0;
+    } else if ((unsigned long)parsed > maxValue) {
+      value = maxValue;
+    } else {
+      value = (T)parsed;
+    }
+  }
+}
+
+void WebServer::sendConfig(AsyncWebServerRequest *request, int code, const char* error) {
+  const TesterConfig& config = ConfigStore::get();
+  
+  String json = "{";
+  if (error) {
+    json += "\"success\":false,";
+    json += "\"error\":\"" + String(error) + "\",";
+  } else {
+    json += "\"success\":true,";
+  }
+  json += "\"version\":" + String(ConfigStore::VERSION) + ",";
+  json += "\"source\":\"" + String(ConfigStore::isLoadedFromStorage() ? "eeprom" : "defaults") + "\",";
+  json += "\"debounceUs\":" + String(config.debounceUs) + ",";
+  json += "\"minSignalLengthUs\":" + String(config.minSignalLengthUs) + ",";
+  json += "\"maxSignalLengthUs\":" + String(config.maxSignalLengthUs) + ",";
+  json += "\"minReasonableRpm\":" + String(config.minReasonableRpm) + ",";
+  json += "\"maxReasonableRpm\":" + String(config.maxReasonableRpm) + ",";
+  json += "\"rpmTargets\":[";
+  for (int i = 0; i < 4; i++) {
+    if (i > 0) json += ",";
+    json += String(config.rpmTargets[i]);
+  }
+  json += "],";
+  json += "\"pauseMs\":" + String(config.pauseMs) + ",";
+  json += "\"timeoutMs\":" + String(config.timeoutMs) + ",";
+  json += "\"minPwm\":" + String(config.minPwm) + ",";
+  json += "\"maxPwm\":" + String(config.maxPwm) + ",";
+  json += "\"pwmFrequencyHz\":" + String(config.pwmFrequencyHz) + ",";
+  json += "\"estimatorNoiseRpm\":" + String(config.estimatorNoiseRpm) + ",";
+  json += "\"estimatorJerkRpmPerS2\":" + String(config.estimatorJerkRpmPerS2) + ",";
+  json += "\"rotorInertiaGcm2\":" + String(config.rotorInertiaGcm2) + ",";
+  json += "\"earlyAbortMarginPercent\":" + String(config.earlyAbortMarginPercent) + ",";
+  json += "\"supplyFullScaleMv\":" + String(config.supplyFullScaleMv) + ",";
+  json += "\"nominalSupplyMv\":" + String(config.nominalSupplyMv) + ",";
+  json += "\"stallSupplyMv\":" + String(config.stallSupplyMv);
+  json += "}";
+  
+  AsyncWebServerResponse *response = request->beginResponse(code, "application/json", json);
+  response->addHeader("Access-Control-Allow-Origin", "*");
+  request->send(response);
+}
+
+void WebServer::sendTelemetryStatus(AsyncWebServerRequest *request, int code, const char* error) {
+  const uint8_t* address = UdpTelemetry::getAddress();
+  
+  String json = "{";
+  if (error) {
+    json += "\"success\":false,";
+    json += "\"error\":\"" + String(error) + "\",";
+  } else {
+    json += "\"success\":true,";
+  }
+  json += "\"enabled\":" + String(UdpTelemetry::isEnabled() ? "true" : "false") + ",";
+  json += "\"host\":\"" + IPAddress(address[0], address[1], address[2], address[3]).toString() + "\",";
+  json += "\"port\":" + String(UdpTelemetry::getPort()) + ",";
+  json += "\"rateHz\":" + String(UdpTelemetry::getRateHz()) + ",";
+  json += "\"packetBytes\":" + String((unsigned)sizeof(TelemetryPacket)) + ",";
+  json += "\"packetsSent\":" + String(UdpTelemetry::getPacketsSent()) + ",";
+  json += "\"sendErrors\":" + String(UdpTelemetry::getSendErrors()) + ",";
+  json += "\"lostSamples\":" + String(UdpTelemetry::getLostSamples()) + ",";
+  json += "\"timestamp\":" + String(millis());
+  json += "}";
+  
+  AsyncWebServerResponse *response = request->beginResponse(code, "application/json", json);
+  response->addHeader("Access-Control-Allow-Origin", "*");
+  request->send(response);
+}
+
+void WebServer::sendEnduranceStatus(AsyncWebServerRequest *request, int code, const char* error) {
+  String json = "{";
+  if (error) {
+    json += "\"success\":false,";
+    json += "\"error\":\"" + String(error) + "\",";
+  } else {
+    json += "\"success\":true,";
+  }
+  json += "\"active\":" + String(Endurance::isActive() ? "true" : "false") + ",";
+  json += "\"restored\":" + String(Endurance::isRestored() ? "true" : "false") + ",";
+  json += "\"channel\":" + String(Endurance::getChannel()) + ",";
+  json += "\"speed\":" + String(Endurance::getSpeed()) + ",";
+  json += "\"durationMinutes\":" + String(Endurance::getDurationMinutes()) + ",";
+  json += "\"runSeconds\":" + String(Endurance::getRunSeconds()) + ",";
+  json += "\"lostPulses\":" + String(Endurance::getLostPulses()) + ",";
+  json += "\"saves\":" + String(Endurance::getSaveCount()) + ",";
+  json += "\"saveErrors\":" + String(Endurance::getSaveErrors()) + ",";
+  json += "\"archives\":[";
+  for (uint8_t level = 0; level < Endurance::LEVELS; level++) {
+    if (level > 0) json += ",";
+    json += "{\"level\":" + String(level);
+    json += ",\"bucketSeconds\":" + String(Endurance::getBucketSeconds(level));
+    json += ",\"capacity\":" + String(Endurance::getCapacity(level));
+    json += ",\"filled\":" + String(Endurance::getFilled(level)) + "}";
+  }
+  json += "],";
+  json += "\"timestamp\":" + String(millis());
+  json += "}";
+  
+  AsyncWebServerResponse *response = request->beginResponse(code, "application/json", json);
+  response->addHeader("Access-Control-Allow-Origin", "*");
+  request->send(response);
+}
+
+AwsResponseFiller WebServer::streamLines(LineFormatter formatLine) {
+  // The cursor and the line being sent live in this response's copy of the
+  // lambda, so parallel downloads don't step on each other and a line split
+  // across chunks is formatted once
+  struct Cursor {
+    uint32_t line = 0;
+    size_t offset = 0;
+    size_t length = 0;
+    char text[MAX_LINE_LENGTH + 1];
+  };
+  return [formatLine, cursor = Cursor()](uint8_t *buffer, size_t maxLen, size_t) mutable -> size_t {
+    // Runs in the TCP task after the handler returned - the data it reads
+    // is only stable under the lock (ESP32)
+    Hal::MeasurementLock lock(LOCK_TIMEOUT_MS);
+    if (!lock.isHeld()) return RESPONSE_TRY_AGAIN;
+
+    size_t written = 0;
+    while (written < maxLen) {
+      if (cursor.offset == cursor.length) {
+        int length = formatLine(cursor.line, cursor.text, sizeof(cursor.text) - 1);
+        if (length < 0) break;
+        cursor.text[length] = '\n';
+        cursor.length = length + 1;
+        cursor.offset = 0;
+        cursor.line++;
+      }
+
+      // Lines may be split across chunks
+      size_t chunk = cursor.length - cursor.offset;
+      if (chunk > maxLen - written) chunk = maxLen - written;
+      memcpy(buffer + written, cursor.text + cursor.offset, chunk);
+      written += chunk;
+      cursor.offset += chunk;
+    }
+    return written;
+  };
+}
+
+void WebServer::sendBusy(AsyncWebServerRequest *request) {
+  AsyncWebServerResponse *response = request->beginResponse(503, "application/json", "{\"success\":false,\"error\":\"Busy, retry\"}");
+  response->addHeader("Access-Control-Allow-Origin", "*");
+  response->addHeader("Retry-After", "1");
+  request->send(response);
 }
 
 void WebServer::handleNotFound(AsyncWebServerRequest *request) {
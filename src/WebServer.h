@@ -17,8 +17,25 @@ class WebServer {
     static AsyncWebServer server;
     static bool isStarted;
     
+    // How long a handler waits for Hal::MeasurementLock before answering 503
+    static const uint32_t LOCK_TIMEOUT_MS = 250;
+    
+    // Formats line `line` of a streamed file (without the newline) into
+    // `text`; returns its length, or -1 past the last line
+    typedef std::function<int(uint32_t line, char* text, size_t size)> LineFormatter;
+    static const size_t MAX_LINE_LENGTH = 120;
+    
     static void setupRoutes();
+    static void setupChannelRoutes(uint8_t channel, const String& prefix);
     static void handleNotFound(AsyncWebServerRequest *request);
+    static void sendBusy(AsyncWebServerRequest *request);
+    static AwsResponseFiller streamLines(LineFormatter formatLine);
+    
+    template <typename T>
+    static void readConfigParam(AsyncWebServerRequest *request, const char* name, T& value);
+    static void sendConfig(AsyncWebServerRequest *request, int code, const char* error);
+    static void sendTelemetryStatus(AsyncWebServerRequest *request, int code, const char* error);
+    static void sendEnduranceStatus(AsyncWebServerRequest *request, int code, const char* error);
 };
 
 #endif
\ No newline at end of file
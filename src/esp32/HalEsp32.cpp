@@ -0,0 +1,48 @@
+// ESP32-only state behind Hal.h
+
+#ifdef ESP32
+
+#include "../Hal.h"
+
+namespace {
+  // Wake this early and spin the rest: the esp_timer task and the switch
+  // back to the measurement task take a few tens of microseconds
+  const unsigned long WAKE_MARGIN_US = 50;
+  esp_timer_handle_t wakeTimer = nullptr;
+  TaskHandle_t sleepingTask = nullptr;
+
+  void wake(void*) {
+    xTaskNotifyGive(sleepingTask);
+  }
+}
+
+namespace Hal {
+  portMUX_TYPE criticalSection = portMUX_INITIALIZER_UNLOCKED;
+  // FreeRTOS can create objects before the scheduler starts, so this is
+  // ready before setup()
+  SemaphoreHandle_t measurementMutex = xSemaphoreCreateRecursiveMutex();
+
+  void sleepMicros(unsigned long us) {
+    // The scheduler's waits are mostly shorter than a 1 ms tick, so
+    // vTaskDelay() alone would never run - a one-shot esp_timer wakes us
+    unsigned long start = ::micros();
+    if (!wakeTimer) {
+      esp_timer_create_args_t args = {};
+      args.callback = wake;
+      args.name = "sleep";
+      if (esp_timer_create(&args, &wakeTimer) != ESP_OK) wakeTimer = nullptr;
+    }
+    if (wakeTimer && us > WAKE_MARGIN_US) {
+      sleepingTask = xTaskGetCurrentTaskHandle();
+      ulTaskNotifyTake(pdTRUE, 0); // Drop a wake-up left over from a timeout
+      esp_timer_start_once(wakeTimer, us - WAKE_MARGIN_US);
+      // The tick timeout is only a backstop should the timer not fire
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(us / 1000) + 2);
+      esp_timer_stop(wakeTimer);
+    }
+    long remaining = (long)us - (long)(::micros() - start);
+    if (remaining > 0) ::delayMicroseconds(remaining);
+  }
+}
+
+#endif
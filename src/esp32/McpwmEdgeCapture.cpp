@@ -0,0 +1,70 @@
+#ifdef ESP32
+
+#include "McpwmEdgeCapture.h"
+#include "../RPMCounter.h"
+#include <driver/gpio.h>
+#include <soc/soc.h>
+
+McpwmEdgeCapture::Input McpwmEdgeCapture::inputs[McpwmEdgeCapture::MAX_INPUTS];
+
+static const uint32_t TICKS_PER_US = APB_CLK_FREQ / 1000000;
+
+static const mcpwm_io_signals_t CAPTURE_SIGNALS[McpwmEdgeCapture::MAX_INPUTS] = {
+  MCPWM_CAP_0, MCPWM_CAP_1, MCPWM_CAP_2,
+};
+
+bool McpwmEdgeCapture::attach(uint8_t channel, uint8_t pin, RPMCounter* counter) {
+  if (channel >= MAX_INPUTS) return false;
+  Input& input = inputs[channel];
+  memset(&input, 0, sizeof(input));
+  input.counter = counter;
+
+  if (mcpwm_gpio_init(MCPWM_UNIT_0, CAPTURE_SIGNALS[channel], pin) != ESP_OK) return false;
+  gpio_pullup_en((gpio_num_t)pin);
+
+  // The ISR is allocated on the calling core - Channels::begin() runs in
+  // setup(), on the measurement core
+  mcpwm_capture_config_t config = {};
+  config.cap_edge = MCPWM_BOTH_EDGE;
+  config.cap_prescale = 1;
+  config.capture_cb = onCapture;
+  config.user_data = &input;
+  return mcpwm_capture_enable_channel(MCPWM_UNIT_0, (mcpwm_capture_channel_id_t)channel, &config) == ESP_OK;
+}
+
+void McpwmEdgeCapture::detach(uint8_t channel, uint8_t) {
+  if (channel >= MAX_INPUTS) return;
+  mcpwm_capture_disable_channel(MCPWM_UNIT_0, (mcpwm_capture_channel_id_t)channel);
+  inputs[channel].counter = nullptr;
+}
+
+bool IRAM_ATTR McpwmEdgeCapture::onCapture(mcpwm_unit_t, mcpwm_capture_channel_id_t,
+                                           const cap_event_data_t* event, void* context) {
+  Input& input = *static_cast<Input*>(context);
+  if (!input.counter) return false;
+
+  uint32_t ticks = event->cap_value;
+  uint32_t now = Hal::micros();
+  if (!input.anchored || now - input.lastUs > RESYNC_US) {
+    // First edge, or the capture timer may have wrapped since the last one
+    input.anchorTicks = ticks;
+    input.anchorUs = now;
+    input.anchored = true;
+  } else if (ticks - input.anchorTicks >= 0x40000000) {
+    // Move the anchor forward before the difference gets ambiguous
+    uint32_t elapsedUs = (ticks - input.anchorTicks) / TICKS_PER_US;
+    input.anchorTicks += elapsedUs * TICKS_PER_US;
+    input.anchorUs += elapsedUs;
+  }
+  uint32_t timeUs = input.anchorUs + (ticks - input.anchorTicks) / TICKS_PER_US;
+  input.lastUs = timeUs;
+
+  // Hal::disableInterrupts() on the other core (config changes from the web
+  // server) must keep the edge out
+  portENTER_CRITICAL_ISR(&Hal::criticalSection);
+  input.counter->handleCapturedEdge(timeUs, event->cap_edge == MCPWM_POS_EDGE);
+  portEXIT_CRITICAL_ISR(&Hal::criticalSection);
+  return false; // No task woken
+}
+
+#endif
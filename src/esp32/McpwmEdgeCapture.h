@@ -0,0 +1,49 @@
+#ifndef MOTOR_TESTER_MCPWM_EDGE_CAPTURE_H
+#define MOTOR_TESTER_MCPWM_EDGE_CAPTURE_H
+
+#ifdef ESP32
+
+#include "../EdgeCapture.h"
+#include <driver/mcpwm.h>
+
+// Sensor edges from MCPWM unit 0's three capture channels, one per tester
+// channel. The capture timer (APB clock, 80 MHz) is latched by the edge
+// itself, so the time doesn't depend on when the ISR gets to run - WiFi
+// and flash access can delay interrupts by tens of microseconds, and a GPIO
+// ISR that reads micros() turns that into interval jitter.
+//
+// The ISR converts the capture value to Hal::micros(): each channel keeps
+// a (ticks, micros) anchor taken from micros() at its first edge and moved
+// forward in whole microseconds, so there is no drift (both clocks come
+// from the same crystal). The 32-bit capture timer wraps every 53 s; after
+// a gap of more than RESYNC_US the anchor is taken from micros() again.
+//
+// RMT receive was the other candidate, but it reports pulse durations in
+// batches at the end of a frame rather than an event per edge.
+class McpwmEdgeCapture : public EdgeCapture {
+  public:
+    static const uint8_t MAX_INPUTS = 3;
+    static const uint32_t RESYNC_US = 20000000;
+
+    bool attach(uint8_t channel, uint8_t pin, RPMCounter* counter) override;
+    void detach(uint8_t channel, uint8_t pin) override;
+    const char* getName() const override { return "mcpwm"; }
+
+  private:
+    struct Input {
+      RPMCounter* counter;
+      uint32_t anchorTicks;
+      uint32_t anchorUs;
+      uint32_t lastUs;
+      bool anchored;
+    };
+
+    static Input inputs[MAX_INPUTS];
+
+    static bool IRAM_ATTR onCapture(mcpwm_unit_t unit, mcpwm_capture_channel_id_t channel,
+                                    const cap_event_data_t* event, void* context);
+};
+
+#endif
+
+#endif
@@ -1,81 +1,135 @@
 #include <Arduino.h>
-#include <ESP8266WiFi.h>
-#include "wifi_secrets.h"
 #include "MDNSService.h"
 #include "OTAService.h"
 #include "WebServer.h"
-#include "RPMCounter.h"
-#include "MotorController.h"
+#include "Channels.h"
+#include "NetworkService.h"
+#include "ConfigStore.h"
+#include "Scheduler.h"
+#include "UdpTelemetry.h"
+#include "Endurance.h"
+#include "Vibration.h"
+#include "SupplyMonitor.h"
+#include "LatencyProbe.h"
+#include "Benchmark.h"
+#include "Logger.h"
 
-// Pin definitions
-#define RPM_SENSOR_PIN D4
+// Pin definitions, one row per channel (TESTER_CHANNELS of them are used).
+#ifdef ESP32
+// GPIO numbers on an ESP32 DevKit. None of them is a strapping or flash pin,
+// and the sensors avoid the input-only pins 34-39, which have no pull-up.
+static const ChannelPins CHANNEL_PINS[] = {
+  {4, {25, 26, 27}},   // Sensor 4, IN3 -> 25, IN4 -> 26, ENB -> 27
+  {16, {32, 33, 14}},  // Sensor 16, IN1 -> 32, IN2 -> 33, ENA -> 14
+  {17, {18, 19, 21}},  // Sensor 17, second L298N: IN3 -> 18, IN4 -> 19, ENB -> 21
+};
+static_assert(TESTER_CHANNELS <= sizeof(CHANNEL_PINS) / sizeof(CHANNEL_PINS[0]),
+              "Not enough pins assigned on the ESP32 for TESTER_CHANNELS channels");
+#else
+// Channel 0 is the original wiring on bridge B of the L298N; channel 1 uses
+// bridge A of the same module. Channel 1's EN sits on D8, which the board
+// pulls low at boot - that keeps the motor off while the ESP starts.
+static const ChannelPins CHANNEL_PINS[] = {
+  {D4, {D1, D2, D3}},  // Sensor D4, IN3 -> D1, IN4 -> D2, ENB -> D3
+  {D5, {D6, D7, D8}},  // Sensor D5, IN1 -> D6, IN2 -> D7, ENA -> D8
+};
+static_assert(TESTER_CHANNELS <= sizeof(CHANNEL_PINS) / sizeof(CHANNEL_PINS[0]),
+              "Not enough free pins on the ESP8266 for TESTER_CHANNELS channels");
+#endif
+
+#ifdef ESP32
+// Core 0 belongs to WiFi, lwIP and AsyncTCP (CONFIG_ASYNC_TCP_RUNNING_CORE=0
+// in platformio.ini); the scheduler gets core 1 to itself. Above the Arduino
+// loop task's priority, which is deleted anyway.
+static const uint32_t MEASUREMENT_STACK = 8192;
+static const UBaseType_t MEASUREMENT_PRIORITY = 2;
+static const BaseType_t MEASUREMENT_CORE = 1;
+
+static void measurementTask(void*) {
+  for (;;) {
+    LATENCY_PROBE(PROBE_LOOP);
+    // The scheduler blocks between tasks (Hal::sleepMicros), so core 1's
+    // idle task runs too
+    Scheduler::run();
+  }
+}
+#endif
+
+// Periodic status line on the log (replaces the once-per-second print that
+// used to live inside RPMCounter::update())
+static void printTelemetry() {
+  static unsigned long lastPrintedCount[Channels::MAX_CHANNELS] = {0};
+  for (uint8_t i = 0; i < Channels::getCount(); i++) {
+    const RPMCounter& counter = Channels::get(i).rpm;
+    
+    // Stay quiet while no signals are arriving
+    unsigned long count = counter.getSignalCount();
+    if (count == lastPrintedCount[i]) continue;
+    lastPrintedCount[i] = count;
+    
+    long rpmTenths = (long)((counter.getCurrentCentiRpm() + 5) / 10);
+    LOG_INFO("ch%ld RPM: %ld.%ld (Count: %lu)", i, rpmTenths / 10, rpmTenths % 10, count);
+  }
+}
 
 void setup() {
   Serial.begin(115200);
-  delay(1000);
   
   Serial.println("\n=== ESP RacePi Motor Tester ===");
   Serial.println("Initializing...");
   
-  // Initialize WiFi
-  WiFi.begin(MY_SSID, MY_PW);
-  Serial.print("Connecting to WiFi");
+  // Tuning parameters are needed by everything below
+  ConfigStore::begin();
   
-  while (WiFi.status() != WL_CONNECTED) {
-    delay(500);
-    Serial.print(".");
-  }
+  // Measurement first - it must not wait for the network
+  Channels::begin(CHANNEL_PINS, TESTER_CHANNELS);
+  Endurance::begin();
+  Vibration::begin();
+  SupplyMonitor::begin();
   
-  Serial.println();
-  Serial.println("WiFi connected!");
-  Serial.print("IP address: ");
-  Serial.println(WiFi.localIP());
-  Serial.print("Hostname: esp-racepi-motor-tester.local");
-  Serial.println();
+  // WiFi, MDNS, OTA and the web server come up in the background
+  NetworkService::begin();
   
-  // Initialize services
-  MDNSService::begin();
-  OTAService::begin();
-  WebServer::begin();
+  // Register tasks: name, function, period (us), priority (0 = highest), budget (us)
+  // The measurement path keeps a 500us cadence; background services get
+  // their own periods and are never starved, even during a test
+  Scheduler::addTask("rpm", Channels::updateRpm, 500, 0, 100 * TESTER_CHANNELS);
+  Scheduler::addTask("motor", Channels::updateMotors, 500, 1, 200 * TESTER_CHANNELS);
+  Scheduler::addTask("supply", SupplyMonitor::update, 10000, 2, 200);
+  Scheduler::addTask("udp", UdpTelemetry::update, 2000, 2, 500 * TESTER_CHANNELS, false);
+  Scheduler::addTask("endurance", Endurance::update, 100000, 2, 1000);
+  Scheduler::addTask("vibration", Vibration::update, 50000, 3, 3000 * TESTER_CHANNELS);
+  Scheduler::addTask("ota", OTAService::handle, 50000, 2, 2000, false);
+  Scheduler::addTask("mdns", MDNSService::update, 100000, 3, 2000, false);
+  Scheduler::addTask("network", NetworkService::update, 100000, 3, 2000, false);
+  Scheduler::addTask("telemetry", printTelemetry, 1000000, 4, 5000);
+  Scheduler::addTask("log", Logger::drain, 20000, 5, 1000);
+  // Idle unless /api/benchmark/start queued a run, which then blocks for seconds
+  Scheduler::addTask("benchmark", Benchmark::update, 100000, 5, 100, false);
   
-  // Initialize RPM counter
-  RPMCounter::begin(RPM_SENSOR_PIN);
-  
-  // Initialize motor controller
-  MotorController::begin();
-  
-  Serial.println("=== System Ready ===");
-  Serial.println("RPM measurement active on pin D4");
-  Serial.println("Motor control active (L298N on D1, D2, D3)");
-  Serial.println("Visit http://esp-racepi-motor-tester.local for web interface");
+  Serial.print("=== System Ready after ");
+  Serial.print(millis());
+  Serial.println(" ms ===");
+  for (uint8_t i = 0; i < Channels::getCount(); i++) {
+    Serial.printf("Channel %u: RPM sensor on GPIO%u (%s capture), L298N on GPIO%u, GPIO%u, GPIO%u\n", i,
+                  CHANNEL_PINS[i].sensor, Channels::getCapture().getName(), CHANNEL_PINS[i].motor.in1,
+                  CHANNEL_PINS[i].motor.in2, CHANNEL_PINS[i].motor.enable);
+  }
+  Serial.printf("Web interface: http://%s.local once WiFi is up\n", NetworkService::getHostname());
   Serial.println();
+
+#ifdef ESP32
+  xTaskCreatePinnedToCore(measurementTask, "measure", MEASUREMENT_STACK, nullptr,
+                          MEASUREMENT_PRIORITY, nullptr, MEASUREMENT_CORE);
+#endif
 }
 
 void loop() {
-  // Check if acceleration test is running - prioritize for maximum accuracy
-  bool testRunning = MotorController::isAccelerationTestRunning();
-  
-  if (testRunning) {
-    // During acceleration test: minimize interference for maximum precision
-    // Only update critical components
-    RPMCounter::update();
-    MotorController::updateAccelerationTest();
-    
-    // Minimal delay for faster loop during test
-    delayMicroseconds(100); // 0.1ms instead of 10ms
-  } else {
-    // Normal operation: update all services
-    MDNSService::update();
-    OTAService::handle();
-    WebServer::handle();
-    
-    // Process RPM counter signals
-    RPMCounter::update();
-    
-    // Update acceleration test if running
-    MotorController::updateAccelerationTest();
-    
-    // Keep the main loop responsive
-    delay(10);
-  }
-}
\ No newline at end of file
+#ifdef ESP32
+  // Everything runs in measurementTask
+  vTaskDelete(nullptr);
+#else
+  LATENCY_PROBE(PROBE_LOOP);
+  Scheduler::run();
+#endif
+}
@@ -0,0 +1,273 @@
+// Native (host) implementation of Hal.h on top of a simulated clock,
+// simulated pins and a simulated interrupt controller.
+
+#ifndef ARDUINO
+
+#include "../Hal.h"
+#include "Simulation.h"
+
+#include <chrono>
+#include <map>
+#include <vector>
+#include <algorithm>
+
+namespace {
+  const uint8_t PIN_COUNT = 17;
+
+  struct InputEvent {
+    uint8_t pin;
+    int level;
+    bool always; // Fire even without a level change
+  };
+
+  uint64_t currentTime = 0;
+  uint64_t nextDeviceStep = 0;
+
+  int pinLevel[PIN_COUNT] = {0};
+  uint8_t pinModes[PIN_COUNT] = {0};
+  int pwmValue[PIN_COUNT] = {0};
+  uint32_t pwmFrequency = 1000;
+
+  int analogValue = 0;
+  Sim::AnalogFunction analogSource = nullptr;
+  void* analogContext = nullptr;
+
+  void (*handlers[PIN_COUNT])(void) = {nullptr};
+  bool interruptsEnabled = true;
+  bool pendingInterrupt[PIN_COUNT] = {false};
+
+  uint32_t interruptLatencyUs = 0;
+  uint32_t latencyRandom = 1;
+  uint32_t clockOffset = 0; // Added to micros() while a handler runs late
+
+  Sim::CaptureFunction captures[PIN_COUNT] = {nullptr};
+  void* captureContexts[PIN_COUNT] = {nullptr};
+
+  std::multimap<uint64_t, InputEvent> inputEvents;
+  std::vector<SimDevice*> devices;
+  bool consoleEcho = false;
+
+  uint32_t nextLatency() {
+    if (interruptLatencyUs == 0) return 0;
+    latencyRandom = latencyRandom * 1664525 + 1013904223; // LCG, repeatable
+    return (latencyRandom >> 8) % (interruptLatencyUs + 1);
+  }
+
+  void fireInterrupt(uint8_t pin) {
+    if (!handlers[pin]) return;
+    if (interruptsEnabled) {
+      clockOffset = nextLatency();
+      handlers[pin]();
+      clockOffset = 0;
+    } else {
+      pendingInterrupt[pin] = true;
+    }
+  }
+
+  void applyInput(const InputEvent& event) {
+    if (event.pin >= PIN_COUNT) return;
+    if (pinLevel[event.pin] == event.level && !event.always) return;
+    pinLevel[event.pin] = event.level;
+    if (captures[event.pin]) {
+      captures[event.pin]((uint32_t)currentTime, event.level, captureContexts[event.pin]);
+    }
+    fireInterrupt(event.pin);
+  }
+}
+
+namespace Sim {
+  uint64_t now() {
+    return currentTime;
+  }
+
+  void advanceTo(uint64_t timeUs) {
+    while (true) {
+      uint64_t nextEvent = inputEvents.empty() ? UINT64_MAX : inputEvents.begin()->first;
+      uint64_t nextStep = devices.empty() ? UINT64_MAX : nextDeviceStep;
+      uint64_t next = std::min(nextEvent, nextStep);
+      if (next > timeUs) break;
+
+      if (next > currentTime) currentTime = next;
+
+      if (nextEvent <= nextStep) {
+        InputEvent event = inputEvents.begin()->second;
+        inputEvents.erase(inputEvents.begin());
+        applyInput(event);
+      } else {
+        nextDeviceStep += STEP_US;
+        for (SimDevice* device : devices) {
+          device->step(currentTime);
+        }
+      }
+    }
+
+    if (timeUs > currentTime) currentTime = timeUs;
+  }
+
+  void advanceBy(uint64_t durationUs) {
+    advanceTo(currentTime + durationUs);
+  }
+
+  void scheduleInput(uint64_t timeUs, uint8_t pin, int level) {
+    if (timeUs < currentTime) timeUs = currentTime;
+    inputEvents.insert(std::make_pair(timeUs, InputEvent{pin, level, false}));
+  }
+
+  void scheduleInterrupt(uint64_t timeUs, uint8_t pin, int level) {
+    if (timeUs < currentTime) timeUs = currentTime;
+    inputEvents.insert(std::make_pair(timeUs, InputEvent{pin, level, true}));
+  }
+
+  void clearScheduledInputs() {
+    inputEvents.clear();
+  }
+
+  void setInterruptLatency(uint32_t maxUs, uint32_t seed) {
+    interruptLatencyUs = maxUs;
+    latencyRandom = seed;
+  }
+
+  void attachCapture(uint8_t pin, CaptureFunction function, void* context) {
+    if (pin >= PIN_COUNT) return;
+    captures[pin] = function;
+    captureContexts[pin] = context;
+  }
+
+  void addDevice(SimDevice* device) {
+    if (devices.empty()) nextDeviceStep = currentTime;
+    devices.push_back(device);
+  }
+
+  void removeDevice(SimDevice* device) {
+    devices.erase(std::remove(devices.begin(), devices.end(), device), devices.end());
+  }
+
+  void setAnalogInput(int value) {
+    analogValue = value;
+    analogSource = nullptr;
+  }
+
+  void setAnalogSource(AnalogFunction function, void* context) {
+    analogSource = function;
+    analogContext = context;
+  }
+
+  int getOutput(uint8_t pin) {
+    return pin < PIN_COUNT ? pinLevel[pin] : 0;
+  }
+
+  int getPwm(uint8_t pin) {
+    return pin < PIN_COUNT ? pwmValue[pin] : 0;
+  }
+
+  uint32_t getPwmFrequency() {
+    return pwmFrequency;
+  }
+
+  void setConsoleEcho(bool enabled) {
+    consoleEcho = enabled;
+  }
+}
+
+namespace Hal {
+  unsigned long micros() {
+    return (unsigned long)(currentTime + clockOffset);
+  }
+
+  unsigned long millis() {
+    return (unsigned long)(currentTime / 1000);
+  }
+
+  uint64_t micros64() {
+    return currentTime;
+  }
+
+  // Real host time, so latency probes and benchmarks measure actual cost.
+  // One "cycle" is one nanosecond.
+  uint32_t cycleCount() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  uint32_t cpuFreqMHz() {
+    return 1000;
+  }
+
+  void delay(unsigned long ms) {
+    Sim::advanceBy((uint64_t)ms * 1000);
+  }
+
+  void delayMicroseconds(unsigned int us) {
+    Sim::advanceBy(us);
+  }
+
+  void yield() {
+    // No watchdog here, and virtual time only moves while sleeping
+  }
+
+  void sleepMicros(unsigned long us) {
+    if (us >= 2000) delay(us / 1000);
+    else delayMicroseconds(us);
+  }
+
+  void pinMode(uint8_t pin, uint8_t mode) {
+    if (pin >= PIN_COUNT) return;
+    // The sensor actively drives its line, so pull-ups don't change the level
+    pinModes[pin] = mode;
+  }
+
+  int digitalRead(uint8_t pin) {
+    return pin < PIN_COUNT ? pinLevel[pin] : LOW;
+  }
+
+  void digitalWrite(uint8_t pin, uint8_t value) {
+    if (pin < PIN_COUNT) pinLevel[pin] = value ? HIGH : LOW;
+  }
+
+  int analogRead(uint8_t pin) {
+    if (pin != A0) return 0;
+    int value = analogSource ? analogSource(currentTime, analogContext) : analogValue;
+    return value < 0 ? 0 : (value > 1023 ? 1023 : value);
+  }
+
+  void analogWrite(uint8_t pin, int value) {
+    if (pin < PIN_COUNT) pwmValue[pin] = value;
+  }
+
+  void analogWriteFreq(uint32_t frequency) {
+    pwmFrequency = frequency;
+  }
+
+  void attachInterrupt(uint8_t pin, void (*handler)(void), int mode) {
+    (void)mode; // Only CHANGE is used by the firmware
+    if (pin < PIN_COUNT) handlers[pin] = handler;
+  }
+
+  void detachInterrupt(uint8_t pin) {
+    if (pin < PIN_COUNT) handlers[pin] = nullptr;
+  }
+
+  void disableInterrupts() {
+    interruptsEnabled = false;
+  }
+
+  void enableInterrupts() {
+    interruptsEnabled = true;
+    for (uint8_t pin = 0; pin < PIN_COUNT; pin++) {
+      if (pendingInterrupt[pin]) {
+        pendingInterrupt[pin] = false;
+        fireInterrupt(pin);
+      }
+    }
+  }
+
+  int consoleAvailableForWrite() {
+    return 4096;
+  }
+
+  void consoleWrite(const uint8_t* data, size_t length) {
+    if (consoleEcho) fwrite(data, 1, length, stdout);
+  }
+}
+
+#endif
@@ -0,0 +1,169 @@
+#ifndef ARDUINO
+
+#include "MotorModel.h"
+#include "../Hal.h"
+
+#include <math.h>
+#include <string.h>
+
+MotorModel::MotorModel(uint8_t in1Pin, uint8_t in2Pin, uint8_t enablePin)
+  : in1Pin(in1Pin), in2Pin(in2Pin), enablePin(enablePin), params(defaults()),
+    omega(0.0), current(0.0), supplyCurrent(0.0), appliedVolts(0.0), driving(false),
+    thresholdCount(0), runCount(0) {
+  memset(thresholds, 0, sizeof(thresholds));
+  memset(runs, 0, sizeof(runs));
+}
+
+MotorModel::Parameters MotorModel::defaults() {
+  // Small 2S-powered 380-size hobby motor with the optical disc fitted:
+  // ~26000 RPM no-load at full duty, ~1 s mechanical time constant
+  Parameters p;
+  p.supplyVolts = 8.4;
+  p.supplyResistanceOhms = 0.0;
+  p.bridgeDropVolts = 1.8;
+  p.resistanceOhms = 1.5;
+  p.inductanceHenry = 0.0;
+  p.backEmfConstant = 0.0024;
+  p.inertia = 4e-6;
+  p.viscousFriction = 1e-7;
+  p.coulombFriction = 0.0008;
+  return p;
+}
+
+void MotorModel::setParameters(const Parameters& parameters) {
+  params = parameters;
+}
+
+void MotorModel::reset() {
+  omega = 0.0;
+  current = 0.0;
+  supplyCurrent = 0.0;
+  appliedVolts = 0.0;
+  driving = false;
+  resetRuns();
+}
+
+void MotorModel::setThresholds(const double* rpm, uint8_t count) {
+  thresholdCount = count < MAX_THRESHOLDS ? count : MAX_THRESHOLDS;
+  for (uint8_t i = 0; i < thresholdCount; i++) {
+    thresholds[i] = rpm[i];
+  }
+}
+
+void MotorModel::resetRuns() {
+  runCount = 0;
+  memset(runs, 0, sizeof(runs));
+}
+
+void MotorModel::step(uint64_t nowUs) {
+  const double dt = Sim::STEP_US / 1000000.0;
+
+  int pwm = Sim::getPwm(enablePin);
+  double duty = pwm / 255.0; // ESP8266 analogWrite range
+  if (duty > 1.0) duty = 1.0;
+  if (duty < 0.0) duty = 0.0;
+
+  int in1 = Sim::getOutput(in1Pin);
+  int in2 = Sim::getOutput(in2Pin);
+  // Sag from the previous step's current - the steps are far shorter than
+  // any electrical or mechanical time constant
+  double bridgeVolts = getSupplyVolts() - params.bridgeDropVolts;
+  if (bridgeVolts < 0.0) bridgeVolts = 0.0;
+
+  // L298N truth table: EN low coasts, IN1 == IN2 brakes, otherwise drives
+  bool coasting = duty == 0.0;
+  double volts = 0.0;
+  if (!coasting && in1 != in2) {
+    volts = (in1 == HIGH ? 1.0 : -1.0) * duty * bridgeVolts;
+  }
+  appliedVolts = volts;
+
+  // A new run starts whenever the bridge starts driving
+  bool nowDriving = !coasting && in1 != in2;
+  if (nowDriving && !driving && runCount < MAX_RUNS) {
+    runs[runCount].startUs = nowUs;
+    runs[runCount].startRpm = getRpm();
+    runs[runCount].maxRpm = getRpm();
+    runCount++;
+  }
+  driving = nowDriving;
+
+  double backEmf = params.backEmfConstant * omega;
+  if (coasting) {
+    current = 0.0; // Open bridge: inductive energy goes to the flyback diodes
+  } else if (params.inductanceHenry > 0.0) {
+    // Braking only shorts the windings for the duty fraction
+    double drive = in1 != in2 ? volts : 0.0;
+    double effectiveEmf = in1 != in2 ? backEmf : duty * backEmf;
+    current += (drive - params.resistanceOhms * current - effectiveEmf) / params.inductanceHenry * dt;
+  } else if (in1 != in2) {
+    current = (volts - backEmf) / params.resistanceOhms;
+  } else {
+    current = -duty * backEmf / params.resistanceOhms;
+  }
+
+  supplyCurrent = in1 != in2 ? duty * fabs(current) : 0.0;
+
+  double torque = params.backEmfConstant * current - params.viscousFriction * omega;
+
+  // Static friction holds the rotor until the drive torque overcomes it
+  if (omega != 0.0 || fabs(torque) > params.coulombFriction) {
+    double friction = omega > 0.0 || (omega == 0.0 && torque > 0.0) ? params.coulombFriction : -params.coulombFriction;
+    double newOmega = omega + (torque - friction) / params.inertia * dt;
+    // Friction can stop the rotor but never reverse it
+    if ((omega > 0.0 && newOmega < 0.0 && torque <= params.coulombFriction) ||
+        (omega < 0.0 && newOmega > 0.0 && torque >= -params.coulombFriction)) {
+      newOmega = 0.0;
+    }
+    omega = newOmega;
+  }
+
+  recordCrossings(nowUs);
+}
+
+void MotorModel::recordCrossings(uint64_t nowUs) {
+  if (!driving || runCount == 0) return;
+
+  Run& run = runs[runCount - 1];
+  double rpm = getRpm();
+  if (rpm > run.maxRpm) run.maxRpm = rpm;
+  for (uint8_t i = 0; i < thresholdCount; i++) {
+    if (run.crossingUs[i] == 0 && rpm >= thresholds[i]) {
+      run.crossingUs[i] = nowUs;
+    }
+  }
+}
+
+double MotorModel::getRpm() const {
+  return omega * 60.0 / (2.0 * M_PI);
+}
+
+double MotorModel::getSupplyVolts() const {
+  return params.supplyVolts - params.supplyResistanceOhms * supplyCurrent;
+}
+
+double MotorModel::getStallVolts() const {
+  // Kt V / R = Tf at standstill
+  return params.bridgeDropVolts + params.coulombFriction * params.resistanceOhms / params.backEmfConstant;
+}
+
+double MotorModel::getFinalRpm() const {
+  // Kt (V - Ke w) / R = b w + Tf
+  double volts = params.supplyVolts - params.bridgeDropVolts;
+  double k = params.backEmfConstant;
+  double omegaFinal = (k * volts / params.resistanceOhms - params.coulombFriction) /
+                      (k * k / params.resistanceOhms + params.viscousFriction);
+  return omegaFinal > 0.0 ? omegaFinal * 60.0 / (2.0 * M_PI) : 0.0;
+}
+
+double MotorModel::getTimeConstant() const {
+  double k = params.backEmfConstant;
+  return params.inertia / (k * k / params.resistanceOhms + params.viscousFriction);
+}
+
+double MotorModel::speedOf(uint64_t nowUs, void* context) {
+  (void)nowUs;
+  return fabs(static_cast<MotorModel*>(context)->getRpm());
+}
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef MOTOR_TESTER_MOTOR_MODEL_H
+#define MOTOR_TESTER_MOTOR_MODEL_H
+
+#include "Simulation.h"
+
+// Brushed DC motor behind an L298N, driven by whatever the firmware writes
+// to IN3/IN4/ENB. Used as a repeatable plant for the native simulation:
+// feed its speed to a SimEncoder and compare what RPMCounter measures with
+// the true speed.
+//
+// PWM is averaged (duty x bridge voltage) - at 1 kHz the motor's
+// mechanical time constant is orders of magnitude longer than a PWM period.
+//
+//   electrical:  L di/dt = V - R i - Ke w     (first order: L = 0, i = (V - Ke w) / R)
+//   mechanical:  J dw/dt = Kt i - b w - Tf
+class MotorModel : public SimDevice {
+  public:
+    struct Parameters {
+      double supplyVolts;      // Battery / bench supply, open circuit
+      double supplyResistanceOhms; // Internal resistance - the supply sags with the motor current
+      double bridgeDropVolts;  // L298N saturation drop (both transistors)
+      double resistanceOhms;
+      double inductanceHenry;  // 0 selects the first-order model
+      double backEmfConstant;  // Ke, V per rad/s (= Kt in SI units)
+      double inertia;          // J, kg m^2 (rotor + disc)
+      double viscousFriction;  // b, N m per rad/s
+      double coulombFriction;  // Tf, N m
+    };
+
+    static const uint8_t MAX_RUNS = 8;
+    static const uint8_t MAX_THRESHOLDS = 4;
+
+    // Ground truth for one drive period (PWM going from 0 to non-zero)
+    struct Run {
+      uint64_t startUs;
+      double startRpm;                     // Still coasting from the previous run?
+      uint64_t crossingUs[MAX_THRESHOLDS]; // 0 if the threshold wasn't reached
+      double maxRpm;
+    };
+
+    MotorModel(uint8_t in1Pin, uint8_t in2Pin, uint8_t enablePin);
+
+    static Parameters defaults();
+    void setParameters(const Parameters& parameters);
+    const Parameters& getParameters() const { return params; }
+
+    // Rotor at rest, ground truth cleared
+    void reset();
+
+    // Speeds whose crossing time is recorded for every run
+    void setThresholds(const double* rpm, uint8_t count);
+    void resetRuns();
+    uint8_t getRunCount() const { return runCount; }
+    const Run& getRun(uint8_t index) const { return runs[index]; }
+
+    void step(uint64_t nowUs) override;
+
+    double getRpm() const;
+    double getCurrent() const { return current; }
+    double getAppliedVolts() const { return appliedVolts; }
+    double getSupplyVolts() const; // At the terminals, what a divider on A0 sees
+    double getStallVolts() const;  // Lowest supply that overcomes Coulomb friction
+    // Where a full-duty spin-up levels off and its time constant (seconds).
+    // Exact for the first-order model (inductance 0).
+    double getFinalRpm() const;
+    double getTimeConstant() const;
+
+    // SimEncoder::SpeedFunction adapter; context is the MotorModel
+    static double speedOf(uint64_t nowUs, void* context);
+
+  private:
+    uint8_t in1Pin;
+    uint8_t in2Pin;
+    uint8_t enablePin;
+    Parameters params;
+
+    double omega;         // rad/s, positive forward (IN1 HIGH, IN2 LOW)
+    double current;
+    double supplyCurrent; // Average drawn from the supply (duty x motor current)
+    double appliedVolts;
+    bool driving;
+
+    double thresholds[MAX_THRESHOLDS];
+    uint8_t thresholdCount;
+    Run runs[MAX_RUNS];
+    uint8_t runCount;
+
+    void recordCrossings(uint64_t nowUs);
+};
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef ARDUINO
+
+#include "SimEdgeCapture.h"
+#include "../RPMCounter.h"
+
+bool SimEdgeCapture::attach(uint8_t channel, uint8_t pin, RPMCounter* counter) {
+  if (channel >= MAX_INPUTS) return false;
+  Hal::pinMode(pin, INPUT_PULLUP);
+  Sim::attachCapture(pin, onEdge, counter);
+  return true;
+}
+
+void SimEdgeCapture::detach(uint8_t, uint8_t pin) {
+  Sim::attachCapture(pin, nullptr, nullptr);
+}
+
+void SimEdgeCapture::onEdge(uint32_t timeUs, int level, void* context) {
+  static_cast<RPMCounter*>(context)->handleCapturedEdge(timeUs, level == HIGH);
+}
+
+#endif
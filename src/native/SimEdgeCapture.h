@@ -0,0 +1,23 @@
+#ifndef MOTOR_TESTER_SIM_EDGE_CAPTURE_H
+#define MOTOR_TESTER_SIM_EDGE_CAPTURE_H
+
+#include "../EdgeCapture.h"
+#include "Simulation.h"
+
+// Host stand-in for a hardware capture unit (McpwmEdgeCapture on the
+// ESP32): edges arrive with the time the simulation changed the pin, not
+// the time an interrupt handler got to read micros(), so
+// Sim::setInterruptLatency() doesn't affect them.
+class SimEdgeCapture : public EdgeCapture {
+  public:
+    static const uint8_t MAX_INPUTS = 3;
+
+    bool attach(uint8_t channel, uint8_t pin, RPMCounter* counter) override;
+    void detach(uint8_t channel, uint8_t pin) override;
+    const char* getName() const override { return "sim-capture"; }
+
+  private:
+    static void onEdge(uint32_t timeUs, int level, void* context);
+};
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef ARDUINO
+
+#include "SimEncoder.h"
+#include "../Hal.h"
+
+#include <math.h>
+
+SimEncoder::SimEncoder(uint8_t pin, uint32_t pulseWidthUs)
+  : pin(pin), pulseWidthUs(pulseWidthUs), speedFunction(nullptr), speedContext(nullptr),
+    apertureCount(1), faults{0.0, 0.0, 200, 1}, randomState(1),
+    phase(0.0), revolutions(0), lastRiseUs(0), lowUntilUs(0) {
+  apertures[0] = Aperture{0.0, 1.0};
+}
+
+void SimEncoder::addPulse(uint64_t riseUs, uint32_t widthUs) {
+  Sim::scheduleInput(riseUs, pin, HIGH);
+  Sim::scheduleInput(riseUs + widthUs, pin, LOW);
+}
+
+void SimEncoder::addConstantSpeed(uint64_t fromUs, uint64_t toUs, double rpm) {
+  if (rpm <= 0) return;
+  double intervalUs = 60000000.0 / rpm;
+  for (double t = (double)fromUs; t < (double)toUs; t += intervalUs) {
+    addPulse((uint64_t)t, pulseWidthUs);
+  }
+}
+
+void SimEncoder::setSpeedSource(SpeedFunction function, void* context) {
+  speedFunction = function;
+  speedContext = context;
+}
+
+bool SimEncoder::addAperture(double phase, double widthScale) {
+  if (apertureCount >= MAX_APERTURES || phase <= 0.0 || phase >= 1.0) return false;
+  apertures[apertureCount++] = Aperture{phase, widthScale};
+  return true;
+}
+
+void SimEncoder::clearExtraApertures() {
+  apertureCount = 1;
+}
+
+void SimEncoder::resetPosition() {
+  phase = 0.0;
+  lowUntilUs = 0;
+}
+
+void SimEncoder::setFaults(const Faults& newFaults) {
+  faults = newFaults;
+  randomState = faults.seed ? faults.seed : 1;
+}
+
+void SimEncoder::step(uint64_t nowUs) {
+  if (!speedFunction) return;
+
+  double rpm = speedFunction(nowUs, speedContext);
+  if (rpm <= 0) return;
+
+  // Revolutions per microsecond at the current speed; every aperture whose
+  // phase is crossed within this step gets its pulse at the exact time
+  double rate = rpm / 60000000.0;
+  double stepEnd = phase + Sim::STEP_US * rate;
+
+  for (uint8_t i = 0; i < apertureCount; i++) {
+    double aperturePhase = apertures[i].phase;
+    if (aperturePhase <= phase) aperturePhase += 1.0; // Next pass is in the next revolution
+    if (aperturePhase > stepEnd) continue;
+
+    double riseUs = nowUs + (aperturePhase - phase) / rate;
+    if (faults.jitterUs > 0) riseUs += gaussian() * faults.jitterUs;
+    emitPulse(riseUs, pulseWidthUs * apertures[i].widthScale);
+
+    if (i == 0) {
+      lastRiseUs = (uint64_t)riseUs;
+      revolutions++;
+
+      // Spurious reflection somewhere in the following revolution
+      if (faults.reflectionProbability > 0 && uniform() < faults.reflectionProbability) {
+        double offsetUs = (0.2 + 0.6 * uniform()) / rate;
+        emitPulse(riseUs + offsetUs, faults.reflectionWidthUs);
+      }
+    }
+  }
+
+  phase = stepEnd - floor(stepEnd);
+}
+
+void SimEncoder::emitPulse(double riseUs, double widthUs) {
+  // Pulses can't overlap on a single sensor line
+  if (riseUs < (double)lowUntilUs) return;
+  if (widthUs < 1.0) widthUs = 1.0;
+
+  uint64_t rise = (uint64_t)riseUs;
+  uint64_t width = (uint64_t)widthUs;
+  if (rise < Sim::now()) rise = Sim::now();
+  addPulse(rise, width);
+  lowUntilUs = rise + width + 1;
+}
+
+double SimEncoder::uniform() {
+  // xorshift32 - small, fast and repeatable across platforms
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return (randomState >> 8) / 16777216.0;
+}
+
+double SimEncoder::gaussian() {
+  // Box-Muller
+  double u1 = uniform();
+  double u2 = uniform();
+  if (u1 < 1e-12) u1 = 1e-12;
+  return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef MOTOR_TESTER_SIM_ENCODER_H
+#define MOTOR_TESTER_SIM_ENCODER_H
+
+#include "Simulation.h"
+
+// Simulated optical encoder: each aperture in the disc produces a HIGH
+// pulse on the sensor pin as it passes. The main aperture (index 0, at
+// phase 0) gives pulses of pulseWidthUs; extra apertures scale that width.
+// Edges can be scripted directly (addPulse) or generated from a speed
+// source evaluated as time advances, optionally with the sensor faults the
+// ISR filter has to deal with: edge jitter, reflections and extra apertures.
+class SimEncoder : public SimDevice {
+  public:
+    typedef double (*SpeedFunction)(uint64_t nowUs, void* context); // RPM at nowUs
+
+    static const uint8_t MAX_APERTURES = 4;
+
+    struct Faults {
+      double jitterUs;              // Std deviation of edge timing noise
+      double reflectionProbability; // Chance per revolution of a spurious pulse
+      uint32_t reflectionWidthUs;   // Width of spurious pulses
+      uint32_t seed;                // Random seed, runs are repeatable
+    };
+
+    SimEncoder(uint8_t pin, uint32_t pulseWidthUs = 1000);
+
+    // Scripted edges
+    void addPulse(uint64_t riseUs, uint32_t widthUs);
+    void addConstantSpeed(uint64_t fromUs, uint64_t toUs, double rpm);
+
+    // Continuous speed source (e.g. a motor model); nullptr stops generation
+    void setSpeedSource(SpeedFunction function, void* context);
+
+    // Extra aperture at `phase` (0..1 of a revolution) whose pulse is
+    // widthScale x the main pulse width
+    bool addAperture(double phase, double widthScale);
+    void clearExtraApertures();
+    // Disc back to the main aperture, as if freshly mounted
+    void resetPosition();
+    void setFaults(const Faults& faults);
+
+    void step(uint64_t nowUs) override;
+
+    unsigned long getRevolutions() const { return revolutions; }
+    uint64_t getLastRiseTime() const { return lastRiseUs; }
+
+  private:
+    struct Aperture {
+      double phase;
+      double widthScale;
+    };
+
+    uint8_t pin;
+    uint32_t pulseWidthUs;
+    SpeedFunction speedFunction;
+    void* speedContext;
+    Aperture apertures[MAX_APERTURES];
+    uint8_t apertureCount;
+    Faults faults;
+    uint32_t randomState;
+    double phase;               // Position within the revolution, 0..1
+    unsigned long revolutions;
+    uint64_t lastRiseUs;
+    uint64_t lowUntilUs;        // The sensor can't start a pulse before the previous one ended
+
+    void emitPulse(double riseUs, double widthUs);
+    double uniform();
+    double gaussian();
+};
+
+#endif
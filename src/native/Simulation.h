@@ -0,0 +1,63 @@
+#ifndef MOTOR_TESTER_SIMULATION_H
+#define MOTOR_TESTER_SIMULATION_H
+
+#include <stdint.h>
+
+// Host-side simulation backing the native HAL. Time is virtual: it only
+// advances when the firmware sleeps (Hal::delay / Hal::delayMicroseconds)
+// or when Sim::advanceTo() is called, so simulated runs complete many
+// times faster than real time and are fully deterministic.
+
+// Something that evolves with simulated time (an encoder, a motor model).
+// step() is called every Sim::STEP_US and may schedule input edges at or
+// after the current time.
+class SimDevice {
+  public:
+    virtual ~SimDevice() {}
+    virtual void step(uint64_t nowUs) = 0;
+};
+
+namespace Sim {
+  const uint32_t STEP_US = 20;
+
+  uint64_t now();
+  void advanceTo(uint64_t timeUs);
+  void advanceBy(uint64_t durationUs);
+
+  // Drive an input pin to `level` at `timeUs`; fires the attached
+  // interrupt handler (CHANGE) exactly as the hardware would
+  void scheduleInput(uint64_t timeUs, uint8_t pin, int level);
+  // Same, but fires the handler even if the level doesn't change - replays
+  // a recorded interrupt where the ISR read back the level it had before
+  void scheduleInterrupt(uint64_t timeUs, uint8_t pin, int level);
+  void clearScheduledInputs();
+
+  // Interrupt entry latency: every pin-change handler runs a random 0 to
+  // maxUs late, so micros() read inside it is late too (the jitter WiFi
+  // causes on the ESP8266). 0 (default) runs handlers at the edge.
+  void setInterruptLatency(uint32_t maxUs, uint32_t seed);
+
+  // A hardware capture unit on `pin`: `function` gets every level change
+  // with its exact time, whatever the interrupt latency. nullptr detaches.
+  typedef void (*CaptureFunction)(uint32_t timeUs, int level, void* context);
+  void attachCapture(uint8_t pin, CaptureFunction function, void* context);
+
+  void addDevice(SimDevice* device);
+  void removeDevice(SimDevice* device);
+
+  // The ADC (A0): a fixed reading, or a function evaluated at every
+  // Hal::analogRead() so readings line up with simulated time exactly
+  typedef int (*AnalogFunction)(uint64_t nowUs, void* context); // 0-1023
+  void setAnalogInput(int value);
+  void setAnalogSource(AnalogFunction function, void* context);
+
+  // Observe what the firmware drives
+  int getOutput(uint8_t pin);
+  int getPwm(uint8_t pin);
+  uint32_t getPwmFrequency();
+
+  // Echo Logger output to stdout (default off)
+  void setConsoleEcho(bool enabled);
+}
+
+#endif
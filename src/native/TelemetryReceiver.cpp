@@ -0,0 +1,119 @@
+#ifndef ARDUINO
+
+#include "TelemetryReceiver.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+TelemetryReceiver::TelemetryReceiver() : socketFd(-1), boundPort(0), output(nullptr) {
+  memset(&stats, 0, sizeof(stats));
+  memset(seen, 0, sizeof(seen));
+  memset(nextSequence, 0, sizeof(nextSequence));
+  memset(lostByChannel, 0, sizeof(lostByChannel));
+  memset(&lastPacket, 0, sizeof(lastPacket));
+}
+
+TelemetryReceiver::~TelemetryReceiver() {
+  close();
+}
+
+bool TelemetryReceiver::open(uint16_t port, std::string& error) {
+  close();
+  socketFd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (socketFd < 0) {
+    error = "can't create a UDP socket";
+    return false;
+  }
+
+  // A full spin-up at the highest rate without polling still fits
+  int bufferSize = 1 << 20;
+  setsockopt(socketFd, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+
+  sockaddr_in local;
+  memset(&local, 0, sizeof(local));
+  local.sin_family = AF_INET;
+  local.sin_addr.s_addr = htonl(INADDR_ANY);
+  local.sin_port = htons(port);
+  socklen_t length = sizeof(local);
+  if (bind(socketFd, (const sockaddr*)&local, sizeof(local)) != 0 ||
+      getsockname(socketFd, (sockaddr*)&local, &length) != 0) {
+    error = "can't bind UDP port " + std::to_string(port);
+    close();
+    return false;
+  }
+  boundPort = ntohs(local.sin_port);
+  return true;
+}
+
+void TelemetryReceiver::close() {
+  if (socketFd >= 0) ::close(socketFd);
+  socketFd = -1;
+  boundPort = 0;
+}
+
+void TelemetryReceiver::setOutput(FILE* file) {
+  output = file;
+  if (output) {
+    fprintf(output, "channel,sequence,timestamp_us,centi_rpm,pwm,state,test,last_pulse_us,lost_samples,interval_us\n");
+  }
+}
+
+unsigned TelemetryReceiver::poll(int timeoutMs) {
+  if (socketFd < 0) return 0;
+
+  unsigned handled = 0;
+  pollfd waiting = {socketFd, POLLIN, 0};
+  while (::poll(&waiting, 1, handled == 0 ? timeoutMs : 0) > 0) {
+    // One byte more than a packet, so oversized datagrams are caught
+    uint8_t buffer[sizeof(TelemetryPacket) + 1];
+    ssize_t received = recv(socketFd, buffer, sizeof(buffer), 0);
+    if (received < 0) break;
+
+    TelemetryPacket packet;
+    memcpy(&packet, buffer, sizeof(packet));
+    if (received != (ssize_t)sizeof(packet) || packet.magic != TelemetryPacket::MAGIC ||
+        packet.version != TelemetryPacket::VERSION || packet.channel >= Channels::MAX_CHANNELS ||
+        packet.sampleCount > TelemetryPacket::MAX_SAMPLES) {
+      stats.invalid++;
+    } else {
+      handle(packet);
+    }
+    handled++;
+  }
+  return handled;
+}
+
+void TelemetryReceiver::handle(const TelemetryPacket& packet) {
+  uint8_t channel = packet.channel;
+  if (seen[channel] && packet.sequence < nextSequence[channel]) {
+    // The sender restarted - follow the new stream
+    seen[channel] = false;
+    lostByChannel[channel] = 0;
+  }
+  if (seen[channel] && packet.sequence != nextSequence[channel]) {
+    stats.missingPackets += packet.sequence - nextSequence[channel];
+  }
+  seen[channel] = true;
+  nextSequence[channel] = packet.sequence + 1;
+
+  stats.lostSamples += packet.lostSamples - lostByChannel[channel];
+  lostByChannel[channel] = packet.lostSamples;
+  stats.packets++;
+  stats.samples += packet.sampleCount;
+  lastPacket = packet;
+
+  if (!output) return;
+  for (uint8_t i = 0; i < packet.sampleCount || (i == 0 && packet.sampleCount == 0); i++) {
+    fprintf(output, "%u,%lu,%llu,%lu,%u,%u,%u,%lu,%lu,", (unsigned)channel, (unsigned long)packet.sequence,
+            (unsigned long long)packet.timestampUs, (unsigned long)packet.centiRpm, (unsigned)packet.pwm,
+            (unsigned)packet.state, (unsigned)packet.testIndex, (unsigned long)packet.lastPulseUs,
+            (unsigned long)packet.lostSamples);
+    if (packet.sampleCount > 0) fprintf(output, "%lu", (unsigned long)packet.intervalsUs[i]);
+    fprintf(output, "\n");
+  }
+}
+
+#endif
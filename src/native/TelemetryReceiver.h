@@ -0,0 +1,52 @@
+#ifndef MOTOR_TESTER_TELEMETRY_RECEIVER_H
+#define MOTOR_TESTER_TELEMETRY_RECEIVER_H
+
+#include "../UdpTelemetry.h"
+
+#include <stdio.h>
+#include <string>
+
+// Reference receiver for UdpTelemetry packets (native `receive` command and
+// the localhost `telemetry` scenario). Validates magic, version and per-channel
+// sequence numbers and writes the stream as CSV, one line per interval
+// sample (a packet without samples still gets a line, with an empty interval).
+class TelemetryReceiver {
+  public:
+    struct Stats {
+      unsigned long packets;
+      unsigned long invalid;          // Wrong size, magic or version
+      unsigned long missingPackets;   // Sequence gaps
+      unsigned long samples;
+      unsigned long lostSamples;      // Sender-side losses, latest count summed over channels
+    };
+
+    TelemetryReceiver();
+    ~TelemetryReceiver();
+
+    bool open(uint16_t port, std::string& error); // 0 picks a free port
+    uint16_t getPort() const { return boundPort; }
+    void close();
+
+    void setOutput(FILE* file); // Writes the CSV header
+
+    // Handles every datagram waiting, waiting up to timeoutMs for the first.
+    // Returns the number of packets handled.
+    unsigned poll(int timeoutMs);
+
+    const Stats& getStats() const { return stats; }
+    const TelemetryPacket& getLastPacket() const { return lastPacket; }
+
+  private:
+    int socketFd;
+    uint16_t boundPort;
+    FILE* output;
+    Stats stats;
+    bool seen[Channels::MAX_CHANNELS];
+    uint32_t nextSequence[Channels::MAX_CHANNELS];
+    uint32_t lostByChannel[Channels::MAX_CHANNELS];
+    TelemetryPacket lastPacket;
+
+    void handle(const TelemetryPacket& packet);
+};
+
+#endif
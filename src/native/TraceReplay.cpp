@@ -0,0 +1,336 @@
+#ifndef ARDUINO
+
+#include "TraceReplay.h"
+#include "Simulation.h"
+#include "../Scheduler.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+
+namespace {
+  bool setConfigField(TesterConfig& config, const char* name, unsigned long value) {
+    struct Field {
+      const char* name;
+      uint32_t* value32;
+      uint16_t* value16;
+    };
+    const Field fields[] = {
+      {"debounceUs", &config.debounceUs, nullptr},
+      {"minSignalLengthUs", &config.minSignalLengthUs, nullptr},
+      {"maxSignalLengthUs", &config.maxSignalLengthUs, nullptr},
+      {"minReasonableRpm", &config.minReasonableRpm, nullptr},
+      {"maxReasonableRpm", &config.maxReasonableRpm, nullptr},
+      {"rpmTarget0", &config.rpmTargets[0], nullptr},
+      {"rpmTarget1", &config.rpmTargets[1], nullptr},
+      {"rpmTarget2", &config.rpmTargets[2], nullptr},
+      {"rpmTarget3", &config.rpmTargets[3], nullptr},
+      {"pauseMs", &config.pauseMs, nullptr},
+      {"timeoutMs", &config.timeoutMs, nullptr},
+      {"minPwm", nullptr, &config.minPwm},
+      {"maxPwm", nullptr, &config.maxPwm},
+      {"pwmFrequencyHz", &config.pwmFrequencyHz, nullptr},
+      {"estimatorNoiseRpm", &config.estimatorNoiseRpm, nullptr},
+      {"estimatorJerkRpmPerS2", &config.estimatorJerkRpmPerS2, nullptr},
+      {"rotorInertiaGcm2", &config.rotorInertiaGcm2, nullptr},
+      {"earlyAbortMarginPercent", &config.earlyAbortMarginPercent, nullptr},
+      {"supplyFullScaleMv", &config.supplyFullScaleMv, nullptr},
+      {"nominalSupplyMv", &config.nominalSupplyMv, nullptr},
+      {"stallSupplyMv", &config.stallSupplyMv, nullptr},
+    };
+    for (const Field& field : fields) {
+      if (strcmp(field.name, name) != 0) continue;
+      if (field.value32) *field.value32 = (uint32_t)value;
+      else *field.value16 = (uint16_t)value;
+      return true;
+    }
+    return false; // A field this tool doesn't know would silently fall back to its default
+  }
+
+  // PWM on-times (ms) from a time-ordered list of (time, pwm) changes
+  struct PwmRuns {
+    bool on;
+    uint64_t onSinceUs;
+    std::vector<unsigned long>* runs;
+
+    void update(uint64_t timeUs, int pwm) {
+      if (pwm > 0 && !on) {
+        on = true;
+        onSinceUs = timeUs;
+      } else if (pwm == 0 && on) {
+        on = false;
+        runs->push_back((unsigned long)((timeUs - onSinceUs) / 1000));
+      }
+    }
+  };
+}
+
+bool TraceReplay::loadTrace(const char* path, Trace& trace, std::string& error) {
+  FILE* file = fopen(path, "r");
+  if (!file) {
+    error = std::string("can't open ") + path;
+    return false;
+  }
+
+  trace.config = ConfigStore::defaults();
+  trace.events.clear();
+  trace.dropped = 0;
+  trace.channel = 0;
+  trace.version = 0;
+
+  char line[256];
+  unsigned lineNumber = 0;
+  bool ok = true;
+  while (ok && fgets(line, sizeof(line), file)) {
+    lineNumber++;
+    char* text = line;
+    while (*text == ' ' || *text == '\t') text++;
+    if (*text == '#' || *text == '\n' || *text == '\r' || *text == '\0') continue;
+
+    unsigned long time = 0;
+    unsigned long value = 0;
+    if (strncmp(text, "version ", 8) == 0) {
+      trace.version = (uint16_t)strtoul(text + 8, nullptr, 10);
+      if (trace.version > EdgeTrace::FORMAT_VERSION) {
+        error = "trace format is newer than this tool";
+        ok = false;
+      }
+    } else if (strncmp(text, "channel ", 8) == 0) {
+      trace.channel = (uint8_t)strtoul(text + 8, nullptr, 10);
+    } else if (strncmp(text, "config ", 7) == 0) {
+      for (char* token = strtok(text + 7, " \r\n"); token; token = strtok(nullptr, " \r\n")) {
+        char* equals = strchr(token, '=');
+        if (!equals) continue;
+        *equals = '\0';
+        if (!setConfigField(trace.config, token, strtoul(equals + 1, nullptr, 10))) {
+          char message[96];
+          snprintf(message, sizeof(message), "line %u: unknown config field %.40s", lineNumber, token);
+          error = message;
+          ok = false;
+          break;
+        }
+      }
+    } else if (strncmp(text, "events ", 7) == 0) {
+      const char* dropped = strstr(text, "dropped ");
+      if (dropped) trace.dropped = strtoul(dropped + 8, nullptr, 10);
+    } else if ((text[0] == EdgeTrace::EVENT_EDGE || text[0] == EdgeTrace::EVENT_PWM) &&
+               sscanf(text + 1, "%lu %lu", &time, &value) == 2) {
+      trace.events.push_back(TraceEvent{(uint32_t)time, (uint16_t)value, (uint8_t)text[0], 0});
+    } else if (text[0] == EdgeTrace::EVENT_TEST_START && sscanf(text + 1, "%lu", &time) == 1) {
+      trace.events.push_back(TraceEvent{(uint32_t)time, 0, (uint8_t)text[0], 0});
+    } else {
+      char message[64];
+      snprintf(message, sizeof(message), "line %u: unrecognised record", lineNumber);
+      error = message;
+      ok = false;
+    }
+  }
+  fclose(file);
+  return ok;
+}
+
+bool TraceReplay::saveTrace(const char* path) {
+  FILE* file = fopen(path, "w");
+  if (!file) return false;
+
+  char line[EdgeTrace::LINE_LENGTH];
+  for (uint16_t i = 0; i < EdgeTrace::getLineCount(); i++) {
+    EdgeTrace::formatLine(i, line, sizeof(line));
+    fprintf(file, "%s\n", line);
+  }
+  return fclose(file) == 0;
+}
+
+bool TraceReplay::replay(const Trace& trace, const ChannelPins& pins, Result& result, std::string& error) {
+  result = Result();
+  uint8_t sensorPin = pins.sensor;
+  uint8_t pwmPin = pins.motor.enable;
+
+  const char* configError = nullptr;
+  if (!ConfigStore::apply(trace.config, &configError)) {
+    error = std::string("trace config rejected: ") + configError;
+    return false;
+  }
+  // Recorded on-times straight from the trace
+  PwmRuns recorded = {false, 0, &result.recordedRunsMs};
+  for (const TraceEvent& event : trace.events) {
+    if (event.type == EdgeTrace::EVENT_PWM) recorded.update(event.timeUs, event.value);
+  }
+
+  // Put the sensor line at its level before the first recorded edge
+  // without waking the ISR, then start from a clean RPMCounter
+  Sim::clearScheduledInputs();
+  Hal::detachInterrupt(sensorPin);
+  for (const TraceEvent& event : trace.events) {
+    if (event.type != EdgeTrace::EVENT_EDGE) continue;
+    Sim::scheduleInput(Sim::now(), sensorPin, event.value ? LOW : HIGH);
+    break;
+  }
+  Sim::advanceBy(1);
+  Channels::begin(&pins, 1); // Also applies the trace's PWM settings
+  Channel& channel = Channels::get(0);
+  unsigned long signalsBefore = channel.rpm.getSignalCount();
+
+  uint64_t base = Sim::now() + 1000;
+  uint64_t end = base;
+  for (const TraceEvent& event : trace.events) {
+    if (event.type == EdgeTrace::EVENT_EDGE) {
+      Sim::scheduleInterrupt(base + event.timeUs, sensorPin, event.value ? HIGH : LOW);
+    }
+    if (base + event.timeUs > end) end = base + event.timeUs;
+  }
+  end += 50000; // Let update() pick up the last edges
+
+  PwmRuns replayed = {false, 0, &result.replayedRunsMs};
+  size_t nextEvent = 0;
+  uint64_t nextSample = base;
+  while (Sim::now() < end) {
+    // Test starts are replayed at their recorded times
+    while (nextEvent < trace.events.size() && base + trace.events[nextEvent].timeUs <= Sim::now()) {
+      if (trace.events[nextEvent].type == EdgeTrace::EVENT_TEST_START) {
+        channel.motor.startAccelerationTest();
+        result.testStarted = true;
+      }
+      nextEvent++;
+    }
+
+    Scheduler::run();
+    replayed.update(Sim::now() - base, Sim::getPwm(pwmPin));
+
+    while (nextSample <= Sim::now() && nextSample < end) {
+      result.rpmSeries.push_back(channel.rpm.getCurrentRPM());
+      nextSample += SERIES_STEP_MS * 1000;
+    }
+  }
+
+  result.signals = channel.rpm.getSignalCount() - signalsBefore;
+  for (int i = 0; i < 4; i++) {
+    result.targetTimes[i] = result.testStarted ? channel.motor.getTargetTime(i) : 0;
+  }
+
+  // A test cut off by the end of the trace would otherwise carry on into
+  // the next replay - let it time out
+  while (channel.motor.isAccelerationTestRunning()) {
+    Scheduler::run();
+  }
+  channel.motor.stop();
+  return true;
+}
+
+bool TraceReplay::saveResult(const char* path, const Result& result) {
+  FILE* file = fopen(path, "w");
+  if (!file) return false;
+
+  fprintf(file, "# replay result\n");
+  fprintf(file, "signals %lu\n", result.signals);
+  fprintf(file, "test %d\n", result.testStarted ? 1 : 0);
+  for (int i = 0; i < 4; i++) {
+    fprintf(file, "target %d %lu\n", i, result.targetTimes[i]);
+  }
+  for (unsigned long ms : result.recordedRunsMs) fprintf(file, "recorded_run %lu\n", ms);
+  for (unsigned long ms : result.replayedRunsMs) fprintf(file, "replayed_run %lu\n", ms);
+  for (size_t i = 0; i < result.rpmSeries.size(); i++) {
+    fprintf(file, "rpm %lu %.1f\n", (unsigned long)(i * SERIES_STEP_MS), result.rpmSeries[i]);
+  }
+  return fclose(file) == 0;
+}
+
+bool TraceReplay::loadResult(const char* path, Result& result, std::string& error) {
+  FILE* file = fopen(path, "r");
+  if (!file) {
+    error = std::string("can't open ") + path;
+    return false;
+  }
+
+  result = Result();
+  char line[128];
+  while (fgets(line, sizeof(line), file)) {
+    unsigned long a = 0;
+    unsigned long b = 0;
+    float rpm = 0;
+    int flag = 0;
+    if (sscanf(line, "signals %lu", &a) == 1) {
+      result.signals = a;
+    } else if (sscanf(line, "test %d", &flag) == 1) {
+      result.testStarted = flag != 0;
+    } else if (sscanf(line, "target %lu %lu", &a, &b) == 2 && a < 4) {
+      result.targetTimes[a] = b;
+    } else if (sscanf(line, "recorded_run %lu", &a) == 1) {
+      result.recordedRunsMs.push_back(a);
+    } else if (sscanf(line, "replayed_run %lu", &a) == 1) {
+      result.replayedRunsMs.push_back(a);
+    } else if (sscanf(line, "rpm %lu %f", &a, &rpm) == 2) {
+      result.rpmSeries.push_back(rpm);
+    }
+  }
+  fclose(file);
+  return true;
+}
+
+bool TraceReplay::compare(const Result& baseline, const Result& actual, double rpmTolerance) {
+  bool same = true;
+
+  if (baseline.signals != actual.signals) {
+    printf("  signals: %lu -> %lu\n", baseline.signals, actual.signals);
+    same = false;
+  }
+  for (int i = 0; i < 4; i++) {
+    if (baseline.targetTimes[i] != actual.targetTimes[i]) {
+      printf("  target %d: %lu ms -> %lu ms\n", i, baseline.targetTimes[i], actual.targetTimes[i]);
+      same = false;
+    }
+  }
+  if (baseline.replayedRunsMs != actual.replayedRunsMs) {
+    printf("  motor on-times changed (%zu runs -> %zu runs)\n",
+           baseline.replayedRunsMs.size(), actual.replayedRunsMs.size());
+    same = false;
+  }
+
+  size_t samples = std::min(baseline.rpmSeries.size(), actual.rpmSeries.size());
+  if (baseline.rpmSeries.size() != actual.rpmSeries.size()) {
+    printf("  RPM series length: %zu -> %zu samples\n", baseline.rpmSeries.size(), actual.rpmSeries.size());
+    same = false;
+  }
+  size_t differing = 0;
+  size_t worst = 0;
+  double worstDiff = 0.0;
+  for (size_t i = 0; i < samples; i++) {
+    double diff = fabs(actual.rpmSeries[i] - baseline.rpmSeries[i]);
+    if (diff <= rpmTolerance) continue;
+    if (diff > worstDiff) {
+      worstDiff = diff;
+      worst = i;
+    }
+    differing++;
+  }
+  if (differing > 0) {
+    printf("  RPM series: %zu of %zu samples differ by more than %.1f, worst at %lu ms: %.1f -> %.1f\n",
+           differing, samples, rpmTolerance, (unsigned long)(worst * SERIES_STEP_MS),
+           baseline.rpmSeries[worst], actual.rpmSeries[worst]);
+    same = false;
+  }
+  return same;
+}
+
+void TraceReplay::print(const Result& result) {
+  printf("  signals accepted: %lu\n", result.signals);
+  if (result.testStarted) {
+    printf("  target times (ms): %lu %lu %lu %lu\n", result.targetTimes[0], result.targetTimes[1],
+           result.targetTimes[2], result.targetTimes[3]);
+  }
+
+  // On-times are how long the controller kept the motor driven, i.e. the
+  // device's and the replay's time to each target
+  size_t runs = std::max(result.recordedRunsMs.size(), result.replayedRunsMs.size());
+  for (size_t i = 0; i < runs; i++) {
+    printf("  motor run %zu: device ", i + 1);
+    if (i < result.recordedRunsMs.size()) printf("%lu ms", result.recordedRunsMs[i]);
+    else printf("-");
+    printf(", replay ");
+    if (i < result.replayedRunsMs.size()) printf("%lu ms\n", result.replayedRunsMs[i]);
+    else printf("-\n");
+  }
+  printf("  RPM series: %zu samples\n", result.rpmSeries.size());
+}
+
+#endif
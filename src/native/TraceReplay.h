@@ -0,0 +1,55 @@
+#ifndef MOTOR_TESTER_TRACE_REPLAY_H
+#define MOTOR_TESTER_TRACE_REPLAY_H
+
+#include "../EdgeTrace.h"
+#include "../Channels.h"
+
+#include <string>
+#include <vector>
+
+// Host-side replay of EdgeTrace files. Recorded interrupts are re-fired at
+// their original times on the simulated sensor pin of a single channel (the
+// trace's channel number is informational), so RPMCounter's ISR and
+// update() and MotorController's acceleration test run exactly as they did
+// on the device (with the trace's configuration). The result - RPM series,
+// signal count and test results - can be saved as a baseline and compared
+// after a firmware change.
+class TraceReplay {
+  public:
+    static const uint32_t SERIES_STEP_MS = 10; // RPM series sample period
+
+    struct Trace {
+      TesterConfig config;
+      std::vector<TraceEvent> events; // Times relative to capture start
+      unsigned long dropped;
+      uint8_t channel;                // Channel the capture came from
+      uint16_t version;               // Format version of the file
+    };
+
+    // Version 3 added the estimator, early-abort and supply fields to the
+    // config lines; older traces replay with their defaults
+    static const uint16_t FULL_CONFIG_VERSION = 3;
+
+    struct Result {
+      unsigned long signals;
+      bool testStarted;
+      unsigned long targetTimes[4];               // MotorController results at the end of the trace
+      std::vector<unsigned long> recordedRunsMs;  // PWM on-times captured on the device
+      std::vector<unsigned long> replayedRunsMs;  // PWM on-times of the replayed controller
+      std::vector<float> rpmSeries;               // getCurrentRPM() every SERIES_STEP_MS
+    };
+
+    static bool loadTrace(const char* path, Trace& trace, std::string& error);
+    static bool saveTrace(const char* path); // Current EdgeTrace buffer
+
+    static bool replay(const Trace& trace, const ChannelPins& pins, Result& result, std::string& error);
+
+    static bool loadResult(const char* path, Result& result, std::string& error);
+    static bool saveResult(const char* path, const Result& result);
+
+    // Prints every difference; true if the results match
+    static bool compare(const Result& baseline, const Result& actual, double rpmTolerance);
+    static void print(const Result& result);
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef MOTOR_TESTER_NATIVE_WSTRING_H
+#define MOTOR_TESTER_NATIVE_WSTRING_H
+
+// The subset of the Arduino String class used by the shared JSON builders
+// (ApiJson, Benchmark), so they compile and can be benchmarked on the host.
+// Number formatting follows the Arduino core: integers in base 10, floats
+// with a fixed number of decimals (2 by default).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+class String {
+  public:
+    String() {}
+    String(const char* text) : value(text ? text : "") {}
+    String(const std::string& text) : value(text) {}
+    explicit String(char c) : value(1, c) {}
+    explicit String(int number) : value(std::to_string(number)) {}
+    explicit String(unsigned int number) : value(std::to_string(number)) {}
+    explicit String(long number) : value(std::to_string(number)) {}
+    explicit String(unsigned long number) : value(std::to_string(number)) {}
+    explicit String(unsigned char number) : value(std::to_string(number)) {}
+    explicit String(float number, unsigned int decimals = 2) { formatFloat(number, decimals); }
+    explicit String(double number, unsigned int decimals = 2) { formatFloat(number, decimals); }
+
+    String& operator+=(const String& other) { value += other.value; return *this; }
+    String& operator+=(const char* text) { value += text; return *this; }
+    String& operator+=(char c) { value += c; return *this; }
+
+    const char* c_str() const { return value.c_str(); }
+    unsigned int length() const { return (unsigned int)value.length(); }
+    bool reserve(unsigned int size) { value.reserve(size); return true; }
+    long toInt() const { return strtol(value.c_str(), nullptr, 10); }
+
+    bool operator==(const String& other) const { return value == other.value; }
+    bool operator==(const char* text) const { return value == text; }
+
+  private:
+    std::string value;
+
+    void formatFloat(double number, unsigned int decimals) {
+      char buffer[48];
+      snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, number);
+      value = buffer;
+    }
+};
+
+inline String operator+(const String& left, const String& right) { String result(left); result += right; return result; }
+inline String operator+(const String& left, const char* right) { String result(left); result += right; return result; }
+inline String operator+(const char* left, const String& right) { String result(left); result += right; return result; }
+inline String operator+(const String& left, char right) { String result(left); result += right; return result; }
+
+#endif
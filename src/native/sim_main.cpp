@@ -0,0 +1,1188 @@
+// Native simulation runner: drives the real RPMCounter / MotorController /
+// Scheduler code against simulated sensor edges on the host.
+//
+//   pio run -e native && .pio/build/native/program [-v] [options] [scenario...]
+//   .pio/build/native/program replay [-v] [--update] [--tolerance RPM] trace...
+//   .pio/build/native/program bench [--iterations N] [--json FILE] [--baseline FILE] [--threshold PCT]
+//   .pio/build/native/program receive [--port P] [--out FILE] [--packets N] [--seconds S]
+//
+// Plant / sensor options (motor scenarios):
+//   --supply V          supply voltage (default 8.4)
+//   --inductance H      winding inductance, > 0 selects the second-order model
+//   --jitter US         edge timing noise, standard deviation
+//   --reflections P     probability of a spurious pulse per revolution
+//   --aperture PH:SCALE extra disc aperture at phase PH with SCALE x pulse width
+//   --trace DIR         write each scenario's edge trace to DIR/<scenario>.trace
+//
+// replay feeds captured edge traces (/api/trace) through RPMCounter and
+// MotorController. Each X.trace is compared with X.expected next to it;
+// --update (re)writes the expected results instead.
+//
+// bench runs the hot-path micro-benchmarks (src/Benchmark.h) on the host,
+// optionally writes the results as JSON and fails if any benchmark's
+// minimum got more than PCT percent (default 25) slower than the baseline.
+//
+// receive is the reference receiver for the device's UDP telemetry
+// (/api/telemetry/start): it listens on port P (default 4210) and writes
+// every interval sample to FILE as CSV (stdout without --out) until N
+// packets or S seconds have arrived, or Ctrl-C.
+//
+// Every scenario prints its measurements and the process exits non-zero
+// if any result falls outside its expected range.
+
+#ifndef ARDUINO
+
+#include "../Hal.h"
+#include "../Channels.h"
+#include "../Scheduler.h"
+#include "../ConfigStore.h"
+#include "../Logger.h"
+#include "Simulation.h"
+#include "SimEncoder.h"
+#include "MotorModel.h"
+#include "SimEdgeCapture.h"
+#include "TraceReplay.h"
+#include "TelemetryReceiver.h"
+#include "../Benchmark.h"
+#include "../UdpTelemetry.h"
+#include "../Endurance.h"
+#include "../Vibration.h"
+#include "../SupplyMonitor.h"
+
+#include <chrono>
+#include <math.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <vector>
+
+namespace {
+  // Same wiring as main.cpp
+  const ChannelPins CHANNEL_PINS[] = {
+    {D4, {D1, D2, D3}},
+    {D5, {D6, D7, D8}},
+  };
+
+  SimEncoder encoder(CHANNEL_PINS[0].sensor);
+  SimEdgeCapture hardwareCapture;
+  MotorModel motor(CHANNEL_PINS[0].motor.in1, CHANNEL_PINS[0].motor.in2, CHANNEL_PINS[0].motor.enable);
+  // Channel 1, used by the parallel scenario only
+  SimEncoder secondEncoder(CHANNEL_PINS[1].sensor);
+  MotorModel secondMotor(CHANNEL_PINS[1].motor.in1, CHANNEL_PINS[1].motor.in2, CHANNEL_PINS[1].motor.enable);
+  bool failed = false;
+
+  // Single-channel scenarios run on channel 0
+  RPMCounter& counter() {
+    return Channels::get(0).rpm;
+  }
+
+  MotorController& controller() {
+    return Channels::get(0).motor;
+  }
+
+  // Command line overrides for the motor scenarios
+  struct PlantOptions {
+    double supplyVolts;
+    double inductanceHenry;
+    bool faultsGiven;
+    SimEncoder::Faults faults;
+    uint8_t apertureCount;
+    double aperturePhase[SimEncoder::MAX_APERTURES];
+    double apertureScale[SimEncoder::MAX_APERTURES];
+  };
+
+  PlantOptions options = {MotorModel::defaults().supplyVolts, 0.0, false, {0.0, 0.0, 200, 1}, 0, {0}, {0}};
+  const char* traceDirectory = nullptr;
+
+  void runFor(uint64_t durationUs) {
+    uint64_t end = Sim::now() + durationUs;
+    while (Sim::now() < end) {
+      Scheduler::run();
+    }
+  }
+
+  void expectNear(const char* what, double actual, double expected, double tolerance) {
+    bool ok = fabs(actual - expected) <= tolerance;
+    printf("  %-40s %12.2f  (expected %.2f +/- %.2f)%s\n",
+           what, actual, expected, tolerance, ok ? "" : "  <-- FAIL");
+    if (!ok) failed = true;
+  }
+
+  void startScenario(const char* name) {
+    printf("%s\n", name);
+    Sim::clearScheduledInputs();
+    encoder.setSpeedSource(nullptr, nullptr);
+    encoder.setFaults(SimEncoder::Faults{0.0, 0.0, 200, 1});
+    encoder.clearExtraApertures();
+    // Where the last scenario left the disc shifts every first pulse
+    encoder.resetPosition();
+    Channels::begin(CHANNEL_PINS, 1);
+    runFor(3000000); // Let the previous scenario's readings go stale
+  }
+
+  // Constant speed: the reading must match the scripted interval exactly
+  void scenarioSteady() {
+    startScenario("steady: 12000 RPM for 2 s");
+    uint64_t start = Sim::now();
+    encoder.addConstantSpeed(start, start + 2000000, 12000.0);
+    runFor(1900000);
+    expectNear("RPM", counter().getCurrentRPM(), 12000.0, 1.0);
+    expectNear("interval (us)", counter().getTimeBetweenSignals(), 5000.0, 1.0);
+  }
+
+  // Short glitches between the real pulses must be filtered out by the ISR
+  void scenarioGlitches() {
+    startScenario("glitches: 12000 RPM with a 100us reflection every revolution");
+    uint64_t start = Sim::now();
+    unsigned long countBefore = counter().getSignalCount();
+    encoder.addConstantSpeed(start, start + 1000000, 12000.0);
+    for (uint64_t t = start + 2500; t < start + 1000000; t += 5000) {
+      encoder.addPulse(t, 100);
+    }
+    runFor(1000000);
+    expectNear("RPM", counter().getCurrentRPM(), 12000.0, 1.0);
+    expectNear("accepted signals", counter().getSignalCount() - countBefore, 200.0, 1.0);
+  }
+
+  // One sensor fault per ISR reject reason, each counted under its own
+  // reason, plus a second aperture that passes the width filter and then
+  // crowds out the real pulses through the consistency check. The
+  // histograms must show every pulse, accepted or not.
+  void scenarioSensorDiagnostics() {
+    startScenario("sensor-diagnostics: one fault per reject reason at 12000 RPM");
+    const SensorDiagnostics& diagnostics = counter().getDiagnostics();
+    expectNear("clean before any pulse", diagnostics.isClean(), 0.0, 0.0);
+
+    // 1 s, 200 revolutions: a 100 us reflection mid-interval in each, a
+    // 1450 us pulse in every 4th and, in every 4th other, a 100 us pulse 5 us
+    // after the real one ends (its rising edge falls in the debounce time)
+    uint64_t start = Sim::now();
+    encoder.addConstantSpeed(start, start + 1000000, 12000.0);
+    for (int i = 0; i < 200; i++) {
+      uint64_t revolution = start + i * 5000;
+      encoder.addPulse(revolution + 2500, 100);
+      if (i % 4 == 1) encoder.addPulse(revolution + 3100, 1450);
+      if (i % 4 == 3) encoder.addPulse(revolution + 1005, 100);
+    }
+    runFor(1000000);
+    expectNear("clean with faults", diagnostics.isClean(), 0.0, 0.0);
+    expectNear("RPM", counter().getCurrentRPM(), 12000.0, 1.0);
+    expectNear("accepted", diagnostics.getAcceptedCount(), 200.0, 0.0);
+    expectNear("rejected: too short", diagnostics.getRejectedCount(SensorDiagnostics::REJECT_TOO_SHORT), 200.0, 0.0);
+    expectNear("rejected: too long", diagnostics.getRejectedCount(SensorDiagnostics::REJECT_TOO_LONG), 50.0, 0.0);
+    expectNear("rejected: debounce", diagnostics.getRejectedCount(SensorDiagnostics::REJECT_DEBOUNCE), 50.0, 0.0);
+    expectNear("rejected: no rising edge", diagnostics.getRejectedCount(SensorDiagnostics::REJECT_NO_RISING_EDGE), 50.0, 0.0);
+    expectNear("rejected: inconsistent", diagnostics.getRejectedCount(SensorDiagnostics::REJECT_INCONSISTENT), 0.0, 0.0);
+    expectNear("width 1000 us", diagnostics.getWidthCount(SensorDiagnostics::binOf(1000)), 200.0, 0.0);
+    expectNear("width 100 us", diagnostics.getWidthCount(SensorDiagnostics::binOf(100)), 200.0, 0.0);
+    expectNear("width 1450 us", diagnostics.getWidthCount(SensorDiagnostics::binOf(1450)), 50.0, 0.0);
+    // Real pulse to reflection, and reflection to the next real pulse
+    // unless the long pulse is in between
+    expectNear("interval 2500 us", diagnostics.getIntervalCount(SensorDiagnostics::binOf(2500)), 349.0, 0.0);
+
+    // 0.5 s with a second 650 us aperture half a revolution on
+    counter().clearDiagnostics();
+    start = Sim::now();
+    encoder.addConstantSpeed(start, start + 500000, 12000.0);
+    for (int i = 0; i < 100; i++) {
+      encoder.addPulse(start + i * 5000 + 2500, 650);
+    }
+    runFor(500000);
+    expectNear("accepted", diagnostics.getAcceptedCount(), 101.0, 0.0);
+    expectNear("rejected: inconsistent", diagnostics.getRejectedCount(SensorDiagnostics::REJECT_INCONSISTENT), 99.0, 0.0);
+    expectNear("width 650 us", diagnostics.getWidthCount(SensorDiagnostics::binOf(650)), 100.0, 0.0);
+
+    // A clean run after a clear. The consistency check still expects the
+    // aperture's width until the counter is reset, as every test does.
+    counter().reset();
+    counter().clearDiagnostics();
+    start = Sim::now();
+    encoder.addConstantSpeed(start, start + 500000, 12000.0);
+    runFor(500000);
+    expectNear("clean sensor", diagnostics.isClean(), 1.0, 0.0);
+    expectNear("rejected", diagnostics.getTotalRejected(), 0.0, 0.0);
+    expectNear("interval 5000 us", diagnostics.getIntervalCount(SensorDiagnostics::binOf(5000)), 99.0, 1.0);
+  }
+
+  // Readings go to zero once signals stop
+  void scenarioStall() {
+    startScenario("stall: 12000 RPM, then no signals");
+    uint64_t start = Sim::now();
+    encoder.addConstantSpeed(start, start + 500000, 12000.0);
+    runFor(500000);
+    expectNear("RPM while spinning", counter().getCurrentRPM(), 12000.0, 1.0);
+    runFor(2500000);
+    expectNear("RPM after 2.5 s without signals", counter().getCurrentRPM(), 0.0, 0.0);
+  }
+
+  // Idealised motor: accelerates linearly at 10000 RPM/s while PWM is applied
+  struct RampPlant {
+    uint64_t onSince;
+    bool on;
+  };
+
+  double rampSpeed(uint64_t nowUs, void* context) {
+    RampPlant* plant = static_cast<RampPlant*>(context);
+    bool on = Sim::getPwm(CHANNEL_PINS[0].motor.enable) > 0;
+    if (on && !plant->on) plant->onSince = nowUs;
+    plant->on = on;
+    if (!on) return 0.0;
+    double rpm = 10000.0 * (nowUs - plant->onSince) / 1000000.0;
+    return rpm < 25000.0 ? rpm : 25000.0;
+  }
+
+  // Full acceleration state machine against the ramp plant: the time to each
+  // target is target / 10000 RPM/s
+  void scenarioAccelerationTest() {
+    startScenario("acceleration test: linear 10000 RPM/s plant");
+    RampPlant plant = {0, false};
+    encoder.setSpeedSource(rampSpeed, &plant);
+
+    controller().startAccelerationTest();
+    uint64_t start = Sim::now();
+    while (controller().isAccelerationTestRunning() && Sim::now() - start < 60000000) {
+      Scheduler::run();
+    }
+    encoder.setSpeedSource(nullptr, nullptr);
+
+    const TesterConfig& config = ConfigStore::get();
+    for (int i = 0; i < 4; i++) {
+      char label[48];
+      snprintf(label, sizeof(label), "time to %lu RPM (ms)", (unsigned long)config.rpmTargets[i]);
+      expectNear(label, controller().getTargetTime(i), config.rpmTargets[i] / 10.0, 10.0);
+    }
+    printf("  simulated %.1f s\n", (Sim::now() - start) / 1000000.0);
+  }
+
+  struct ErrorStats {
+    unsigned long samples;
+    double sum;
+    double sumSquares;
+    double max;
+  };
+
+  void addSample(ErrorStats& stats, double error) {
+    stats.samples++;
+    stats.sum += error;
+    stats.sumSquares += error * error;
+    if (fabs(error) > stats.max) stats.max = fabs(error);
+  }
+
+  // Every accepted interval of 1 s at 12000 RPM against the true 5000 us,
+  // with up to 40 us of interrupt latency
+  double measureLatencyJitter(const char* backend) {
+    Sim::setInterruptLatency(40, 11);
+    unsigned long cursor = counter().getSignalCount();
+    uint64_t start = Sim::now();
+    encoder.addConstantSpeed(start, start + 1000000, 12000.0);
+
+    uint32_t times[RPMCounter::PULSE_HISTORY];
+    unsigned long lost = 0;
+    ErrorStats error = {0, 0.0, 0.0, 0.0};
+    uint32_t previous = 0;
+    bool havePrevious = false;
+    while (Sim::now() - start < 1000000) {
+      runFor(50000); // The history holds 64 pulses, 320 ms at this speed
+      uint8_t count;
+      while ((count = counter().readPulses(cursor, times, RPMCounter::PULSE_HISTORY, lost)) > 0) {
+        for (uint8_t i = 0; i < count; i++) {
+          if (havePrevious) addSample(error, (double)(times[i] - previous) - 5000.0);
+          previous = times[i];
+          havePrevious = true;
+        }
+      }
+    }
+    Sim::setInterruptLatency(0, 1);
+
+    printf("  %s: interval error max %.0f us, rms %.1f us over %lu intervals (%lu lost)\n", backend,
+           error.max, sqrt(error.sumSquares / error.samples), error.samples, lost);
+    expectNear("intervals", error.samples, 199.0, 0.0);
+    return error.max;
+  }
+
+  // The same sensor through a GPIO interrupt and through a capture unit
+  // (SimEdgeCapture, standing in for the ESP32's MCPWM capture), with
+  // interrupt latency: only the interrupt backend sees it as edge jitter.
+  // Then the acceleration sequence through the capture backend.
+  void scenarioCapture() {
+    startScenario("capture: GPIO interrupt vs hardware capture, 0-40 us interrupt latency");
+    double gpioMax = measureLatencyJitter(Channels::getCapture().getName());
+    expectNear("gpio interval error within latency (us)", gpioMax, 20.0, 20.0);
+    if (gpioMax < 10.0) {
+      printf("  latency not visible through the GPIO backend  <-- FAIL\n");
+      failed = true;
+    }
+
+    Channels::begin(CHANNEL_PINS, 1, hardwareCapture);
+    runFor(3000000);
+    double captureMax = measureLatencyJitter(Channels::getCapture().getName());
+    expectNear("capture interval error (us)", captureMax, 0.0, 0.0);
+
+    RampPlant plant = {0, false};
+    encoder.setSpeedSource(rampSpeed, &plant);
+    controller().startAccelerationTest();
+    uint64_t start = Sim::now();
+    while (controller().isAccelerationTestRunning() && Sim::now() - start < 60000000) {
+      Scheduler::run();
+    }
+    encoder.setSpeedSource(nullptr, nullptr);
+    const TesterConfig& config = ConfigStore::get();
+    for (int i = 0; i < 4; i++) {
+      char label[48];
+      snprintf(label, sizeof(label), "time to %lu RPM (ms)", (unsigned long)config.rpmTargets[i]);
+      expectNear(label, controller().getTargetTime(i), config.rpmTargets[i] / 10.0, 10.0);
+    }
+    // Back to the default backend for the scenarios after this one
+    Channels::begin(CHANNEL_PINS, 1);
+  }
+
+  // Model parameters from the command line, thresholds at the test targets
+  void setUpMotor(MotorModel& model, double supplyVolts) {
+    MotorModel::Parameters parameters = MotorModel::defaults();
+    parameters.supplyVolts = supplyVolts;
+    parameters.inductanceHenry = options.inductanceHenry;
+    model.setParameters(parameters);
+    model.reset();
+
+    const TesterConfig& config = ConfigStore::get();
+    double targets[4];
+    for (int i = 0; i < 4; i++) targets[i] = config.rpmTargets[i];
+    model.setThresholds(targets, 4);
+  }
+
+  // MotorController::getTargetTime() vs the time the model's true speed
+  // crossed each target
+  void checkTargetTimes(const MotorModel& model, const MotorController& controller, double timeTolerance) {
+    const TesterConfig& config = ConfigStore::get();
+    for (int i = 0; i < 4; i++) {
+      char label[48];
+      snprintf(label, sizeof(label), "time to %lu RPM error (ms)", (unsigned long)config.rpmTargets[i]);
+      if (i >= model.getRunCount() || model.getRun(i).crossingUs[i] == 0) {
+        printf("  %-40s  target not reached by the model (max %.0f RPM)\n", label,
+               i < model.getRunCount() ? model.getRun(i).maxRpm : 0.0);
+        if (controller.getTargetTime(i) != 0) failed = true;
+        continue;
+      }
+      const MotorModel::Run& run = model.getRun(i);
+      double trueMs = (run.crossingUs[i] - run.startUs) / 1000.0;
+      printf("  true time to %lu RPM: %.1f ms (from %.0f RPM)\n",
+             (unsigned long)config.rpmTargets[i], trueMs, run.startRpm);
+      expectNear(label, controller.getTargetTime(i) - trueMs, 0.0, timeTolerance);
+    }
+  }
+
+  // MotorController's fitted spin-up models against the model's true final
+  // speed and time constant, and each model's time to the next target
+  // against the model's crossing in the run that followed
+  void checkSpinUpModels(const MotorModel& model, const MotorController& controller) {
+    const TesterConfig& config = ConfigStore::get();
+    double finalRpm = model.getFinalRpm();
+    double tauMs = model.getTimeConstant() * 1000.0;
+    for (int i = 0; i < 4; i++) {
+      const SpinUpModel& fit = controller.getSpinUpModel(i);
+      char label[48];
+      printf("  test %d model: %.0f RPM, tau %lu ms, offset %ld ms, %u samples%s\n", i + 1,
+             fit.finalCentiRpm / 100.0, (unsigned long)fit.tauMs, (long)fit.offsetMs,
+             (unsigned)fit.samples, fit.earlyAbort ? ", early abort" : "");
+      snprintf(label, sizeof(label), "test %d fitted final RPM", i + 1);
+      expectNear(label, fit.finalCentiRpm / 100.0, finalRpm, finalRpm * 0.03);
+      snprintf(label, sizeof(label), "test %d fitted tau (ms)", i + 1);
+      expectNear(label, fit.tauMs, tauMs, tauMs * 0.1);
+      if (i < model.getRunCount() && model.getRun(i).crossingUs[i] != 0) {
+        const MotorModel::Run& run = model.getRun(i);
+        double trueMs = (run.crossingUs[i] - run.startUs) / 1000.0;
+        snprintf(label, sizeof(label), "test %d predicted time error (ms)", i + 1);
+        expectNear(label, SpinUpFit::timeToRpm(fit, config.rpmTargets[i]) - trueMs, 0.0, 50.0);
+      }
+    }
+  }
+
+  // Runs the full acceleration sequence against the DC motor model and
+  // compares the firmware's view with the model's ground truth:
+  //  - estimator error: RPMCounter::getCurrentRPM() vs true speed, sampled
+  //    every 10 ms while the bridge is driving and a reading exists
+  //  - time-to-target error, see checkTargetTimes()
+  void runMotorScenario(const char* name, double timeTolerance) {
+    startScenario(name);
+    setUpMotor(motor, options.supplyVolts);
+
+    Sim::addDevice(&motor);
+    Sim::removeDevice(&encoder); // Keep the encoder stepping after the motor
+    Sim::addDevice(&encoder);
+    encoder.setSpeedSource(MotorModel::speedOf, &motor);
+
+    ErrorStats estimator = {0, 0.0, 0.0, 0.0};
+    controller().startAccelerationTest();
+    uint64_t start = Sim::now();
+    uint64_t nextSample = start;
+    while (controller().isAccelerationTestRunning() && Sim::now() - start < 120000000) {
+      Scheduler::run();
+      if (Sim::now() >= nextSample) {
+        nextSample += 10000;
+        // Each test resets the counter, so skip until its first new reading
+        if (motor.getAppliedVolts() > 0 && counter().getCurrentRPM() > 0) {
+          addSample(estimator, counter().getCurrentRPM() - motor.getRpm());
+        }
+      }
+    }
+    encoder.setSpeedSource(nullptr, nullptr);
+    Sim::removeDevice(&motor);
+
+    if (estimator.samples > 0) {
+      double mean = estimator.sum / estimator.samples;
+      double rms = sqrt(estimator.sumSquares / estimator.samples);
+      printf("  estimator error (RPM): mean %.1f, rms %.1f, max %.1f over %lu samples\n",
+             mean, rms, estimator.max, estimator.samples);
+    }
+
+    checkTargetTimes(motor, controller(), timeTolerance);
+    if (options.inductanceHenry == 0.0) checkSpinUpModels(motor, controller());
+    printf("  simulated %.1f s\n", (Sim::now() - start) / 1000000.0);
+  }
+
+  void scenarioMotor() {
+    runMotorScenario("motor: DC motor + L298N model, clean sensor", 10.0);
+  }
+
+  // The faults the ISR's length filter and consistency check exist for
+  void scenarioMotorNoisy() {
+    if (options.faultsGiven) {
+      encoder.setFaults(options.faults);
+      for (uint8_t i = 0; i < options.apertureCount; i++) {
+        encoder.addAperture(options.aperturePhase[i], options.apertureScale[i]);
+      }
+    }
+    runMotorScenario("motor-noisy: jitter, reflections and a second aperture", 15.0);
+  }
+
+  // A motor that can't reach any target (5 V supply, levels off near 10500
+  // RPM). The spin-up fit must end the first test early and skip the rest
+  // instead of waiting for four timeouts.
+  void scenarioWeakMotor() {
+    startScenario("weak-motor: 5 V supply, every target out of reach");
+    setUpMotor(motor, 5.0);
+    Sim::addDevice(&motor);
+    Sim::removeDevice(&encoder); // Keep the encoder stepping after the motor
+    Sim::addDevice(&encoder);
+    encoder.setSpeedSource(MotorModel::speedOf, &motor);
+
+    controller().startAccelerationTest();
+    uint64_t start = Sim::now();
+    while (controller().isAccelerationTestRunning() && Sim::now() - start < 120000000) {
+      Scheduler::run();
+    }
+    encoder.setSpeedSource(nullptr, nullptr);
+    Sim::removeDevice(&motor);
+
+    const TesterConfig& config = ConfigStore::get();
+    double sequenceSeconds = (Sim::now() - start) / 1000000.0;
+    double fullSeconds = 4 * (config.pauseMs + config.timeoutMs) / 1000.0;
+    printf("  sequence took %.1f s (%.1f s with timeouts)\n", sequenceSeconds, fullSeconds);
+    expectNear("sequence time (s)", sequenceSeconds, config.pauseMs / 1000.0 + 1.0, 1.0);
+    expectNear("motor runs", motor.getRunCount(), 1.0, 0.0);
+    for (int i = 0; i < 4; i++) {
+      if (controller().getTargetTime(i) != 0 || !controller().getSpinUpModel(i).earlyAbort) {
+        printf("  test %d not marked failed by early abort  <-- FAIL\n", i + 1);
+        failed = true;
+      }
+    }
+    const SpinUpModel& fit = controller().getSpinUpModel(0);
+    expectNear("fitted final RPM", fit.finalCentiRpm / 100.0, motor.getFinalRpm(), motor.getFinalRpm() * 0.05);
+    expectNear("fitted tau (ms)", fit.tauMs, motor.getTimeConstant() * 1000.0, motor.getTimeConstant() * 1000.0 * 0.15);
+  }
+
+  // A0 through the divider the config describes, from the model's sagging
+  // supply terminals
+  int supplyReading(uint64_t, void* context) {
+    const MotorModel* model = static_cast<const MotorModel*>(context);
+    return (int)lround(model->getSupplyVolts() * 1000.0 * 1023.0 / ConfigStore::get().supplyFullScaleMv);
+  }
+
+  struct SupplyRun {
+    unsigned long targetTimes[4];
+    unsigned long normalizedTimes[4];
+  };
+
+  // One full sequence on a supply with internal resistance. Test 1's
+  // reported supply statistics must match the terminal voltage the model
+  // had while it ran.
+  SupplyRun runSupplySequence(double supplyVolts, double resistanceOhms) {
+    // Both packs start from the same disc position
+    encoder.resetPosition();
+    setUpMotor(motor, supplyVolts);
+    MotorModel::Parameters parameters = motor.getParameters();
+    parameters.supplyResistanceOhms = resistanceOhms;
+    motor.setParameters(parameters);
+    Sim::addDevice(&motor);
+    Sim::removeDevice(&encoder); // Keep the encoder stepping after the motor
+    Sim::addDevice(&encoder);
+    encoder.setSpeedSource(MotorModel::speedOf, &motor);
+    Sim::setAnalogSource(supplyReading, &motor);
+
+    // Terminal voltage every ms while driving, kept until the run's
+    // boundaries are known
+    std::vector<std::pair<uint64_t, double>> truth;
+    controller().startAccelerationTest();
+    uint64_t start = Sim::now();
+    uint64_t nextSample = start;
+    while (controller().isAccelerationTestRunning() && Sim::now() - start < 120000000) {
+      Scheduler::run();
+      if (Sim::now() < nextSample) continue;
+      nextSample += 1000;
+      if (motor.getAppliedVolts() > 0) truth.push_back(std::make_pair(Sim::now(), motor.getSupplyVolts()));
+    }
+    encoder.setSpeedSource(nullptr, nullptr);
+    Sim::setAnalogSource(nullptr, nullptr);
+    Sim::removeDevice(&motor);
+
+    SupplyRun result;
+    for (int i = 0; i < 4; i++) {
+      result.targetTimes[i] = controller().getTargetTime(i);
+      result.normalizedTimes[i] = controller().getNormalizedTargetTime(i);
+    }
+
+    double sum = 0.0;
+    double minimum = supplyVolts;
+    unsigned long samples = 0;
+    if (motor.getRunCount() > 0 && motor.getRun(0).crossingUs[0] != 0) {
+      const MotorModel::Run& run = motor.getRun(0);
+      for (size_t i = 0; i < truth.size(); i++) {
+        if (truth[i].first < run.startUs || truth[i].first > run.crossingUs[0]) continue;
+        sum += truth[i].second;
+        if (truth[i].second < minimum) minimum = truth[i].second;
+        samples++;
+      }
+    }
+    const SupplyStats& stats = controller().getTestSupply(0);
+    printf("  %.1f V, %.2f ohm: test 1 supply mean %u mV, min %u mV over %u samples\n",
+           supplyVolts, resistanceOhms, (unsigned)stats.meanMv, (unsigned)stats.minMv, (unsigned)stats.samples);
+    if (samples == 0) {
+      printf("  test 1 not reached by the model  <-- FAIL\n");
+      failed = true;
+      return result;
+    }
+    // 10 ms sampling against the 1 ms truth, and 11 mV per ADC step
+    expectNear("test 1 mean supply (mV)", stats.meanMv, sum / samples * 1000.0, 30.0);
+    expectNear("test 1 min supply (mV)", stats.minMv, minimum * 1000.0, 50.0);
+    return result;
+  }
+
+  // The same motor on a full and a half-discharged 2S pack with 50 mOhm
+  // internal resistance. The raw times differ; normalized to the nominal
+  // supply they must agree.
+  void scenarioSupply() {
+    startScenario("supply: 8.4 V and 7.4 V packs with internal resistance, times normalized");
+    setUpMotor(motor, MotorModel::defaults().supplyVolts);
+    TesterConfig config = ConfigStore::get();
+    config.supplyFullScaleMv = 11000;
+    config.stallSupplyMv = (uint32_t)lround(motor.getStallVolts() * 1000.0);
+    ConfigStore::apply(config, nullptr);
+
+    SupplyRun full = runSupplySequence(8.4, 0.05);
+    SupplyRun low = runSupplySequence(7.4, 0.05);
+    for (int i = 0; i < 4; i++) {
+      printf("  test %d: %lu / %lu ms raw, %lu / %lu ms normalized\n", i + 1,
+             full.targetTimes[i], low.targetTimes[i], full.normalizedTimes[i], low.normalizedTimes[i]);
+      if (full.normalizedTimes[i] == 0 || low.normalizedTimes[i] == 0) {
+        printf("  test %d not normalized  <-- FAIL\n", i + 1);
+        failed = true;
+        continue;
+      }
+      char label[48];
+      snprintf(label, sizeof(label), "test %d normalized difference (%%)", i + 1);
+      double difference = 100.0 * ((double)low.normalizedTimes[i] - full.normalizedTimes[i]) / full.normalizedTimes[i];
+      expectNear(label, difference, 0.0, 3.0);
+    }
+
+    ConfigStore::apply(ConfigStore::defaults(), nullptr);
+  }
+
+  // Two motors tested at the same time on channels 0 and 1, the second on a
+  // 1 V weaker supply so the two sequences drift apart. Each channel's
+  // results must match its own motor, whatever the other channel does.
+  void scenarioParallel() {
+    startScenario("parallel: two motor models on channels 0 and 1 at once");
+    Channels::begin(CHANNEL_PINS, 2);
+    setUpMotor(motor, options.supplyVolts);
+    setUpMotor(secondMotor, options.supplyVolts - 1.0);
+
+    Sim::addDevice(&motor);
+    Sim::addDevice(&secondMotor);
+    Sim::removeDevice(&encoder); // Encoders step after the motors
+    Sim::addDevice(&encoder);
+    Sim::addDevice(&secondEncoder);
+    encoder.setSpeedSource(MotorModel::speedOf, &motor);
+    secondEncoder.setSpeedSource(MotorModel::speedOf, &secondMotor);
+
+    Channels::get(0).motor.startAccelerationTest();
+    Channels::get(1).motor.startAccelerationTest();
+    uint64_t start = Sim::now();
+    while (Channels::isAnyBusy() && Sim::now() - start < 120000000) {
+      Scheduler::run();
+    }
+    encoder.setSpeedSource(nullptr, nullptr);
+    secondEncoder.setSpeedSource(nullptr, nullptr);
+    Sim::removeDevice(&secondEncoder);
+    Sim::removeDevice(&secondMotor);
+    Sim::removeDevice(&motor);
+
+    printf("  channel 0 (%.1f V)\n", options.supplyVolts);
+    checkTargetTimes(motor, Channels::get(0).motor, 10.0);
+    printf("  channel 1 (%.1f V)\n", options.supplyVolts - 1.0);
+    checkTargetTimes(secondMotor, Channels::get(1).motor, 10.0);
+    printf("  simulated %.1f s\n", (Sim::now() - start) / 1000000.0);
+  }
+
+  // UDP telemetry over localhost during a motor test: every packet must
+  // arrive in sequence and every accepted pulse after the first must arrive
+  // as an interval sample
+  void scenarioTelemetry() {
+    startScenario("telemetry: UDP stream to a localhost receiver during a motor test");
+    TelemetryReceiver receiver;
+    std::string error;
+    if (!receiver.open(0, error)) {
+      printf("  %s  <-- FAIL\n", error.c_str());
+      failed = true;
+      return;
+    }
+
+    setUpMotor(motor, options.supplyVolts);
+    Sim::addDevice(&motor);
+    Sim::removeDevice(&encoder); // Keep the encoder stepping after the motor
+    Sim::addDevice(&encoder);
+    encoder.setSpeedSource(MotorModel::speedOf, &motor);
+
+    const uint8_t localhost[4] = {127, 0, 0, 1};
+    UdpTelemetry::start(localhost, receiver.getPort(), UdpTelemetry::DEFAULT_RATE_HZ);
+    unsigned long pulsesBefore = counter().getSignalCount();
+    controller().startAccelerationTest();
+    uint64_t start = Sim::now();
+    while (controller().isAccelerationTestRunning() && Sim::now() - start < 120000000) {
+      Scheduler::run();
+      receiver.poll(0);
+    }
+    // Silence the sensor, then let the last pulses go out with the next packets
+    encoder.setSpeedSource(nullptr, nullptr);
+    Sim::removeDevice(&motor);
+    runFor(100000);
+    UdpTelemetry::stop();
+    receiver.poll(100);
+
+    const TelemetryReceiver::Stats& stats = receiver.getStats();
+    unsigned long pulses = counter().getSignalCount() - pulsesBefore;
+    expectNear("packets received", stats.packets, UdpTelemetry::getPacketsSent(), 0.0);
+    expectNear("packets expected at 100 Hz", stats.packets, (Sim::now() - start) / 10000.0, 2.0);
+    expectNear("invalid packets", stats.invalid, 0.0, 0.0);
+    expectNear("missing packets", stats.missingPackets, 0.0, 0.0);
+    expectNear("lost samples", stats.lostSamples, 0.0, 0.0);
+    expectNear("interval samples", stats.samples, pulses > 0 ? pulses - 1 : 0, 0.0);
+    printf("  simulated %.1f s\n", (Sim::now() - start) / 1000000.0);
+  }
+
+  // Endurance profile: 12000 RPM that sags to 11000 after 20 minutes, like
+  // a bearing starting to fail
+  double enduranceSpeed(uint64_t nowUs, void* context) {
+    uint64_t start = *(const uint64_t*)context;
+    return nowUs - start < 1200000000ULL ? 12000.0 : 11000.0;
+  }
+
+  // 25 minute burn-in: every archive must hold the right buckets, each
+  // rejected reflection must land in a bucket, and the archives must come
+  // back unchanged from flash after a reboot
+  void scenarioEndurance() {
+    startScenario("endurance: 25 min at 12000 RPM sagging to 11000, archived and restored");
+    static uint64_t start;
+    start = Sim::now();
+    encoder.setFaults(SimEncoder::Faults{0.0, 0.2, 200, 1});
+    encoder.setSpeedSource(enduranceSpeed, &start);
+    unsigned long rejectedBefore = counter().getRejectedCount();
+    Endurance::start(0, 50, 25, nullptr);
+    runFor(25ULL * 60 * 1000000 + 200000);
+    unsigned long rejected = counter().getRejectedCount() - rejectedBefore;
+    encoder.setSpeedSource(nullptr, nullptr);
+
+    expectNear("run ended after its duration", Endurance::isActive() ? 1 : 0, 0.0, 0.0);
+    expectNear("run seconds", Endurance::getRunSeconds(), 1500.0, 0.0);
+    expectNear("1 s buckets kept", Endurance::getFilled(0), ENDURANCE_FINE_BUCKETS, 0.0);
+    expectNear("1 min buckets", Endurance::getFilled(1), 25.0, 0.0);
+    expectNear("10 min buckets", Endurance::getFilled(2), 2.0, 0.0);
+    expectNear("lost pulses", Endurance::getLostPulses(), 0.0, 0.0);
+
+    EnduranceBucket bucket = {0, 0, 0, 0};
+    Endurance::getBucket(1, 10, bucket);
+    expectNear("minute 10 mean RPM", bucket.meanRpm, 12000.0, 1.0);
+    expectNear("minute 10 min RPM", bucket.minRpm, 12000.0, 1.0);
+    Endurance::getBucket(1, 22, bucket);
+    expectNear("minute 22 mean RPM", bucket.meanRpm, 11000.0, 1.0);
+    expectNear("minute 22 max RPM", bucket.maxRpm, 11000.0, 3.0);
+    Endurance::getBucket(2, 1, bucket);
+    expectNear("10-20 min mean RPM", bucket.meanRpm, 12000.0, 1.0);
+    Endurance::getBucket(0, Endurance::getClosedCount(0) - 1, bucket);
+    expectNear("last second mean RPM", bucket.meanRpm, 11000.0, 1.0);
+
+    // Reflections outside the last (unfinished) second all land in a bucket
+    unsigned long archived = 0;
+    for (uint32_t i = 0; i < Endurance::getClosedCount(1); i++) {
+      if (Endurance::getBucket(1, i, bucket)) archived += bucket.rejected;
+    }
+    expectNear("rejected pulses archived", archived, rejected, 80.0);
+
+    // Clear the RAM archives with a new run, then "reboot"
+    EnduranceBucket saved;
+    Endurance::getBucket(1, 22, saved);
+    Endurance::start(0, 50, 0, nullptr);
+    Endurance::begin();
+    Endurance::getBucket(1, 22, bucket);
+    expectNear("restored from flash", Endurance::isRestored() ? 1 : 0, 1.0, 0.0);
+    expectNear("restored 1 min buckets", Endurance::getFilled(1), 25.0, 0.0);
+    expectNear("restored bucket matches", memcmp(&bucket, &saved, sizeof(bucket)) == 0 ? 1 : 0, 1.0, 0.0);
+
+    // The final save of a run stopped during an acceleration test waits for
+    // the test to end, so it doesn't stall the test's timing
+    Endurance::start(0, 50, 0, nullptr);
+    runFor(2000000);
+    unsigned long saves = Endurance::getSaveCount();
+    controller().startAccelerationTest();
+    Endurance::stop();
+    runFor(500000);
+    expectNear("save held back during a test", Endurance::getSaveCount() - saves, 0.0, 0.0);
+    Channels::stopAll();
+    runFor(500000);
+    expectNear("saved once the test ended", Endurance::getSaveCount() - saves, 1.0, 0.0);
+  }
+
+  // 12000 RPM with a 0.2 % speed ripple at 50 Hz, i.e. once every fourth
+  // revolution (order 0.25)
+  double rippleSpeed(uint64_t nowUs, void*) {
+    return 12000.0 * (1.0 + 0.002 * sin(2.0 * M_PI * 50.0 * nowUs / 1000000.0));
+  }
+
+  // The ripple must show up as the dominant spectrum line with the right
+  // amplitude. Each interval averages the ripple over a quarter period, so
+  // its amplitude is 5000 us * 0.002 * sin(pi/4) / (pi/4) = 9.0 us.
+  void scenarioVibration() {
+    startScenario("vibration: 12000 RPM with a 0.2% speed ripple every fourth revolution");
+    Vibration::begin();
+    encoder.setSpeedSource(rippleSpeed, nullptr);
+    runFor(3000000);
+    encoder.setSpeedSource(nullptr, nullptr);
+
+    const double rippleNs = 5000000.0 * 0.002 * sin(M_PI / 4) / (M_PI / 4);
+    const VibrationResult& result = Vibration::getResult(0);
+    expectNear("windows analysed", Vibration::getWindowCount(0), 4.0, 1.0);
+    expectNear("mean RPM", result.centiRpm / 100.0, 12000.0, 1.0);
+    expectNear("dominant bin (order x 128)", result.peaks[0].bin, Vibration::WINDOW / 4, 0.0);
+    expectNear("ripple amplitude (ns)", result.peaks[0].amplitudeNs, rippleNs, rippleNs * 0.05);
+    expectNear("jitter RMS (ns)", result.jitterRmsNs, rippleNs / sqrt(2.0), rippleNs * 0.05);
+    expectNear("cycle-to-cycle jitter RMS (ns)", result.cycleJitterRmsNs, rippleNs, rippleNs * 0.05);
+    expectNear("next strongest line (ns)", result.peaks[1].amplitudeNs, 0.0, rippleNs * 0.1);
+  }
+
+  // Free spin-up of the motor model with 15 us edge jitter. The estimator
+  // must track the true speed more closely than the raw interval reading,
+  // follow the true acceleration and give the model's peak torque.
+  void scenarioEstimator() {
+    startScenario("estimator: spin-up at 100% with 15us edge jitter");
+    TesterConfig config = ConfigStore::get();
+    config.rotorInertiaGcm2 = (uint32_t)(MotorModel::defaults().inertia * 1e7 + 0.5);
+    ConfigStore::apply(config, nullptr);
+    counter().reset();
+
+    setUpMotor(motor, MotorModel::defaults().supplyVolts);
+    Sim::addDevice(&motor);
+    Sim::removeDevice(&encoder); // Keep the encoder stepping after the motor
+    Sim::addDevice(&encoder);
+    encoder.setSpeedSource(MotorModel::speedOf, &motor);
+    encoder.setFaults(SimEncoder::Faults{15.0, 0.0, 200, 7});
+
+    ErrorStats raw = {0, 0.0, 0.0, 0.0};
+    ErrorStats smoothed = {0, 0.0, 0.0, 0.0};
+    ErrorStats acceleration = {0, 0.0, 0.0, 0.0};
+    double peakAcceleration = 0.0;
+    double previousRpm = motor.getRpm();
+    controller().setSpeed(100);
+    uint64_t start = Sim::now();
+    uint64_t nextSample = start + 10000;
+    while (Sim::now() - start < 3000000) {
+      Scheduler::run();
+      if (Sim::now() < nextSample) continue;
+      nextSample += 10000;
+      // True acceleration over the last 10 ms, good enough for a smooth plant
+      double trueRpm = motor.getRpm();
+      double trueAcceleration = (trueRpm - previousRpm) * 100.0;
+      previousRpm = trueRpm;
+      if (trueAcceleration > peakAcceleration) peakAcceleration = trueAcceleration;
+
+      // Skip the first few revolutions, where neither has a reading yet
+      if (Sim::now() - start < 200000 || counter().getCurrentRPM() == 0) continue;
+      const SpeedEstimator& estimator = counter().getEstimator();
+      addSample(raw, counter().getCurrentRPM() - trueRpm);
+      addSample(smoothed, estimator.getCentiRpm(Hal::micros()) / 100.0 - trueRpm);
+      addSample(acceleration, estimator.getCentiRpmPerSecond() / 100.0 - trueAcceleration);
+    }
+    controller().stop();
+    encoder.setSpeedSource(nullptr, nullptr);
+    Sim::removeDevice(&motor);
+
+    double rawRms = sqrt(raw.sumSquares / raw.samples);
+    double smoothedRms = sqrt(smoothed.sumSquares / smoothed.samples);
+    double accelerationRms = sqrt(acceleration.sumSquares / acceleration.samples);
+    printf("  raw reading error (RPM): mean %.1f, rms %.1f, max %.1f\n",
+           raw.sum / raw.samples, rawRms, raw.max);
+    printf("  estimator error (RPM): mean %.1f, rms %.1f, max %.1f\n",
+           smoothed.sum / smoothed.samples, smoothedRms, smoothed.max);
+    printf("  acceleration error (RPM/s): mean %.1f, rms %.1f, max %.1f\n",
+           acceleration.sum / acceleration.samples, accelerationRms, acceleration.max);
+    expectNear("estimator rms / raw rms", smoothedRms / rawRms, 0.0, 0.5);
+    expectNear("estimator mean error (RPM)", smoothed.sum / smoothed.samples, 0.0, 5.0);
+    expectNear("acceleration rms error (RPM/s)", accelerationRms, 0.0, 1000.0);
+
+    // T = J * peak dw/dt, J = 4e-6 kg m^2
+    double peakTorque = MotorModel::defaults().inertia * peakAcceleration * 2.0 * M_PI / 60.0 * 1e6;
+    expectNear("peak torque (uN m)", counter().getEstimator().getPeakTorqueMicroNm(), peakTorque, peakTorque * 0.1);
+
+    ConfigStore::apply(ConfigStore::defaults(), nullptr);
+  }
+
+  struct Scenario {
+    const char* name;
+    void (*run)();
+  };
+
+  const Scenario SCENARIOS[] = {
+    {"steady", scenarioSteady},
+    {"glitches", scenarioGlitches},
+    {"sensor-diagnostics", scenarioSensorDiagnostics},
+    {"stall", scenarioStall},
+    {"acceleration", scenarioAccelerationTest},
+    {"capture", scenarioCapture},
+    {"motor", scenarioMotor},
+    {"motor-noisy", scenarioMotorNoisy},
+    {"weak-motor", scenarioWeakMotor},
+    {"supply", scenarioSupply},
+    {"parallel", scenarioParallel},
+    {"telemetry", scenarioTelemetry},
+    {"endurance", scenarioEndurance},
+    {"vibration", scenarioVibration},
+    {"estimator", scenarioEstimator},
+  };
+
+  void writeTrace(const char* scenario) {
+    EdgeTrace::stop();
+    std::string path = std::string(traceDirectory) + "/" + scenario + ".trace";
+    if (!TraceReplay::saveTrace(path.c_str())) {
+      fprintf(stderr, "Can't write %s\n", path.c_str());
+      failed = true;
+    } else if (EdgeTrace::getDroppedCount() > 0) {
+      printf("  trace %s: %lu events dropped (buffer full)\n", path.c_str(), EdgeTrace::getDroppedCount());
+    }
+  }
+
+  // Replays each trace and checks it against its .expected baseline
+  int replayMain(int argc, char** argv) {
+    bool update = false;
+    double tolerance = 1.0;
+    std::vector<const char*> traces;
+    for (int i = 0; i < argc; i++) {
+      if (strcmp(argv[i], "-v") == 0) {
+        Sim::setConsoleEcho(true);
+      } else if (strcmp(argv[i], "--update") == 0) {
+        update = true;
+      } else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+        tolerance = atof(argv[++i]);
+      } else {
+        traces.push_back(argv[i]);
+      }
+    }
+    if (traces.empty()) {
+      fprintf(stderr, "replay: no trace files given\n");
+      return 2;
+    }
+
+    for (const char* path : traces) {
+      printf("%s\n", path);
+      TraceReplay::Trace trace;
+      TraceReplay::Result result;
+      std::string error;
+      if (!TraceReplay::loadTrace(path, trace, error) ||
+          !TraceReplay::replay(trace, CHANNEL_PINS[0], result, error)) {
+        printf("  %s  <-- FAIL\n", error.c_str());
+        failed = true;
+        continue;
+      }
+      if (trace.dropped > 0) printf("  note: %lu events were dropped during capture\n", trace.dropped);
+      if (trace.version < TraceReplay::FULL_CONFIG_VERSION) {
+        printf("  note: version %u trace - estimator, early-abort and supply settings replay with defaults\n",
+               (unsigned)trace.version);
+      }
+      TraceReplay::print(result);
+
+      std::string expectedPath(path);
+      size_t extension = expectedPath.rfind(".trace");
+      if (extension != std::string::npos) expectedPath.erase(extension);
+      expectedPath += ".expected";
+
+      if (update) {
+        if (!TraceReplay::saveResult(expectedPath.c_str(), result)) {
+          printf("  can't write %s  <-- FAIL\n", expectedPath.c_str());
+          failed = true;
+        } else {
+          printf("  baseline written to %s\n", expectedPath.c_str());
+        }
+        continue;
+      }
+
+      TraceReplay::Result baseline;
+      if (!TraceReplay::loadResult(expectedPath.c_str(), baseline, error)) {
+        printf("  no baseline (%s), run with --update to create one\n", expectedPath.c_str());
+        continue;
+      }
+      if (TraceReplay::compare(baseline, result, tolerance)) {
+        printf("  matches %s\n", expectedPath.c_str());
+      } else {
+        printf("  differs from %s  <-- FAIL\n", expectedPath.c_str());
+        failed = true;
+      }
+    }
+
+    printf("%s\n", failed ? "FAILED" : "OK");
+    return failed ? 1 : 0;
+  }
+
+  // minCycles of `name` in a Benchmark::toJson() file (one benchmark per line)
+  bool findBaseline(const char* path, const char* name, unsigned long& minCycles) {
+    FILE* file = fopen(path, "r");
+    if (!file) return false;
+
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"name\":\"%s\"", name);
+    char line[256];
+    bool found = false;
+    while (!found && fgets(line, sizeof(line), file)) {
+      const char* field = strstr(line, "\"minCycles\":");
+      if (strstr(line, pattern) && field) {
+        minCycles = strtoul(field + 12, nullptr, 10);
+        found = true;
+      }
+    }
+    fclose(file);
+    return found;
+  }
+
+  int benchMain(int argc, char** argv) {
+    uint16_t iterations = Benchmark::DEFAULT_ITERATIONS;
+    const char* jsonPath = nullptr;
+    const char* baselinePath = nullptr;
+    double threshold = 25.0;
+    for (int i = 0; i + 1 < argc; i += 2) {
+      if (strcmp(argv[i], "--iterations") == 0) iterations = (uint16_t)atoi(argv[i + 1]);
+      else if (strcmp(argv[i], "--json") == 0) jsonPath = argv[i + 1];
+      else if (strcmp(argv[i], "--baseline") == 0) baselinePath = argv[i + 1];
+      else if (strcmp(argv[i], "--threshold") == 0) threshold = atof(argv[i + 1]);
+      else {
+        fprintf(stderr, "Bad option: %s\n", argv[i]);
+        return 2;
+      }
+    }
+    if (argc % 2 != 0) {
+      fprintf(stderr, "Bad option: %s\n", argv[argc - 1]);
+      return 2;
+    }
+
+    // Realistic state for the serializers
+    Channels::begin(CHANNEL_PINS, 1);
+    runFor(100000);
+
+    Benchmark::runAll(iterations);
+
+    printf("%-20s %-9s %10s %10s %10s\n", "benchmark", "per", "min ns", "mean ns", "max ns");
+    for (uint8_t i = 0; i < Benchmark::getCount(); i++) {
+      const BenchmarkResult& result = Benchmark::getResult(i);
+      printf("%-20s %-9s %10lu %10lu %10lu", result.name, result.per, (unsigned long)result.minCycles,
+             (unsigned long)Benchmark::getMeanCycles(result), (unsigned long)result.maxCycles);
+
+      unsigned long baseline = 0;
+      if (baselinePath && findBaseline(baselinePath, result.name, baseline)) {
+        // Ignore a few ns of timer noise on the very cheap paths
+        double limit = baseline * (1.0 + threshold / 100.0) + 5;
+        bool regressed = result.minCycles > limit;
+        printf("  (baseline %lu)%s", baseline, regressed ? "  <-- REGRESSION" : "");
+        if (regressed) failed = true;
+      }
+      printf("\n");
+    }
+
+    if (jsonPath) {
+      FILE* file = fopen(jsonPath, "w");
+      if (!file || fputs(Benchmark::toJson().c_str(), file) < 0) {
+        fprintf(stderr, "Can't write %s\n", jsonPath);
+        failed = true;
+      }
+      if (file) fclose(file);
+    }
+
+    printf("%s\n", failed ? "FAILED" : "OK");
+    return failed ? 1 : 0;
+  }
+
+  volatile sig_atomic_t interrupted = 0;
+
+  void onInterrupt(int) {
+    interrupted = 1;
+  }
+
+  // Reference receiver: real time, not simulated
+  int receiveMain(int argc, char** argv) {
+    uint16_t port = UdpTelemetry::DEFAULT_PORT;
+    const char* outPath = nullptr;
+    unsigned long maxPackets = 0;
+    double maxSeconds = 0;
+    for (int i = 0; i + 1 < argc; i += 2) {
+      if (strcmp(argv[i], "--port") == 0) port = (uint16_t)atoi(argv[i + 1]);
+      else if (strcmp(argv[i], "--out") == 0) outPath = argv[i + 1];
+      else if (strcmp(argv[i], "--packets") == 0) maxPackets = strtoul(argv[i + 1], nullptr, 10);
+      else if (strcmp(argv[i], "--seconds") == 0) maxSeconds = atof(argv[i + 1]);
+      else {
+        fprintf(stderr, "Bad option: %s\n", argv[i]);
+        return 2;
+      }
+    }
+    if (argc % 2 != 0) {
+      fprintf(stderr, "Bad option: %s\n", argv[argc - 1]);
+      return 2;
+    }
+
+    TelemetryReceiver receiver;
+    std::string error;
+    if (!receiver.open(port, error)) {
+      fprintf(stderr, "%s\n", error.c_str());
+      return 1;
+    }
+    FILE* out = outPath ? fopen(outPath, "w") : stdout;
+    if (!out) {
+      fprintf(stderr, "Can't write %s\n", outPath);
+      return 1;
+    }
+    receiver.setOutput(out);
+    fprintf(stderr, "Listening on UDP port %u\n", (unsigned)receiver.getPort());
+
+    signal(SIGINT, onInterrupt);
+    uint64_t started = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+    while (!interrupted) {
+      receiver.poll(200);
+      if (maxPackets > 0 && receiver.getStats().packets >= maxPackets) break;
+      uint64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+      if (maxSeconds > 0 && now - started >= maxSeconds * 1000) break;
+    }
+    if (out != stdout) fclose(out);
+
+    const TelemetryReceiver::Stats& stats = receiver.getStats();
+    fprintf(stderr, "%lu packets, %lu samples, %lu missing packets, %lu samples lost on the device, %lu invalid\n",
+            stats.packets, stats.samples, stats.missingPackets, stats.lostSamples, stats.invalid);
+    return 0;
+  }
+
+  bool parseOption(const char* option, const char* value) {
+    if (strcmp(option, "--supply") == 0) {
+      options.supplyVolts = atof(value);
+    } else if (strcmp(option, "--inductance") == 0) {
+      options.inductanceHenry = atof(value);
+    } else if (strcmp(option, "--jitter") == 0) {
+      options.faults.jitterUs = atof(value);
+    } else if (strcmp(option, "--reflections") == 0) {
+      options.faults.reflectionProbability = atof(value);
+    } else if (strcmp(option, "--trace") == 0) {
+      traceDirectory = value;
+      return true;
+    } else if (strcmp(option, "--aperture") == 0) {
+      const char* colon = strchr(value, ':');
+      if (!colon || options.apertureCount >= SimEncoder::MAX_APERTURES - 1) return false;
+      options.aperturePhase[options.apertureCount] = atof(value);
+      options.apertureScale[options.apertureCount] = atof(colon + 1);
+      options.apertureCount++;
+    } else {
+      return false;
+    }
+    if (strcmp(option, "--supply") != 0 && strcmp(option, "--inductance") != 0) {
+      options.faultsGiven = true;
+    }
+    return true;
+  }
+}
+
+int main(int argc, char** argv) {
+  // Same measurement/control tasks as main.cpp
+  ConfigStore::begin();
+  Scheduler::addTask("rpm", Channels::updateRpm, 500, 0, 100 * Channels::MAX_CHANNELS);
+  Scheduler::addTask("motor", Channels::updateMotors, 500, 1, 200 * Channels::MAX_CHANNELS);
+  Scheduler::addTask("supply", SupplyMonitor::update, 10000, 2, 200);
+  Scheduler::addTask("udp", UdpTelemetry::update, 2000, 2, 1000);
+  Scheduler::addTask("endurance", Endurance::update, 100000, 2, 1000);
+  Scheduler::addTask("vibration", Vibration::update, 50000, 3, 3000 * Channels::MAX_CHANNELS);
+  Scheduler::addTask("log", Logger::drain, 20000, 5, 1000);
+
+  if (argc > 1 && strcmp(argv[1], "replay") == 0) {
+    return replayMain(argc - 2, argv + 2);
+  }
+  if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+    return benchMain(argc - 2, argv + 2);
+  }
+  if (argc > 1 && strcmp(argv[1], "receive") == 0) {
+    return receiveMain(argc - 2, argv + 2);
+  }
+
+  bool selected[sizeof(SCENARIOS) / sizeof(SCENARIOS[0])] = {false};
+  bool anySelected = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-v") == 0) {
+      Sim::setConsoleEcho(true);
+      continue;
+    }
+    if (strncmp(argv[i], "--", 2) == 0) {
+      if (i + 1 >= argc || !parseOption(argv[i], argv[i + 1])) {
+        fprintf(stderr, "Bad option: %s\n", argv[i]);
+        return 2;
+      }
+      i++;
+      continue;
+    }
+    bool found = false;
+    for (size_t s = 0; s < sizeof(SCENARIOS) / sizeof(SCENARIOS[0]); s++) {
+      if (strcmp(argv[i], SCENARIOS[s].name) == 0) {
+        selected[s] = true;
+        anySelected = found = true;
+      }
+    }
+    if (!found) {
+      fprintf(stderr, "Unknown scenario: %s\n", argv[i]);
+      return 2;
+    }
+  }
+
+  Sim::addDevice(&encoder);
+
+  // Default sensor faults for motor-noisy: 15 us edge jitter, a reflection
+  // every third revolution and a second, narrower aperture half a turn on
+  if (!options.faultsGiven) {
+    options.faults = SimEncoder::Faults{15.0, 0.3, 200, 1};
+    options.aperturePhase[0] = 0.5;
+    options.apertureScale[0] = 0.4;
+    options.apertureCount = 1;
+  }
+  options.faultsGiven = true;
+
+  for (size_t s = 0; s < sizeof(SCENARIOS) / sizeof(SCENARIOS[0]); s++) {
+    if (!anySelected || selected[s]) {
+      if (traceDirectory) EdgeTrace::start(0, 0);
+      SCENARIOS[s].run();
+      if (traceDirectory) writeTrace(SCENARIOS[s].name);
+    }
+  }
+
+  printf("%s\n", failed ? "FAILED" : "OK");
+  return failed ? 1 : 0;
+}
+
+#endif